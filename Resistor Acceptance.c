@@ -12,33 +12,318 @@ Software : Dev C/C++
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
+#include <time.h>
 
-struct shipmentInfo {
-    char company[18], date[8];
-    double nominalValue, tolerance, meanResistance;
-    float failureRate, standDevResistance, varianceResistance;
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <unistd.h>
+#define INGEST_THREADS
+#define LOG_TRUNCATE
+#endif
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#define SERVE_EPOLL
+#endif
+
+#include "Resistor Library.h"
+
+#define INGEST_BUFFER_SIZE 1048576
+#define INGEST_KEY_MAX 64
+#define INGEST_CHUNK 4096
+#define INGEST_MAX_THREADS 64
+#define TEXT_LOG_LINES 8
+#define TEXT_LOG_SCAN 65536
+#define BENCH_ITEMS 4096
+#define BENCH_REPEATS 101
+#define BENCH_LOG "resistor-bench.rlog"
+#define BENCH_FIRST_DAY 18000
+#define PROFILE_DUMP_SECONDS 1
+#define GENERATOR_MAX_ITEMS 64
+#define GENERATOR_MAX_READINGS 4096
+#define GENERATOR_BUFFER_SIZE 1048576
+#define GENERATOR_PREFIX 64
+#define GENERATE_MEASUREMENTS 0
+#define GENERATE_LOG 1
+#define DECODE_CHUNK 4096
+#define SERVE_LINE_MAX 65536
+#define SERVE_MAX_READINGS 4096
+#define SERVE_REPLY_BYTES 256
+#define SERVE_MAX_THREADS 64
+#define SERVE_EVENTS 256
+#define SERVE_FLUSH_MS 100
+#define SERVE_SEND_TIMEOUT_MS 5000
+#define SERVE_THREADS 4
+#define RIG_MAX_SOURCES 64
+#define RIG_LINE_MAX 65536
+#define RIG_IDLE_MS 2000
+#define RIG_WAIT_MS 100
+#define RIG_TICK_MS 10
+#define RIG_REPLAY_RATE 1000
+#define REPORT_BUFFER 262144
+#define REPORT_ROW_MAX 8192
+#define REPORT_FIELD_MAX 320
+#define REPORT_NUMBER_MAX 320
+#define REPORT_TABLE 0
+#define REPORT_CSV 1
+#define REPORT_JSON 2
+
+struct ingestState {
+    char key[INGEST_KEY_MAX];
+    int keyLen, valid;
+    long line, fail, batches;
+    long pending;
+    double lower, upper;
+    double readings[INGEST_CHUNK];
+    stats sample;
+    data batch;
+    FILE* out;
+    const registry* suppliers;
+    logWriter* log;
+    spcTable* charts;
+    long chart;
+    sketchTable* sketches;
+    sketch* sketch;
+    archiveBuffer* archive;
+    FILE* archiveFile;
+    const samplingPlan* plan;
+    planProgress progress;
+    unsigned char failMask[INGEST_CHUNK / 8];
+    long decisions[3], offered, needed;
+    const char* source;
+    struct ingestPart* part;
+};
+typedef struct ingestState ingest;
+
+struct ingestResult {
+    data batch;
+    long line, frame, frameBytes;
+    int decision;
+};
+typedef struct ingestResult ingestResult;
+
+struct ingestMessage {
+    long line, after;
+    char text[96];
+};
+typedef struct ingestMessage ingestMessage;
+
+struct ingestPart {
+    const char *start, *end;
+    ingestResult* results;
+    long resultCount, resultMax;
+    ingestMessage* messages;
+    long messageCount, messageMax;
+    int failed;
+    sketchTable sketches;
+    archiveBuffer archive;
+    ingest state;
+};
+typedef struct ingestPart ingestPart;
+
+struct generatorSettings {
+    unsigned long long seed;
+    int readings, suppliers, codes, tolerances, hasSpare;
+    long perDay, firstDay;
+    double defects, outliers, spread, drift, spare;
+    char supplier[GENERATOR_MAX_ITEMS][18];
+    bandCode code[GENERATOR_MAX_ITEMS];
+    int tolerance[GENERATOR_MAX_ITEMS];
+    long batches[GENERATOR_MAX_ITEMS];
+};
+typedef struct generatorSettings generator;
+
+struct sinkSettings {
+    const char *logName, *chartName, *sketchName, *archiveName;
+    long syncRecords, syncMillis;
+    int binary, hasPlan;
+    samplingPlan plan;
+    const registry* suppliers;
+    FILE *out, *archive;
+    logWriter log;
+    spcTable charts;
+    sketchTable sketches;
+};
+typedef struct sinkSettings sinks;
+
+struct reportSettings {
+    int format;
+    long offset, limit;
 };
-typedef struct shipmentInfo data;
+typedef struct reportSettings reportSettings;
+
+struct reportWriter {
+    FILE* out;
+    const registry* suppliers;
+    char* buffer;
+    long used, offset, limit, rows;
+    int format, failed;
+};
+typedef struct reportWriter report;
+
+struct profileSettings {
+    const char* dumpFile;
+    long dumpSeconds;
+    double start;
+    int stopped;
+};
+typedef struct profileSettings profileSettings;
+
+#ifdef SERVE_EPOLL
+struct serveClient {
+    int fd, discard;
+    long used;
+    struct serveClient* next;
+    char buffer[SERVE_LINE_MAX];
+};
+typedef struct serveClient serveClient;
+
+struct server {
+    int epoll, listener, stop, dirty;
+    pthread_mutex_t queueLock, logLock;
+    pthread_cond_t queueReady;
+    serveClient *head, *tail;
+    FILE* out;
+    const registry* suppliers;
+    logWriter* log;
+    spcTable* charts;
+    const char* chartFile;
+    sketchTable* sketches;
+    const char* sketchFile;
+    FILE* archive;
+    const samplingPlan* plan;
+};
+typedef struct server server;
+
+struct rigStation {
+    const char* path;
+    int fd, fifo;
+    long used;
+    double last;
+    archiveBuffer frames;
+    ingest state;
+    char buffer[RIG_LINE_MAX];
+};
+typedef struct rigStation rigStation;
+#endif
 int operation();
 int menu();
 void dateInput(data*);
-int toInt(char[]);
-int supplierSelect(const char**);
+int supplierSelect(const registry*);
+int loadSuppliers(registry*);
 void fourBands(const char**, const char**, const char**, int, int, int, data*);
 void fiveBands(const char**, const char**, const char**, int, int, int, data*);
 void sixBands(const char**, const char**, const char**, const char**, int, int, int, int, data*);
 int bandInput(const char**, int, int);
 double actualValInp(int);
-double idealVal(int, int, int, int, int);
-double multVal(int);
-double tolVal(int);
-int tempVal(int);
-double sampleMean(double[]);
-float sampleStandDev(double[], double);
-double minTolVal(double, float);
-double maxTolVal(double, float);
-FILE* fileHandling();
-
+int decodeFile(const char*);
+int identifyFile(const char*, const struct standardSeries*, int, const char**, const char**, const char**);
+int measureBatch(data*, const samplingPlan*);
+void printPlan(FILE*, const samplingPlan*);
+FILE* fileHandling(char*);
+int reportOptions(int, char**, reportSettings*);
+int reportOpen(report*, FILE*, const registry*, const reportSettings*);
+int reportSkip(report*);
+int reportFull(const report*);
+void reportRecord(report*, const data*);
+void reportWrite(report*, const char**, const int*);
+char* reportCsv(char*, const char*, int);
+char* reportJsonString(char*, const char*, int);
+int reportIsNumber(const char*, int);
+void reportFlush(report*);
+int reportClose(report*);
+char* formatFixed(char*, double);
+int viewLog(const char*, const registry*, int, const reportSettings*);
+void viewTextLog(const char*, int, report*);
+void viewBinaryLog(const char*, int, report*);
+void printColumnsRecord(const columns*, long, void*);
+int viewDateRange(const char*, const registry*, long, long, int, const reportSettings*);
+void viewSummary(const char*, const registry*, int);
+int loadLog(store*, const char*, const registry*);
+int loadTextLog(store*, const char*);
+void viewStoreSummary(const char*, const registry*, const char*);
+int queryKeys(const char*);
+int runQuery(const char*, const registry*, int);
+void writeRecord(FILE*, data*);
+FILE* openTextLog(const char*);
+int openLog(const char*, const registry*, FILE**, logWriter*, long, long);
+void sinkInit(sinks*, const registry*);
+int sinkOption(sinks*, const char*, const char*);
+int openSinks(sinks*);
+int closeSinks(sinks*);
+int ingestFile(const char*, const registry*, FILE*, logWriter*, spcTable*, sketchTable*, FILE*, const samplingPlan*);
+void ingestLine(ingest*, const char*, const char*);
+int ingestBatchStart(ingest*, const char*, const char*);
+void ingestBatchEnd(ingest*);
+void ingestFlush(ingest*);
+int ingestKey(const char*, const char*);
+void ingestError(ingest*, const char*, const char*);
+void ingestWhere(const ingest*);
+int ingestWrite(ingest*, data*, int, const unsigned char*, long);
+void ingestDecisions(const ingest*);
+int ingestParallel(const char*, const registry*, FILE*, logWriter*, int, sketchTable*, FILE*, const samplingPlan*);
+int openCharts(spcTable*, const char*);
+int closeCharts(spcTable*, const char*);
+void printAlerts(const spcChart*, const registry*, int, double, long);
+void viewCharts(const char*, const registry*);
+int openSketches(sketchTable*, const char*);
+int closeSketches(sketchTable*, const char*);
+void viewQuantiles(const registry*, int, char**);
+void viewHistogram(const registry*, int, int, char**);
+int openArchive(FILE**, const char*);
+int viewArchive(const char*, const registry*, int, const reportSettings*);
+int viewReadings(const char*, const registry*, long);
+void usage(const char*);
+double benchNow();
+unsigned long benchRandom(unsigned long long*);
+int compareTimes(const void*, const void*);
+void benchReport(FILE*, const char*, long, long, double*, int);
+void benchRecord(data*, long, unsigned long long*);
+void benchVisit(const columns*, long, void*);
+double benchScan(const logView*, int);
+void benchRemoveLog(const char*);
+int runBenchmarks(FILE*, long);
+int profileOptions(int, char**);
+void profileReport(FILE*);
+void profileWrite(const char*);
+void profileExit();
+void* profileDumper(void*);
+void generatorInit(generator*, const registry*);
+int generatorOption(generator*, const char*, const char*);
+double generatorUniform(generator*);
+double generatorNormal(generator*);
+int generateBatch(generator*, long, data*, char*, double*);
+char* formatReading(char*, double);
+int generateFile(generator*, const registry*, int, const char*, long);
+int serveEvaluate(const char*, const char*, const samplingPlan*, data*, double*, int*, const char**);
+int serve(const char*, const registry*, FILE*, logWriter*, spcTable*, const char*, sketchTable*, const char*, FILE*, const samplingPlan*, int);
+int submit(const char*);
+int rig(int, char**, const registry*, FILE*, logWriter*, spcTable*, const char*, sketchTable*, const char*, FILE*, const samplingPlan*, long, int);
+int replay(const char*, int, char**, double);
+#ifdef SERVE_EPOLL
+void serveSignal(int);
+int serveSend(int, const char*, long);
+int serveClientData(server*, serveClient*, archiveBuffer*);
+void* serveWorker(void*);
+int serveListen(const char*);
+int serveConnect(const char*);
+int rigOpen(rigStation*, int);
+int rigRead(rigStation*);
+void rigEndBatch(rigStation*);
+void rigClose(rigStation*, int);
+long replayBatch(const char*, long, long);
+#endif
 /* 
 Purpose: Resistor Analysis
     - Input a supplier name and date of shipment
@@ -53,229 +338,419 @@ Purpose: Resistor Analysis
     - Store this data to a log (user selected text file)
     - Output the log
     - Output log items with a specified supplier
+Global variables (Resistor Library.h):
+    const char* const suppliers[] - Constant array of character arrays (strings) for the built in supplier names, used when there is no supplier config file
 Main variables:
-    const char* suppliers[] - Constant array of character arrays (strings) for supplier names
     const char* bandColours[] - Constant array of character arrays (strings) for band colours
     const char* multiplierColours[] - Constant array of character arrays (strings) for multiplier colours
     const char* toleranceColours[] - Constant array of character arrays (strings) for tolerance colours
     const char* temperatureColours[] - Constant array of character arrays (strings) for temperature colours
     data output - Structure storing the date, supplier name, nominal value, tolerance, mean, standard deviation, variance and failure rate for the sample			
-Functions:
+    registry supplierList - Supplier names and the ids stored in binary logs, from suppliers.cfg (see loadSuppliers())
+Functions (the calculations and binary logs are in Resistor Library.c so other programs can link them in, see Resistor Library.h):
     supplierSelect() - Menu system for selecting the supplier that the batch is from
+        loadSuppliers() - Reads the supplier registry from its config file at startup
     dateInput() - Input system for the date
+        parseDate() & formatDate() - Convert between ddMMyyyy text and the day number stored in the structure and logs
     menu() - Menu screen for selecting the amount of bands the resistor has
     fourBands(), fiveBands() & sixBands() - Record the colours of the batch's bands through a text based selection
         bandInput() - Request an input based on the values passed to the function
-        idealVal() - Calculate the nominal value based on the input provided
+        idealVal() - Calculate the nominal value based on the input provided (from tables built at compile time)
+    decodeBands() - Decode an array of band codes to nominal value, tolerance and temperature coefficient with an error code for each
+    matchStandard() - Find the nearest E12/E24/E96 value and band code for each of an array of measured values
     actualValInp() - Input the actual resistance for each of the 10 resistors in the sample
     minTolVal() & maxTolVal() - Calculate the minimum and maximum acceptable resistance values
-    sampleMean() - Calculates the mean of the sample
-    sampleStandDev() - Calculates the standard deviation of the sample
+    classifyReadings() - Counts the readings of a sample outside the tolerance limits (SSE2/AVX2 when the processor supports it)
+    measureBatch() - Reads the sample and records its failure rate and statistics with evaluateBatch()
+        planParse() & planAdd() - Sampling plan (--plan) that stops reading a batch as soon as it can be accepted or rejected
+    statsAdd() & statsMerge() - Single pass (Welford) mean and variance of the sample, mergeable between partial samples
+    ingestFile() - Non-interactive mode, streams a measurement file through the same calculations (see usage())
+        ingestParallel() - Splits the measurement file between worker threads at batch boundaries, output as ingestFile()
+        openCharts() & printAlerts() - EWMA and CUSUM control charts per supplier and nominal value, updated by ingestion and the service
+        openSketches() & viewQuantiles() - Quantile sketch and histogram of deviation from nominal per supplier, merged across files
+        openArchive() & viewArchive() - Append only archive of every raw reading, compressed, to re-analyse any batch later
+    logWriterAppend() & logOpen() - Write and read binary (.rlog) column logs, read through a memory map where available
+    viewLog() & reportRecord() - Log views as a table, CSV or JSON, a page at a time, formatted into large buffers without printf
+        openLog() - Opens a log for appending, recovering a binary log from its write-ahead journal or cutting a torn record off a text log
+        sinkOption() & openSinks() - The log, charts, sketches, archive and plan options shared by --ingest, --serve and --rig
+    indexAdd() & indexLookup() - Supplier index kept beside a binary log (.rlog.sidx) so filtered views only read matching records
+    logDateRange() - Date range query over a binary log, using the per block date ranges to skip blocks
+    aggAdd() & viewSummary() - Per supplier totals kept beside a binary log (.rlog.agg) so summaries don't read the log
+    loadLog() & storeTotals() - Load a text or binary log into memory as columns, for date ranges and summaries of text logs
+    runQuery() - Grouped totals of a log by supplier, month, tolerance and/or nominal value with queryRun()
+    runBenchmarks() - Microbenchmarks and end to end log benchmarks on synthetic data, results as JSON
+    profileOptions() & profileReport() - Per stage time, records and bytes of a run (--profile, built with -DRESISTOR_PROFILE)
+    generateFile() - Seeded synthetic measurements or batch records (text or binary log) for load testing
+    serve() & submit() - Long running acceptance service for many test stations over a Unix socket or localhost TCP (Linux)
+    rig() & replay() - Reads many instruments' measurement streams at once from FIFOs, pipes or files, and simulates them (Linux)
  */
 
-void main() {
-    const char* suppliers[4] = {"Farnell", "RSComponents", "Rapid Electronics", "DigiKey"};
+int main(int argc, char* argv[]) {
     const char* bandColours[10] = {"Black", "Brown", "Red", "Orange", "Yellow", "Green", "Blue", "Violet", "Grey", "White"};
     const char* multiplierColours[10] = {"Silver", "Gold", "Black", "Brown", "Red", "Orange", "Yellow", "Green", "Blue", "Violet"};
     const char* toleranceColours[7] = {"Silver", "Gold", "Brown", "Red", "Green", "Blue", "Violet"};
     const char* temperatureColours[4] = {"Brown", "Red", "Orange", "Yellow"};
-    int i, fail = 0, trigger = 0, index;
-    double arr[10];
+    int i, index, binary, threads, planText = 0, decision = PLAN_MORE;
+    int first, follow;
+    long from, to, idle;
+    double rate;
     data output;
-    FILE *fp;
-    char fileName[30], buffer[30];
+    FILE* fp = NULL;
+    logWriter log;
+    static sinks sink;
+    samplingPlan plan;
+    generator settings;
+    reportSettings view;
+    static registry supplierList;
+    char fileName[30], date[9];
+
+    argc = profileOptions(argc, argv);
+    if (loadSuppliers(&supplierList) != 0) {
+        return 1;
+    }
+    if (argc == 3 && strcmp(argv[1], "--plan") == 0 && planParse(&plan, argv[2]) == 0) {
+        /*Interactive menu with a sampling plan*/
+        planText = 2;
+        argc = 1;
+    }
+    if (argc > 1) {
+        if (argc >= 3 && (strcmp(argv[1], "--view") == 0 || strcmp(argv[1], "--range") == 0 || strcmp(argv[1], "--recent") == 0
+                || strcmp(argv[1], "--archive") == 0)) {
+            argc = reportOptions(argc, argv, &view);
+            if (argc < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        if (argc >= 3 && strcmp(argv[1], "--ingest") == 0) {
+            sinkInit(&sink, &supplierList);
+            threads = 1;
+            for (i = 3; i + 1 < argc; i += 2) {
+                if (strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0) {
+                    threads = atoi(argv[i + 1]);
+                } else if (sinkOption(&sink, argv[i], argv[i + 1]) != 0) {
+                    break;
+                }
+            }
+            if (i != argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (openSinks(&sink) != 0) {
+                return 1;
+            }
+            if (sink.chartName != NULL && threads > 1) {
+                fprintf(stderr, "Control charts follow the readings in file order, ingesting with one thread\n");
+            }
+            i = threads > 1 && sink.chartName == NULL ? ingestParallel(argv[2], sink.suppliers, sink.out, sink.binary ? &sink.log : NULL, threads,
+                    sink.sketchName != NULL ? &sink.sketches : NULL, sink.archive, sink.hasPlan ? &sink.plan : NULL)
+                    : ingestFile(argv[2], sink.suppliers, sink.out, sink.binary ? &sink.log : NULL, sink.chartName != NULL ? &sink.charts : NULL,
+                    sink.sketchName != NULL ? &sink.sketches : NULL, sink.archive, sink.hasPlan ? &sink.plan : NULL);
+            return closeSinks(&sink) != 0 || i != 0;
+        }
+        if ((argc == 3 || argc == 4) && strcmp(argv[1], "--view") == 0) {
+            index = argc == 4 ? supplierId(&supplierList, argv[3]) : -1;
+            if (argc == 4 && index < 0) {
+                fprintf(stderr, "Unknown supplier %s\n", argv[3]);
+                return 1;
+            }
+            return viewLog(argv[2], &supplierList, index, &view);
+        }
+        if (argc == 3 && strcmp(argv[1], "--decode") == 0) {
+            return decodeFile(argv[2]);
+        }
+        if ((argc == 4 || argc == 5) && strcmp(argv[1], "--identify") == 0) {
+            if (findSeries(argv[3]) == NULL || (argc == 5 && (atoi(argv[4]) < 0 || atoi(argv[4]) > 6))) {
+                usage(argv[0]);
+                return 1;
+            }
+            return identifyFile(argv[2], findSeries(argv[3]), argc == 5 ? atoi(argv[4]) : findSeries(argv[3])->tolerance,
+                    bandColours, multiplierColours, toleranceColours);
+        }
+        if ((argc == 3 || argc == 4) && strcmp(argv[1], "--summary") == 0) {
+            if (!isBinaryLog(argv[2])) {
+                viewStoreSummary(argv[2], &supplierList, argc == 4 ? argv[3] : NULL);
+                return 0;
+            }
+            index = argc == 4 ? supplierId(&supplierList, argv[3]) : -1;
+            if (argc == 4 && index < 0) {
+                fprintf(stderr, "Unknown supplier %s\n", argv[3]);
+                return 1;
+            }
+            viewSummary(argv[2], &supplierList, index);
+            return 0;
+        }
+        if (argc == 3 && strcmp(argv[1], "--spc") == 0) {
+            viewCharts(argv[2], &supplierList);
+            return 0;
+        }
+        if (argc >= 3 && strcmp(argv[1], "--quantiles") == 0) {
+            viewQuantiles(&supplierList, argc - 2, argv + 2);
+            return 0;
+        }
+        if ((argc == 3 || argc == 4) && strcmp(argv[1], "--archive") == 0) {
+            index = argc == 4 ? supplierId(&supplierList, argv[3]) : -1;
+            if (argc == 4 && index < 0) {
+                fprintf(stderr, "Unknown supplier %s\n", argv[3]);
+                return 1;
+            }
+            return viewArchive(argv[2], &supplierList, index, &view);
+        }
+        if (argc == 4 && strcmp(argv[1], "--readings") == 0) {
+            if (atol(argv[3]) < 1) {
+                usage(argv[0]);
+                return 1;
+            }
+            return viewReadings(argv[2], &supplierList, atol(argv[3]));
+        }
+        if (argc >= 4 && strcmp(argv[1], "--histogram") == 0) {
+            index = supplierId(&supplierList, argv[2]);
+            if (index < 0) {
+                fprintf(stderr, "Unknown supplier %s\n", argv[2]);
+                return 1;
+            }
+            viewHistogram(&supplierList, index, argc - 3, argv + 3);
+            return 0;
+        }
+        if (argc == 4 && strcmp(argv[1], "--query") == 0) {
+            if (queryKeys(argv[3]) < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            return runQuery(argv[2], &supplierList, queryKeys(argv[3]));
+        }
+        if ((argc == 5 || argc == 6) && strcmp(argv[1], "--range") == 0) {
+            index = argc == 6 ? supplierId(&supplierList, argv[5]) : -1;
+            if (!parseDate(argv[3], strlen(argv[3]), &from) || !parseDate(argv[4], strlen(argv[4]), &to) || (argc == 6 && index < 0)) {
+                usage(argv[0]);
+                return 1;
+            }
+            return viewDateRange(argv[2], &supplierList, from, to, index, &view);
+        }
+        if ((argc == 4 || argc == 5) && strcmp(argv[1], "--recent") == 0) {
+            index = argc == 5 ? supplierId(&supplierList, argv[4]) : -1;
+            to = (long) (time(NULL) / 86400);
+            from = to - atol(argv[3]) + 1;
+            if (atol(argv[3]) < 1 || (argc == 5 && index < 0)) {
+                usage(argv[0]);
+                return 1;
+            }
+            return viewDateRange(argv[2], &supplierList, from, to, index, &view);
+        }
+        if ((argc == 2 || argc == 3) && strcmp(argv[1], "--bench") == 0) {
+            if (argc == 3 && atol(argv[2]) < 10000) {
+                usage(argv[0]);
+                return 1;
+            }
+            return runBenchmarks(stdout, argc == 3 ? atol(argv[2]) : 1000000);
+        }
+        if (argc >= 3 && strcmp(argv[1], "--serve") == 0) {
+            sinkInit(&sink, &supplierList);
+            threads = SERVE_THREADS;
+            for (i = 3; i + 1 < argc; i += 2) {
+                if (strcmp(argv[i], "--threads") == 0 && atoi(argv[i + 1]) > 0) {
+                    threads = atoi(argv[i + 1]);
+                } else if (sinkOption(&sink, argv[i], argv[i + 1]) != 0) {
+                    break;
+                }
+            }
+            if (i != argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (openSinks(&sink) != 0) {
+                return 1;
+            }
+            i = serve(argv[2], sink.suppliers, sink.out, sink.binary ? &sink.log : NULL, sink.chartName != NULL ? &sink.charts : NULL, sink.chartName,
+                    sink.sketchName != NULL ? &sink.sketches : NULL, sink.sketchName, sink.archive, sink.hasPlan ? &sink.plan : NULL, threads);
+            return closeSinks(&sink) != 0 || i != 0;
+        }
+        if (argc == 3 && strcmp(argv[1], "--submit") == 0) {
+            return submit(argv[2]);
+        }
+        if (argc >= 3 && strcmp(argv[1], "--rig") == 0) {
+            for (first = 2; first < argc && strncmp(argv[first], "--", 2) != 0; first++);
+            sinkInit(&sink, &supplierList);
+            idle = RIG_IDLE_MS;
+            follow = 0;
+            for (i = first; i < argc; i += 2) {
+                if (strcmp(argv[i], "--follow") == 0) {
+                    /*The only option without a value*/
+                    follow = 1;
+                    i--;
+                } else if (i + 1 == argc) {
+                    break;
+                } else if (strcmp(argv[i], "--idle") == 0 && isdigit((unsigned char) argv[i + 1][0])) {
+                    idle = atol(argv[i + 1]);
+                } else if (sinkOption(&sink, argv[i], argv[i + 1]) != 0) {
+                    break;
+                }
+            }
+            if (i != argc || first == 2 || first - 2 > RIG_MAX_SOURCES) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (openSinks(&sink) != 0) {
+                return 1;
+            }
+            i = rig(first - 2, argv + 2, sink.suppliers, sink.out, sink.binary ? &sink.log : NULL, sink.chartName != NULL ? &sink.charts : NULL, sink.chartName,
+                    sink.sketchName != NULL ? &sink.sketches : NULL, sink.sketchName, sink.archive, sink.hasPlan ? &sink.plan : NULL, idle, follow);
+            return closeSinks(&sink) != 0 || i != 0;
+        }
+        if (argc >= 4 && strcmp(argv[1], "--replay") == 0) {
+            for (first = 3; first < argc && strncmp(argv[first], "--", 2) != 0; first++);
+            rate = RIG_REPLAY_RATE;
+            if (first + 2 == argc && strcmp(argv[first], "--rate") == 0 && isdigit((unsigned char) argv[first + 1][0])) {
+                rate = atof(argv[first + 1]);
+            } else if (first != argc) {
+                usage(argv[0]);
+                return 1;
+            }
+            if (first == 3 || first - 3 > RIG_MAX_SOURCES) {
+                usage(argv[0]);
+                return 1;
+            }
+            return replay(argv[2], first - 3, argv + 3, rate);
+        }
+        if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+            generatorInit(&settings, &supplierList);
+            index = 0;
+            for (i = 4; i + 1 < argc; i += 2) {
+                if (strcmp(argv[i], "--out") == 0) {
+                    index = i + 1;
+                } else if (generatorOption(&settings, argv[i], argv[i + 1]) != 0) {
+                    break;
+                }
+            }
+            binary = strcmp(argv[2], "log") == 0 ? GENERATE_LOG : GENERATE_MEASUREMENTS;
+            if (i != argc || atol(argv[3]) < 1 || (binary == GENERATE_MEASUREMENTS && strcmp(argv[2], "measurements") != 0)) {
+                usage(argv[0]);
+                return 1;
+            }
+            return generateFile(&settings, &supplierList, binary, index > 0 ? argv[index] : NULL, atol(argv[3]));
+        }
+        usage(argv[0]);
+        return 1;
+    }
 
+    if (planText > 0) {
+        printPlan(stdout, &plan);
+    }
     switch (operation()) {
         case 1:
-            strcpy(output.company, suppliers[supplierSelect(suppliers) - 1]);
+            strcpy(output.company, supplierName(&supplierList, supplierSelect(&supplierList) - 1));
             dateInput(&output);
             output.failureRate = 0;
             switch (menu()) {
                 case 1:
                     fourBands(bandColours, multiplierColours, toleranceColours, 10, 10, 7, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(sampleStandDev(arr, sampleMean(arr)));
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 2:
                     fiveBands(bandColours, multiplierColours, toleranceColours, 10, 10, 7, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(output.varianceResistance);
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 3:
                     sixBands(bandColours, multiplierColours, toleranceColours, temperatureColours, 10, 10, 7, 4, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(output.varianceResistance);
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 4:
                     exit(0);
             }
-            printf("Company - %s\nDate - %s\nFailure Rate - %f\n", output.company, output.date, output.failureRate);
+            printf("Company - %s\nDate - %s\nFailure Rate - %f\n", output.company, formatDate(output.day, date), output.failureRate);
             printf("Nominal Value - %lf\nTolerance - %f\n", output.nominalValue, output.tolerance);
             printf("Mean Resistance - %lf\nStandard Deviation - %lf\nVariance - %lf\n", output.meanResistance, output.standDevResistance, output.varianceResistance);
+            if (planText > 0) {
+                printf("Decision - %s after %ld readings\n", planDecisions[decision], output.sampleSize);
+            }
             break;
         case 2:
             printf("Please input the name of the text file for the application to use (if the file can't be found, one will be created using that name): ");
-            scanf("%s", &fileName);
-            strcat(fileName, ".txt");
-            fp = fopen(fileName, "a");
-            strcpy(output.company, suppliers[supplierSelect(suppliers) - 1]);
+            scanf("%25s", fileName);
+            binary = isBinaryLog(fileName);
+            if (!binary) {
+                strcat(fileName, ".txt");
+                fp = openTextLog(fileName);
+            }
+            strcpy(output.company, supplierName(&supplierList, supplierSelect(&supplierList) - 1));
             dateInput(&output);
             output.failureRate = 0;
             switch (menu()) {
                 case 1:
                     fourBands(bandColours, multiplierColours, toleranceColours, 10, 10, 7, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(sampleStandDev(arr, sampleMean(arr)));
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 2:
                     fiveBands(bandColours, multiplierColours, toleranceColours, 10, 10, 7, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(output.varianceResistance);
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 3:
                     sixBands(bandColours, multiplierColours, toleranceColours, temperatureColours, 10, 10, 7, 4, &output);
-                    for (i = 0; i < 10; i++) {
-                        arr[i] = actualValInp(i);
-                        if ((arr[i] > maxTolVal(output.nominalValue, output.tolerance)) || (arr[i] < minTolVal(output.nominalValue, output.tolerance))) {
-                            fail += 10;
-                        }
-                    }
-                    output.meanResistance = sampleMean(arr);
-                    output.standDevResistance = sampleStandDev(arr, output.meanResistance);
-                    output.varianceResistance = sqrt(output.varianceResistance);
-                    output.failureRate = fail;
+                    decision = measureBatch(&output, planText > 0 ? &plan : NULL);
                     break;
                 case 4:
                     exit(0);
             }
-            fprintf(fp, "%s\n%s\n%f\n%lf\n%f\n%lf\n%lf\n%lf\n", output.company, output.date, output.failureRate, output.nominalValue, output.tolerance, output.meanResistance, output.standDevResistance, output.varianceResistance);
-            fclose(fp);
+            if (binary) {
+                i = logWriterOpen(&log, fileName, &supplierList);
+                if (i == 0) {
+                    i = logWriterAppend(&log, &output);
+                    i = logWriterClose(&log) != 0 || i != 0;
+                }
+                if (i != 0) {
+                    printf("Unable to write to the binary log %s\n", fileName);
+                }
+            } else {
+                writeRecord(fp, &output);
+                fclose(fp);
+            }
+            if (planText > 0) {
+                printf("Decision - %s after %ld readings\n", planDecisions[decision], output.sampleSize);
+            }
             break;
         case 3:
-            fp = fileHandling();
-            printf("%-20s\t%-8s\t%-3s\t%-20s\t%-11s\t%-16s\t%-8s\t%-8s\n", "Company", "Date", "Failure Rate (%)", "Nominal Value (Ohms)", "Tolerance", "Mean (Ohms)", "Standard Deviation", "Variance");
-            while (fgets(buffer, 30, fp) != NULL) {
-                strtok(buffer, "\n"); /*Removes a token from a string and returns a pointer to the new form, in this case removing newline*/              	
-                printf("%-20s\t", buffer);
-                fgets(buffer, 30, fp);
-				strtok(buffer, "\n");        
-                printf("%-8s\t", buffer);
-                fgets(buffer, 30, fp);
-				strtok(buffer, "\n");               
-                printf("%-3s\t", buffer);
-                fgets(buffer, 30, fp);
-				strtok(buffer, "\n");               
-                printf("\t%-20s\t", buffer);
-                fgets(buffer, 30, fp);
-				strtok(buffer, "\n");                 
-                printf("%-9s\t", buffer);
-                fgets(buffer, 30, fp);
-				strtok(buffer, "\n");               
-                printf("%-16s\t", buffer);
-                fgets(buffer, 30, fp);
-                strtok(buffer, "\n");
-                printf("%-8s\t", buffer);
-            	fgets(buffer, 30, fp);
-            	strtok(buffer, "\n");
-                printf("\t%-8s\n", buffer);  				                   
-                }     
-            fclose(fp);            
+            fp = fileHandling(fileName);
+            fclose(fp);
+            viewLog(fileName, &supplierList, -1, NULL);
             break;
         case 4:
-            fp = fileHandling();
-            index = supplierSelect(suppliers) - 1;
-            printf("%-20s\t%-8s\t%-3s\t%-20s\t%-11s\t%-16s\t%-8s\t%-8s\n", "Company", "Date", "Failure Rate (%)", "Nominal Value (Ohms)", "Tolerance", "Mean (Ohms)", "Standard Deviation", "Variance");
-            while (fgets(buffer, 30, fp) != NULL) {
-                strtok(buffer, "\n"); /*Removes a token from a string and returns a pointer to the new form, in this case removing newline*/
-                if (strcmp(buffer, suppliers[index]) == 0) {                	
-                    printf("%-20s\t", buffer);
-                    fgets(buffer, 30, fp);
-					strtok(buffer, "\n");        
-                    printf("%-8s\t", buffer);
-                    fgets(buffer, 30, fp);
-					strtok(buffer, "\n");               
-                    printf("%-3s\t", buffer);
-                    fgets(buffer, 30, fp);
-					strtok(buffer, "\n");               
-                    printf("\t%-20s\t", buffer);
-                    fgets(buffer, 30, fp);
-					strtok(buffer, "\n");                 
-                    printf("%-9s\t", buffer);
-                    fgets(buffer, 30, fp);
-					strtok(buffer, "\n");               
-                    printf("%-16s\t", buffer);
-                    fgets(buffer, 30, fp);
-                    strtok(buffer, "\n");
-                    printf("%-8s\t", buffer);
-                	fgets(buffer, 30, fp);
-                	strtok(buffer, "\n");
-                    printf("\t%-8s\n", buffer);  
-					trigger = 1;                        
-                    }                   
-                else if (trigger = 1) {
-                    trigger = 0;
-        		}           
-            }
+            fp = fileHandling(fileName);
             fclose(fp);
+            viewLog(fileName, &supplierList, supplierSelect(&supplierList) - 1, NULL);
             break;
         case 5:
+            fp = fileHandling(fileName);
+            fclose(fp);
+            printf("Start of the date range\n");
+            dateInput(&output);
+            from = output.day;
+            printf("End of the date range\n");
+            dateInput(&output);
+            to = output.day;
+            viewDateRange(fileName, &supplierList, from, to, -1, NULL);
+            break;
+        case 6:
             exit(0);
     }
-
+    return 0;
 }
 
-FILE* fileHandling(){
+FILE* fileHandling(char* fileName){
 	/*
     Name: FileHandling
     Function: To allow the user to input a file name and open it if valid, returning an error message and exiting if it is not
-    Variables: fp, fileName
+    Paramaters: char* fileName - Set to the name of the file opened (at least 30 characters)
+    Variables: fp
+    Names ending in .rlog are binary logs and are used as given, otherwise .txt is added to the name. At most 25 characters are read,
+    so the name and extension fit
     Function will only return the file pointer if the file is found, otherwise the program will report this issue and exit processing
      */
 	FILE *fp;
-	char fileName[30];	
 	printf("Please input the name of the text file for the application to use: ");
-            scanf("%s", &fileName);
-            strcat(fileName, ".txt");
+            scanf("%25s", fileName);
+            if (!isBinaryLog(fileName)) {
+                strcat(fileName, ".txt");
+            }
             fp = fopen(fileName, "r");
             if (fp == NULL) {
                 printf("File not found. Exiting program.");
@@ -297,11 +772,11 @@ int operation() {
 
     do {
         printf("======================================================\n");
-        printf("1 - Input resistor batch\n2 - Input batch and store data in log\n3 - View data log\n4 - View data log (flitered by supplier)\n5 - Exit\n");
+        printf("1 - Input resistor batch\n2 - Input batch and store data in log\n3 - View data log\n4 - View data log (flitered by supplier)\n5 - View data log (date range)\n6 - Exit\n");
         printf("======================================================\n\r");
         valueRead = scanf("%d%c", &choice, &followChar);
         if (valueRead == 2) {
-            if (isspace(followChar) && choice > 0 && choice < 6) {
+            if (isspace(followChar) && choice > 0 && choice < 7) {
                 /*Integer followed by whitespace*/
                 valid = 1;
             } else {
@@ -309,7 +784,7 @@ int operation() {
                 printf("Only defined integer values will be accepted, please try again.\n\r");
                 fflush(stdin);
             }
-        } else if (valueRead == 1 && choice > 0 && choice < 6) {
+        } else if (valueRead == 1 && choice > 0 && choice < 7) {
             /*Integer followed by nothing*/
             valid = 1;
         } else {
@@ -318,7 +793,7 @@ int operation() {
             fflush(stdin);
         }
     } while (valid == 0);
-    if (choice == 1 || choice == 2 || choice == 3 || choice == 4) {
+    if (choice >= 1 && choice <= 5) {
         return choice;
     } else {
         exit(0);
@@ -368,71 +843,51 @@ int menu() {
 void dateInput(data* q) {
     /*
     Name: dateInput
-    Function: To allow the user to input a date as a string, validate the input and return the string to a structure if valid, looping if not
+    Function: To allow the user to input a date as a string, validate the input and set its day number in a structure if valid, looping if not
     Paramaters: data* q - A pointer to a structure of type data
-    Variables: daysPerMonth[], valid, d, m, y, dateInt
+    Variables: valid, dateArr
     Function will prompt the user to input a date in the form ddMMyyyy.
-    This input will then be validated by being cast to an integer using the toInt() function, after which the integer is checked to ensure the date is valid
-    If valid, the string form is set to the date of the data structure, else, the function loops
+    This input will then be validated and converted by parseDate(), if valid the day number is set to the date of the data structure, else, the function loops
      */
-    int daysPerMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    int valid = 0, d, m, y, dateInt;
-    char dateArr[8];
+    int valid = 0;
+    char dateArr[32];
     while (valid != 1) {
         fflush(stdin);
         printf("Please input the date in form ddMMyyyy (e.g. 07062020 is 7 June 2020): ");
-        scanf("%s", dateArr);
-        dateInt = toInt(dateArr);
-        d = dateInt / 1000000;
-        m = dateInt / 10000 - d * 100;
-        y = dateInt - d * 1000000 - m * 10000;
-        if (y % 400 == 0 || (y % 100 != 0 && y % 4 == 0)) {
-            daysPerMonth[1] = 29;
-        }
-        if (d < 1 || daysPerMonth[m - 1] < d || m < 1 || m > 12) {
+        scanf("%31s", dateArr);
+        if (!parseDate(dateArr, strlen(dateArr), &q->day)) {
              printf("Invalid date, please try again (format ddMMyyyy)\n\r");
         } else {
             valid = 1;
         }
     }
-    strcpy(q->date, dateArr);
 }
 
-int toInt(char a[]) {
-    /*
-    Name: toInt
-    Function: Convert a string value to an integer
-    Paramaters: char a[] - Array of characters
-    Variables: i, num
-    Function will convert a character array to an integer and return it (Validation of char array occurs in dateInput so isn't needed here)
-     */
-    int i, num;
-    num = 0;
-
-    for (i = 0; a[i] != '\0'; i++) {
-        num = num * 10 + a[i] - '0';
-    }
-    return num;
-}
-
-int supplierSelect(const char** suppliers) {
+int supplierSelect(const registry* suppliers) {
     /*
             Name: supplierSelect
             Function: Provide a menu system for selecting the supplier whose batch is being sampled
-            Paramaters: const char** suppliers - Constant array of strings (passed as a pointer)
-            Variables: choice, valid, valueRead, followChar
+            Paramaters: const registry* suppliers - Pointer to the supplier registry
+            Variables: choice, valid, valueRead, followChar, i
+            Each supplier is listed as its id + 1, the entry after the highest id exits
             Function will only return the value of choice when valid = 1, otherwise it will loop until valid input is given
      */
-    int choice, valid = 0, valueRead;
+    int choice, valid = 0, valueRead, i;
     char followChar;
 
     do {
         printf("======================================================\n");
-        printf("1 - %s\n2 - %s\n3 - %s\n4 - %s\n5 - Exit\n", suppliers[0], suppliers[1], suppliers[2], suppliers[3]);
+        for (i = 0; i < (int) suppliers->limit; i++) {
+            if (registryName(suppliers, i) != NULL) {
+                printf("%d - %s\n", i + 1, registryName(suppliers, i));
+            }
+        }
+        printf("%d - Exit\n", suppliers->limit + 1);
         printf("======================================================\n\r");
         valueRead = scanf("%d%c", &choice, &followChar);
         if (valueRead == 2) {
-            if (isspace(followChar) && choice > 0 && choice < 6) {
+            if (isspace(followChar) && choice > 0 && choice <= (int) suppliers->limit + 1
+                    && (choice == (int) suppliers->limit + 1 || registryName(suppliers, choice - 1) != NULL)) {
                 /*Integer followed by whitespace*/
                 valid = 1;
             } else {
@@ -440,7 +895,8 @@ int supplierSelect(const char** suppliers) {
                 printf("Only defined integer values will be accepted, please try again.\n\r");
                 fflush(stdin);
             }
-        } else if (valueRead == 1 && choice > 0 && choice < 6) {
+        } else if (valueRead == 1 && choice > 0 && choice <= (int) suppliers->limit + 1
+                && (choice == (int) suppliers->limit + 1 || registryName(suppliers, choice - 1) != NULL)) {
             /*Integer followed by nothing*/
             valid = 1;
         } else {
@@ -449,13 +905,41 @@ int supplierSelect(const char** suppliers) {
             fflush(stdin);
         }
     } while (valid == 0);
-    if (choice == 1 || choice == 2 || choice == 3 || choice == 4) {
+    if (choice <= (int) suppliers->limit) {
         return choice;
     } else {
         exit(0);
     }
 }
 
+int loadSuppliers(registry* suppliers) {
+    /*
+    Name: loadSuppliers
+    Function: Read the supplier registry, passed to the library functions that map supplier names to ids
+    Paramaters: registry* suppliers - Pointer to the registry to fill
+    Variables: fileName, line, status
+    The registry is read from the file named by the RESISTOR_SUPPLIERS environment variable, or suppliers.cfg in the working directory.
+    Without either the built in suppliers are used. Returns 0 on success, 1 (after printing the reason) if the file is invalid
+     */
+    const char* fileName = getenv(REGISTRY_ENV);
+    long line;
+    int status;
+
+    status = registryLoad(suppliers, fileName != NULL ? fileName : REGISTRY_FILE, &line);
+    if (status < 0 && fileName != NULL) {
+        fprintf(stderr, "Unable to read the supplier list %s\n", fileName);
+        return 1;
+    }
+    if (status > 0) {
+        fprintf(stderr, "%s line %ld: %s\n", fileName != NULL ? fileName : REGISTRY_FILE, line, registryErrors[status]);
+        return 1;
+    }
+    if (status < 0) {
+        registryDefaults(suppliers);
+    }
+    return 0;
+}
+
 void fourBands(const char** bandColours, const char** multiplierColours, const char** toleranceColours, int bCLen, int mCLen, int tCLen, data* d) {
     /*
     Name: fourBands
@@ -541,7 +1025,7 @@ int bandInput(const char** colours, int arrLen, int bandNum) {
         printf("Please input a colour value of band %d using the table provided: ", bandNum);
         valueRead = scanf("%d%c", &userInput, &followChar);
         if (valueRead == 2) {
-            if (isspace(followChar) && (userInput >= 0 || userInput <= arrLen)) {
+            if (isspace(followChar) && (userInput >= 0 && userInput < arrLen)) {
                 /*nteger followed by whitespace*/
                 pass = 1;
             } else {
@@ -549,7 +1033,7 @@ int bandInput(const char** colours, int arrLen, int bandNum) {
                 printf("Only defined integer values will be accepted, please try again.\n\r");
                 fflush(stdin);
             }
-        } else if (valueRead == 1 && (userInput >= 0 || userInput <= arrLen)) {
+        } else if (valueRead == 1 && (userInput >= 0 && userInput < arrLen)) {
             /*Integer followed by nothing*/
             pass = 1;
         } else {
@@ -576,197 +1060,3944 @@ double actualValInp(int i) {
             fflush(stdin);
             printf("Invalid value given, please try again\n\r");
         }
-    } while (userInput < 0);
+    } while (userInput < 0 || !isfinite(userInput));
     return userInput;
 }
 
-double idealVal(int bandOne, int bandTwo, int bandThree, int bandFour, int bands) {
+int decodeFile(const char* fileName) {
     /*
-    Name: idealVal
-    Function: to return the nominal value based on the number of bands and the colours given
-    Paramaters: int bandOne, int bandTwo, int bandThree, int bandFout, int bands
-    Variables: ideal
-    Function will return the nominal value based on the colours of the bands input by using one of two cases (4 or 5/6 bands)
-    If 4 bands is the case, the program will use multVal on band 3 to find its multiplier value and will use this in the calculation, otherwise, band 4 will be passed to multVal
+    Name: decodeFile
+    Function: Decode a file of band codes (one per line, as digits) and print nominal,tolerance,tempco for each, or the error
+    Paramaters: const char* fileName - File of band codes ("-" for stdin)
+    Variables: fp, line, codes, nominal, tolerance, tempco, status, valid, count, i, len
+    Codes are decoded in chunks of DECODE_CHUNK with decodeBands(). Returns 0 on success, 1 if the file can't be read
      */
-    double ideal;
-    switch (bands) {
-        case 4:
-            ideal = (bandOne * 10 + bandTwo) * multVal(bandThree);
-            return ideal;
-            break;
-        case 5:
-            ideal = ((bandOne * 100) + (bandTwo * 10) + bandThree) * multVal(bandFour);
-            return ideal;
-            break;
-        case 6:
-        	ideal = ((bandOne * 100) + (bandTwo * 10) + bandThree) * multVal(bandFour);
-            return ideal;
-            break;
+    FILE* fp = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "r");
+    char line[64];
+    static bandCode codes[DECODE_CHUNK];
+    static double nominal[DECODE_CHUNK], tolerance[DECODE_CHUNK];
+    static int tempco[DECODE_CHUNK];
+    static unsigned char status[DECODE_CHUNK], valid[DECODE_CHUNK];
+    long count, i;
+    size_t len;
+
+    if (fp == NULL) {
+        fprintf(stderr, "Unable to read %s\n", fileName);
+        return 1;
     }
+    do {
+        for (count = 0; count < DECODE_CHUNK && fgets(line, sizeof(line), fp) != NULL; count++) {
+            len = strcspn(line, "\r\n");
+            valid[count] = (unsigned char) parseBandCode(line, len, &codes[count]);
+            if (!valid[count]) {
+                memset(&codes[count], 0, sizeof(codes[count]));
+            }
+        }
+        decodeBands(codes, count, nominal, tolerance, tempco, status);
+        for (i = 0; i < count; i++) {
+            if (!valid[i] || status[i] != DECODE_OK) {
+                printf("error,%s\n", decodeErrors[valid[i] ? status[i] : DECODE_BAD_BANDS]);
+            } else {
+                printf("%f,%f,%d\n", nominal[i], tolerance[i], tempco[i]);
+            }
+        }
+    } while (count == DECODE_CHUNK);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return 0;
 }
 
-double multVal(int value) {
+int identifyFile(const char* fileName, const struct standardSeries* series, int tolerance, const char** bandColours, const char** multiplierColours, const char** toleranceColours) {
     /*
-    Name: multVal
-    Function: Return the value of the multiplier band
-    Paramaters: int value
-    Variables: -
-    Function will return the value of the multiplier based on an integer input that would represent the index of a colour in the multiplierColours array 
+    Name: identifyFile
+    Function: Print the nearest standard value, band code and colours for each measured value in a file (one per line)
+    Paramaters: const char* fileName - File of values ("-" for stdin), const struct standardSeries* series - Series to match against
+                            int tolerance - Index of the tolerance colour, const char** bandColours, const char** multiplierColours, const char** toleranceColours - Colour names
+    Variables: fp, line, readings, matches, count, i, b, ok, len
+    Values are matched in chunks of DECODE_CHUNK with matchStandard(). Returns 0 on success, 1 if the file can't be read
      */
-    switch (value) {
-        case 0:
-            return 0.01;
-            break;
-        case 1:
-            return 0.1;
-            break;
-        case 2:
-            return 1;
-            break;
-        case 3:
-            return 10;
-            break;
-        case 4:
-            return 100;
-            break;
-        case 5:
-            return 1000;
-            break;
-        case 6:
-            return 10000;
-            break;
-        case 7:
-            return 100000;
-            break;
-        case 8:
-            return 1000000;
-            break;
-        case 9:
-            return 10000000;
-            break;
-        default:
-        	printf("Invalid value, cannot determine the multipier\n\r");
+    FILE* fp = strcmp(fileName, "-") == 0 ? stdin : fopen(fileName, "r");
+    char line[64];
+    static double readings[DECODE_CHUNK];
+    static standardMatch matches[DECODE_CHUNK];
+    long count, i;
+    int b, ok;
+    size_t len;
+
+    if (fp == NULL) {
+        fprintf(stderr, "Unable to read %s\n", fileName);
+        return 1;
+    }
+    do {
+        count = 0;
+        while (count < DECODE_CHUNK && fgets(line, sizeof(line), fp) != NULL) {
+            len = strcspn(line, "\r\n");
+            readings[count] = parseReading(line, line + len, &ok);
+            if (ok && readings[count] > 0) {
+                count++;
+            } else if (len > 0) {
+                fprintf(stderr, "Invalid resistance value %.*s\n", (int) len, line);
+            }
+        }
+        matchStandard(readings, count, series, tolerance, matches);
+        for (i = 0; i < count; i++) {
+            printf("%f,%s,%f,", readings[i], series->name, matches[i].nominal);
+            for (b = 0; b < matches[i].code.bands; b++) {
+                printf("%d", matches[i].code.colour[b]);
+            }
+            for (b = 0; b < matches[i].code.bands - 2; b++) {
+                printf(",%s", bandColours[matches[i].code.colour[b]]);
+            }
+            printf(",%s,%s,%s\n", multiplierColours[matches[i].code.colour[b]], toleranceColours[matches[i].code.colour[b + 1]],
+                    matches[i].inTolerance ? "within tolerance" : "outside tolerance");
+        }
+    } while (count == DECODE_CHUNK);
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return 0;
+}
+
+int measureBatch(data* d, const samplingPlan* plan) {
+    /*
+    Name: measureBatch
+    Function: Read the actual values for the sample and record the failure rate and statistics of the batch
+    Paramaters: data* d - Pointer to a structure with the nominal value and tolerance already set
+                            const samplingPlan* plan - Sampling plan deciding how many readings are taken (NULL for 10)
+    Variables: i, readings[], reading, lower, upper, failMask, sample, progress
+    Without a plan the 10 readings are read, then checked and their statistics calculated with evaluateBatch(). With one, each
+    reading is checked as it is entered and no more are asked for once the plan has accepted or rejected the batch
+    Returns the plan's decision (PLAN_MORE without a plan)
+     */
+    int i;
+    double readings[10], reading, lower, upper;
+    unsigned char failMask;
+    stats sample;
+    planProgress progress;
+
+    if (plan == NULL) {
+        for (i = 0; i < 10; i++) {
+            readings[i] = actualValInp(i);
+        }
+        evaluateBatch(d, readings, 10);
+        return PLAN_MORE;
+    }
+    lower = minTolVal(d->nominalValue, d->tolerance);
+    upper = maxTolVal(d->nominalValue, d->tolerance);
+    statsInit(&sample);
+    planStart(&progress);
+    for (i = 0; progress.decision == PLAN_MORE; i++) {
+        reading = actualValInp(i);
+        classifyReadings(&reading, 1, lower, upper, &failMask);
+        planAdd(plan, &progress, &failMask, 1);
+        statsAdd(&sample, reading);
     }
+    setBatchStats(d, &sample, progress.defects);
+    return progress.decision;
 }
 
-double tolVal(int value) {
+void printPlan(FILE* out, const samplingPlan* p) {
     /*
-    Name: tolVal
-    Function: Return the value of the tolerance band
-    Paramaters: int value
+    Name: printPlan
+    Function: Describe a sampling plan
+    Paramaters: FILE* out - Where to print it, const samplingPlan* p - Pointer to the plan
     Variables: -
-    Function will return the value of the tolerance based on an integer input that would represent the index of a colour in the toleranceColours array
      */
-    switch (value) {
-        case 0:
-            return 0.1;
-            break;
-        case 1:
-            return 0.05;
-            break;
-        case 2:
-            return 0.01;
-            break;
-        case 3:
-            return 0.02;
-            break;
-        case 4:
-            return 0.005;
-            break;
-        case 5:
-            return 0.0025;
-            break;
-        case 6:
-            return 0.001;
-            break;
-         default:
-        	printf("Invalid value, cannot determine the tolerance\n\r");
+    if (p->type == PLAN_SPRT) {
+        fprintf(out, "Sampling plan - sequential test, accept at %g%% outside tolerance, reject at %g%% (risks %g%% and %g%%), at most %ld readings\n",
+                100 * p->p0, 100 * p->p1, 100 * p->alpha, 100 * p->beta, p->limit);
+    } else if (p->type == PLAN_SINGLE) {
+        fprintf(out, "Sampling plan - Z1.4 single sampling (AQL %g%%), %ld readings, accept with at most %ld outside tolerance\n",
+                p->aql, p->sample[0], p->accept[0]);
+    } else {
+        fprintf(out, "Sampling plan - Z1.4 double sampling (AQL %g%%), %ld readings, accept with at most %ld outside tolerance, reject with %ld,"
+                " otherwise %ld more readings and accept with at most %ld in all\n", p->aql, p->sample[0], p->accept[0], p->reject[0],
+                p->sample[1] - p->sample[0], p->accept[1]);
+    }
+}
+
+void writeRecord(FILE* fp, data* d) {
+    /*
+    Name: writeRecord
+    Function: Write a batch to a log in the eight line text format read back by options 3 and 4
+    Paramaters: FILE* fp - Open log file, data* d - Pointer to the structure to write
+    Variables: date
+     */
+    char date[9];
+    int bytes;
+    PROFILE_TIMER(timer);
+
+    PROFILE_BEGIN(timer);
+    bytes = fprintf(fp, "%s\n%s\n%f\n%lf\n%f\n%lf\n%lf\n%lf\n", d->company, formatDate(d->day, date), d->failureRate, d->nominalValue, d->tolerance, d->meanResistance, d->standDevResistance, d->varianceResistance);
+    PROFILE_END(PROFILE_APPEND, timer, 1, bytes);
+}
+
+FILE* openTextLog(const char* fileName) {
+    /*
+    Name: openTextLog
+    Function: Open a text log for appending, first cutting off a record left incomplete by a crash
+    Paramaters: const char* fileName - Log name
+    Variables: fp, buffer, got, p, end, lines, offset, complete
+    Options 3 and 4 read text logs TEXT_LOG_LINES lines at a time, so a torn record at the end would misalign every record added after it.
+    The file is scanned once for line ends and truncated after the last complete record (on POSIX systems, elsewhere it is only reported).
+    Returns the log opened for appending, or NULL if it can't be opened
+     */
+    FILE* fp = fopen(fileName, "rb");
+    char *buffer, *p, *end;
+    size_t got;
+    long lines = 0, offset = 0, complete = 0;
+
+    buffer = fp == NULL ? NULL : malloc(TEXT_LOG_SCAN);
+    if (buffer != NULL) {
+        while ((got = fread(buffer, 1, TEXT_LOG_SCAN, fp)) > 0) {
+            end = buffer + got;
+            for (p = memchr(buffer, '\n', got); p != NULL; p = memchr(p + 1, '\n', end - p - 1)) {
+                if (++lines % TEXT_LOG_LINES == 0) {
+                    complete = offset + (p - buffer) + 1;
+                }
+            }
+            offset += (long) got;
+        }
+        free(buffer);
+        if (complete < offset) {
+#ifdef LOG_TRUNCATE
+            if (truncate(fileName, complete) == 0) {
+                fprintf(stderr, "Removed an incomplete record (%ld bytes) from the end of %s\n", offset - complete, fileName);
+            }
+#else
+            fprintf(stderr, "%s ends with an incomplete record (%ld bytes), remove it before viewing the log\n", fileName, offset - complete);
+#endif
+        }
+    }
+    if (fp != NULL) {
+        fclose(fp);
     }
+    return fopen(fileName, "a");
 }
 
-int tempVal(int value) {
+int openLog(const char* fileName, const registry* suppliers, FILE** fp, logWriter* log, long syncRecords, long syncMillis) {
     /*
-    Name: tempVal
-    Function: Return the value of the temperature band
-    Paramaters: int value
+    Name: openLog
+    Function: Open a log for appending, in the binary format if the name has the binary log extension, otherwise as a text log
+    Paramaters: const char* fileName - Log name, const registry* suppliers - Supplier ids of a binary log
+                            FILE** fp - Set to the text log (NULL for a binary log), logWriter* log - Writer for a binary log
+                            long syncRecords, long syncMillis - Group commit interval of a binary log's journal (see logWriterSync())
     Variables: -
-    Function will return the value of the temperature based on an integer inpur that would represent the index of a colour in the temperatureColours array 
+    Records a binary log recovers from its journal are reported on stderr. Returns 0 on success, 1 if the log can't be opened
      */
-    switch (value) {
-        case 0:
-            return 100;
-            break;
-        case 1:
-            return 50;
-            break;
-        case 2:
-            return 15;
-            break;
-        case 3:
-            return 25;
-            break;
-        default:
-        	printf("Invalid value, cannot determine the temperature tolerance\n\r");
+    if (!isBinaryLog(fileName)) {
+        *fp = openTextLog(fileName);
+        return *fp == NULL;
+    }
+    *fp = NULL;
+    if (logWriterOpen(log, fileName, suppliers) != 0) {
+        return 1;
     }
+    if (log->recovered > 0) {
+        fprintf(stderr, "Recovered %ld records from the journal of %s\n", log->recovered, fileName);
+    }
+    logWriterSync(log, syncRecords, syncMillis);
+    return 0;
 }
 
-double minTolVal(double a, float b) {
+void sinkInit(sinks* s, const registry* suppliers) {
     /*
-    Name: minTolVal
-    Function: Return the minimum tolerance value of the batch
-    Paramaters: double a, double b
+    Name: sinkInit
+    Function: Set the defaults of the outputs of --ingest, --serve and --rig: records to stdout, no charts, sketches, archive or plan
+    Paramaters: sinks* s - Pointer to the settings, const registry* suppliers - Supplier names and ids of the records
     Variables: -
-    Function will calulate and return the minimum tolerance value
      */
-    return a - a * b;
+    memset(s, 0, sizeof(*s));
+    s->suppliers = suppliers;
+    s->syncRecords = WAL_SYNC_RECORDS;
+    s->syncMillis = WAL_SYNC_MS;
+    s->out = stdout;
 }
 
-double maxTolVal(double a, float b) {
+int sinkOption(sinks* s, const char* option, const char* value) {
     /*
-    Name: maxTolVal
-    Function: Return the maximum tolerance value of the batch
-    Paramaters: double a, double b
+    Name: sinkOption
+    Function: Apply one of the output options shared by --ingest, --serve and --rig
+    Paramaters: sinks* s - Pointer to the settings, const char* option - Option name, const char* value - Its value
     Variables: -
-    Function will calculate and return the maximum tolerance value
+    The options are --log, --sync, --sync-ms, --spc, --sketch, --archive and --plan, files are only opened by openSinks().
+    Returns 0 if the option was applied, 1 if it isn't one of these or its value is invalid
      */
-    return a + a * b;
+    if (strcmp(option, "--log") == 0) {
+        s->logName = value;
+    } else if (strcmp(option, "--sync") == 0 && isdigit((unsigned char) value[0])) {
+        s->syncRecords = atol(value);
+    } else if (strcmp(option, "--sync-ms") == 0 && isdigit((unsigned char) value[0])) {
+        s->syncMillis = atol(value);
+    } else if (strcmp(option, "--spc") == 0) {
+        s->chartName = value;
+    } else if (strcmp(option, "--sketch") == 0) {
+        s->sketchName = value;
+    } else if (strcmp(option, "--archive") == 0) {
+        s->archiveName = value;
+    } else if (strcmp(option, "--plan") == 0 && planParse(&s->plan, value) == 0) {
+        s->hasPlan = 1;
+    } else {
+        return 1;
+    }
+    return 0;
 }
 
-double sampleMean(double a[10]) {
+int openSinks(sinks* s) {
     /*
-    Name: sampleMean
-    Function: Return the mean for the batch
-    Paramaters: double a[]
-    Variables: i
-    Function will calculate and return the mean value for the 10 actual values that have been input
+    Name: openSinks
+    Function: Open the charts, sketches, archive and log given by sinkOption()
+    Paramaters: sinks* s - Pointer to the settings
+    Variables: failed
+    Anything opened before a failure is released again without being saved (sinkInit() zeroed the tables, so they can always be freed).
+    Returns 0 on success, 1 (after printing the reason) on failure
      */
-    int i;
-    double mean, tot = 0;
-    for (i = 0; i < 10; i++) {
-        tot += a[i];
+    int failed = s->chartName != NULL && openCharts(&s->charts, s->chartName) != 0;
+
+    if (!failed && s->sketchName != NULL) {
+        failed = openSketches(&s->sketches, s->sketchName) != 0;
+    }
+    if (!failed && s->archiveName != NULL) {
+        failed = openArchive(&s->archive, s->archiveName) != 0;
+    }
+    if (!failed && s->logName != NULL) {
+        s->binary = isBinaryLog(s->logName);
+        failed = openLog(s->logName, s->suppliers, &s->out, &s->log, s->syncRecords, s->syncMillis) != 0;
+        if (failed) {
+            fprintf(stderr, "Unable to open log %s\n", s->logName);
+        }
+    }
+    if (failed) {
+        spcFree(&s->charts);
+        sketchTableFree(&s->sketches);
+        if (s->archive != NULL) {
+            fclose(s->archive);
+        }
+        sinkInit(s, s->suppliers);
     }
-    mean = tot / 10;
-    return mean;
+    return failed;
 }
 
-float sampleStandDev(double a[10], double mean) {
+int closeSinks(sinks* s) {
     /*
-    Name: sampleStandDev
-    Function: Return the standard deviation for the batch
-    Paramaters: double a[], double mean
-    Variables: i, tot
-    Function will calculate and return the standard deviation for the 10 actual values that have been input
+    Name: closeSinks
+    Function: Close the log and archive and save the charts and sketches opened by openSinks()
+    Paramaters: sinks* s - Pointer to the settings
+    Variables: failed
+    Returns 0 on success, 1 (after printing the reason) if any of them can't be written
      */
-    int i;
-    double tot = 0;
-    float standDev;
-    for (i = 0; i < 10; i++) {
-        tot += pow(a[i] - mean, 2);
+    int failed = 0;
+
+    if (s->binary && logWriterClose(&s->log) != 0) {
+        fprintf(stderr, "Unable to write the log %s\n", s->logName);
+        failed = 1;
+    } else if (!s->binary && s->out != stdout && fclose(s->out) != 0) {
+        fprintf(stderr, "Unable to write the log %s\n", s->logName);
+        failed = 1;
+    }
+    if (s->chartName != NULL && closeCharts(&s->charts, s->chartName) != 0) {
+        failed = 1;
+    }
+    if (s->sketchName != NULL && closeSketches(&s->sketches, s->sketchName) != 0) {
+        failed = 1;
+    }
+    if (s->archive != NULL && fclose(s->archive) != 0) {
+        fprintf(stderr, "Unable to write the archive %s\n", s->archiveName);
+        failed = 1;
     }
-    standDev = tot / 10;
-    return standDev;
+    s->out = stdout;
+    s->archive = NULL;
+    return failed;
 }
 
+void usage(const char* name) {
+    /*
+    Name: usage
+    Function: Print the command line options for the non-interactive modes
+    Paramaters: const char* name - Program name (argv[0])
+    Variables: -
+     */
+    fprintf(stderr, "Usage: %s                                    interactive menu\n", name);
+    fprintf(stderr, "       %s --profile [--profile-dump <file>] [--profile-every <seconds>] <any of the options below>\n", name);
+    fprintf(stderr, "             time spent in each stage printed at exit (and written to the dump file every %d s), needs -DRESISTOR_PROFILE\n",
+            PROFILE_DUMP_SECONDS);
+    fprintf(stderr, "       %s --ingest <measurements> [--log <file>] [--threads <n>] [--sync <records>] [--sync-ms <ms>] [--spc <charts>]\n", name);
+    fprintf(stderr, "             [--sketch <sketches>] [--archive <archive>] [--plan <plan>]\n");
+    fprintf(stderr, "       %s --plan <plan>                         interactive menu, measuring each batch until the plan decides it\n", name);
+    fprintf(stderr, "       %s --view <log> [supplier]               the log's records, as options 3 and 4 show them\n", name);
+    fprintf(stderr, "       %s --decode <codes>                      one band code per line, prints nominal,tolerance,tempco\n", name);
+    fprintf(stderr, "       %s --identify <readings> <E12|E24|E96> [tolerance index]   nearest standard value for each reading\n", name);
+    fprintf(stderr, "       %s --range <log> <from ddMMyyyy> <to ddMMyyyy> [supplier]\n", name);
+    fprintf(stderr, "       %s --recent <log> <days> [supplier]\n", name);
+    fprintf(stderr, "       %s --summary <log> [supplier]\n", name);
+    fprintf(stderr, "       %s --spc <charts>                        control charts saved by --ingest or --serve with --spc\n", name);
+    fprintf(stderr, "       %s --quantiles <sketches> [<sketches> ..]   deviation from nominal quantiles per supplier, merging the files\n", name);
+    fprintf(stderr, "       %s --histogram <supplier> <sketches> [<sketches> ..]   histogram of the supplier's deviation from nominal\n", name);
+    fprintf(stderr, "       %s --archive <archive> [supplier]        every archived batch re-analysed from its raw readings\n", name);
+    fprintf(stderr, "       %s --readings <archive> <batch>          raw readings of an archived batch (numbered from 1)\n", name);
+    fprintf(stderr, "       %s --query <log> <all|supplier,month,tolerance,nominal>   grouped batch counts, failure rates and deviation from nominal\n", name);
+    fprintf(stderr, "       %s --bench [max records]                 benchmarks as JSON, end to end on logs of 10^4 to max (default 10^6) records\n", name);
+    fprintf(stderr, "       %s --generate <measurements|log> <batches> [--out <file>] [--seed <n>] [--suppliers <a,b,..>] [--bands <1041,..>]\n", name);
+    fprintf(stderr, "             [--tolerances <index,..>] [--readings <n>] [--per-day <n>] [--start <ddMMyyyy>] [--defects <%%>] [--outliers <%%>]\n");
+    fprintf(stderr, "             [--spread <sd / half tolerance>] [--drift <half tolerances per 1000 batches>]   synthetic data for load testing\n");
+    fprintf(stderr, "       %s --serve <socket path|port> [--log <file>] [--threads <n>] [--sync <records>] [--sync-ms <ms>] [--spc <charts>]\n", name);
+    fprintf(stderr, "             [--sketch <sketches>] [--archive <archive>] [--plan <plan>]   acceptance service for many test stations (Linux)\n");
+    fprintf(stderr, "       %s --submit <socket path|port>           send batches from stdin (supplier,date,bands,reading,reading,...) to the service\n", name);
+    fprintf(stderr, "       %s --rig <source> [<source> ..] [--log <file>] [--idle <ms>] [--follow] [--sync <records>] [--sync-ms <ms>]\n", name);
+    fprintf(stderr, "             [--spc <charts>] [--sketch <sketches>] [--archive <archive>] [--plan <plan>]   measurements from many instruments (Linux)\n");
+    fprintf(stderr, "       %s --replay <measurements> <target> [<target> ..] [--rate <readings a second>]   simulated instruments for --rig\n", name);
+    fprintf(stderr, "--view, --range, --recent and --archive also take [--format table|csv|json] [--offset <rows>] [--limit <rows>] to write\n");
+    fprintf(stderr, "             CSV or JSON and page through long reports.\n");
+    fprintf(stderr, "Logs named *%s are written in the binary column format, other logs use the text format of option 2.\n", LOG_EXTENSION);
+    fprintf(stderr, "Measurement files hold one reading per line: supplier,date,bands,reading (tabs may be used instead of commas).\n");
+    fprintf(stderr, "bands is the menu index of each band colour as digits, e.g. 1041 for a 4 band Brown Black Red Gold (1k 5%%) resistor.\n");
+    fprintf(stderr, "Consecutive lines with the same supplier, date and bands form one batch. Blank lines and lines starting with # are ignored.\n");
+    fprintf(stderr, "--threads splits a measurement file between n threads, the records are written in the same order as a single thread.\n");
+    fprintf(stderr, "--sync and --sync-ms set how often a binary log's journal is synced to disk (default every %d records or %d ms, 0 records turns it off).\n",
+            WAL_SYNC_RECORDS, WAL_SYNC_MS);
+    fprintf(stderr, "--spc keeps EWMA and CUSUM control charts of every supplier and nominal value in the charts file and reports alerts on stderr.\n");
+    fprintf(stderr, "--sketch keeps a quantile sketch and histogram of (reading - nominal) / nominal for every supplier with an id in the sketch file.\n");
+    fprintf(stderr, "--archive appends every reading used (to %g ppm of nominal) to the archive, about 2.5 bytes a reading plus a 32 byte header a batch.\n",
+            ARCHIVE_RESOLUTION * 1e6);
+    fprintf(stderr, "--rig reads each source (a FIFO, created if missing, \"-\" for stdin, or a file) as a station with its own batches, in the\n");
+    fprintf(stderr, "             --ingest format. A batch also ends after --idle ms without readings (default %d, 0 never) and when its writer closes.\n",
+            RIG_IDLE_MS);
+    fprintf(stderr, "             The rig stops when every source has ended, or with --follow reopens FIFOs, waits for more of files and stops on SIGINT.\n");
+    fprintf(stderr, "--replay deals the file's batches to the targets in turn and writes each at --rate readings a second (default %d, 0 unpaced).\n",
+            RIG_REPLAY_RATE);
+    fprintf(stderr, "--plan stops using a batch's readings once it can be accepted or rejected: sprt:<p0 %%>,<p1 %%>[,<alpha %%>,<beta %%>[,<most readings>]]\n");
+    fprintf(stderr, "             (sequential test, default risks %g%% and %g%%), single:<lot size>,<AQL %%> or double:<lot size>,<AQL %%> (ANSI/ASQ Z1.4).\n",
+            100 * PLAN_SPRT_ALPHA, 100 * PLAN_SPRT_BETA);
+    fprintf(stderr, "Suppliers are read from %s (or the file named by %s), one \"id,name\" or \"name\" per line, ids 0 to %d.\n",
+            REGISTRY_FILE, REGISTRY_ENV, INDEX_SUPPLIERS - 1);
+}
+
+int ingestFile(const char* fileName, const registry* suppliers, FILE* out, logWriter* log, spcTable* charts, sketchTable* sketches, FILE* archive,
+        const samplingPlan* plan) {
+    /*
+    Name: ingestFile
+    Function: Stream a measurement file through the batch calculations and write one record per batch
+    Paramaters: const char* fileName - Measurement file ("-" for stdin), const registry* suppliers - Supplier ids for the charts, sketches and archive
+                            FILE* out - Destination for the records (text log format)
+                            logWriter* log - Binary log to append the records to instead of out (NULL to use out)
+                            spcTable* charts - Control charts to add the readings to (NULL for none)
+                            sketchTable* sketches - Sketches of deviation from nominal to add the readings to (NULL for none)
+                            FILE* archive - Raw reading archive to append each batch's readings to (NULL for none, see openArchive())
+                            const samplingPlan* plan - Sampling plan deciding each batch (NULL to use every reading)
+    Variables: state, frames, buf, carry, got, start, end, lineEnd, lines
+    The file is read in INGEST_BUFFER_SIZE chunks and only complete lines are processed, the partial line at the end of a chunk
+    is moved to the front of the buffer for the next read. Memory use is fixed regardless of file or batch size.
+    Returns 0 on success, 1 if the file can't be read
+     */
+    ingest state;
+    archiveBuffer frames;
+    FILE* fp;
+    char* buf;
+    const char *start, *end, *lineEnd;
+    size_t carry = 0, got;
+    long lines;
+    PROFILE_TIMER(timer);
+
+    if (strcmp(fileName, "-") == 0) {
+        fp = stdin;
+    } else {
+        fp = fopen(fileName, "rb");
+    }
+    buf = malloc(INGEST_BUFFER_SIZE);
+    if (fp == NULL || buf == NULL) {
+        fprintf(stderr, "Unable to read measurement file %s\n", fileName);
+        free(buf);
+        return 1;
+    }
+    memset(&state, 0, sizeof(state));
+    state.out = out;
+    state.suppliers = suppliers;
+    state.log = log;
+    state.charts = charts;
+    state.sketches = sketches;
+    state.plan = plan;
+    archiveInit(&frames);
+    if (archive != NULL) {
+        state.archive = &frames;
+        state.archiveFile = archive;
+    }
+
+    while ((got = fread(buf + carry, 1, INGEST_BUFFER_SIZE - carry, fp)) > 0 || carry > 0) {
+        start = buf;
+        end = buf + carry + got;
+        lines = state.line;
+        PROFILE_BEGIN(timer);
+        while ((lineEnd = memchr(start, '\n', end - start)) != NULL) {
+            state.line++;
+            ingestLine(&state, start, lineEnd);
+            start = lineEnd + 1;
+        }
+        PROFILE_END(PROFILE_PARSE, timer, state.line - lines, start - buf);
+        carry = end - start;
+        if (got == 0) {
+            /*Last line without a newline*/
+            state.line++;
+            ingestLine(&state, start, end);
+            carry = 0;
+        } else if (carry == INGEST_BUFFER_SIZE) {
+            fprintf(stderr, "Line %ld is too long, skipping it\n", state.line + 1);
+            do {
+                got = fread(buf, 1, INGEST_BUFFER_SIZE, fp);
+                start = memchr(buf, '\n', got);
+            } while (got > 0 && start == NULL);
+            state.line++;
+            carry = start == NULL ? 0 : got - (start + 1 - buf);
+            memmove(buf, start == NULL ? buf : start + 1, carry);
+        } else {
+            memmove(buf, start, carry);
+        }
+    }
+    if (state.valid) {
+        ingestBatchEnd(&state);
+    }
+    if (plan != NULL) {
+        ingestDecisions(&state);
+    }
+    if (frames.failed) {
+        fprintf(stderr, "Not enough memory to archive %s, some batches are missing from the archive\n", fileName);
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    archiveFree(&frames);
+    free(buf);
+    return 0;
+}
 
+void ingestLine(ingest* s, const char* line, const char* end) {
+    /*
+    Name: ingestLine
+    Function: Process a single measurement line
+    Paramaters: ingest* s - Pointer to the ingestion state, const char* line, const char* end - Line contents (end excludes the newline)
+    Variables: p, keyLen, ok, reading
+    The supplier, date and bands (the batch key) are compared with the batch in progress as raw bytes. Only a change of key
+    decodes the bands and tolerance limits again, so the per reading cost is the key compare, the number parse and the limit check
+     */
+    const char* p;
+    int keyLen, ok;
+    double reading;
 
+    while (end > line && (end[-1] == '\r' || end[-1] == ' ')) {
+        end--;
+    }
+    keyLen = ingestKey(line, end);
+    if (keyLen == 0) {
+        return;
+    }
+    if (keyLen < 0) {
+        ingestError(s, "expected supplier,date,bands,reading", NULL);
+        return;
+    }
+    p = line + keyLen;
+    if (p - line != s->keyLen || p - line > INGEST_KEY_MAX || memcmp(line, s->key, p - line) != 0) {
+        if (s->valid) {
+            ingestBatchEnd(s);
+        }
+        s->valid = 0;
+        if (p - line > INGEST_KEY_MAX) {
+            ingestError(s, "batch details are too long", NULL);
+            s->keyLen = 0;
+            return;
+        }
+        memcpy(s->key, line, p - line);
+        s->keyLen = p - line;
+        s->valid = ingestBatchStart(s, line, p);
+    }
+    if (!s->valid) {
+        return;
+    }
+    reading = parseReading(p + 1, end, &ok);
+    if (!ok || reading < 0) {
+        ingestError(s, "invalid resistance value", NULL);
+        return;
+    }
+    s->readings[s->pending++] = reading;
+    if (s->pending == INGEST_CHUNK) {
+        ingestFlush(s);
+    }
+}
+
+int ingestBatchStart(ingest* s, const char* key, const char* end) {
+    /*
+    Name: ingestBatchStart
+    Function: Decode the supplier, date and bands of a new batch
+    Paramaters: ingest* s - Pointer to the ingestion state, const char* key, const char* end - supplier,date,bands text
+    Variables: field, len, i, n, code, tempco, status
+    The date is validated by parseDate() as in dateInput() and the bands are decoded by decodeBands(). The batch's control chart and
+    its supplier's sketch (if they are kept and the supplier has an id) are looked up once here, and the batch's archive frame begun.
+    Returns 1 if the batch is valid, otherwise 0 and its readings are skipped
+     */
+    const char* field[3];
+    int len[3], i, n = 0, tempco;
+    const char* p = key;
+    bandCode code;
+    unsigned char status = DECODE_BAD_BANDS;
+
+    for (i = 0; i < 3; i++) {
+        field[i] = p;
+        while (p < end && *p != ',' && *p != '\t') {
+            p++;
+        }
+        len[i] = p - field[i];
+        p++;
+    }
+    memset(&s->batch, 0, sizeof(s->batch));
+    s->fail = 0;
+    s->pending = 0;
+    s->chart = -1;
+    s->sketch = NULL;
+    statsInit(&s->sample);
+    planStart(&s->progress);
+
+    n = len[0] < (int) sizeof(s->batch.company) - 1 ? len[0] : (int) sizeof(s->batch.company) - 1;
+    memcpy(s->batch.company, field[0], n);
+    s->batch.company[n] = '\0';
+
+    if (!parseDate(field[1], len[1], &s->batch.day)) {
+        ingestError(s, "invalid date, batch skipped (format ddMMyyyy)", NULL);
+        return 0;
+    }
+
+    if (parseBandCode(field[2], len[2], &code)) {
+        decodeBands(&code, 1, &s->batch.nominalValue, &s->batch.tolerance, &tempco, &status);
+    }
+    if (status != DECODE_OK) {
+        ingestError(s, "%s, batch skipped", decodeErrors[status]);
+        return 0;
+    }
+    s->lower = minTolVal(s->batch.nominalValue, s->batch.tolerance);
+    s->upper = maxTolVal(s->batch.nominalValue, s->batch.tolerance);
+    if (s->charts != NULL && (n = supplierId(s->suppliers, s->batch.company)) >= 0) {
+        s->chart = spcFind(s->charts, n, s->batch.nominalValue, s->batch.tolerance);
+    }
+    if (s->sketches != NULL && (n = supplierId(s->suppliers, s->batch.company)) >= 0) {
+        s->sketch = sketchFind(s->sketches, n);
+    }
+    if (s->archive != NULL) {
+        archiveBegin(s->archive, s->batch.nominalValue);
+    }
+    return 1;
+}
+
+void ingestBatchEnd(ingest* s) {
+    /*
+    Name: ingestBatchEnd
+    Function: Finish the batch in progress and write its record
+    Paramaters: ingest* s - Pointer to the ingestion state
+    Variables: part, r, frame
+    A batch still undecided by a sampling plan is finished with planFinish(). A worker thread's record (and archive frame) is
+    kept in its part for ingestParallel() to write
+     */
+    ingestPart* part = s->part;
+    ingestResult* r;
+    long frame;
+
+    ingestFlush(s);
+    if (s->sample.count == 0) {
+        return;
+    }
+    setBatchStats(&s->batch, &s->sample, s->fail);
+    if (s->plan != NULL) {
+        planFinish(s->plan, &s->progress);
+    }
+    frame = s->archive != NULL ? archiveEnd(s->archive, &s->batch, s->suppliers) : -1;
+    if (part == NULL) {
+        ingestWrite(s, &s->batch, s->progress.decision, frame >= 0 ? s->archive->bytes + frame : NULL, frame >= 0 ? s->archive->used - frame : 0);
+        if (s->archive != NULL) {
+            s->archive->used = 0;
+        }
+        return;
+    }
+    if (part->resultCount == part->resultMax) {
+        r = realloc(part->results, (part->resultMax * 2 + 256) * sizeof(*r));
+        if (r == NULL) {
+            part->failed = 1;
+            return;
+        }
+        part->results = r;
+        part->resultMax = part->resultMax * 2 + 256;
+    }
+    r = &part->results[part->resultCount++];
+    r->batch = s->batch;
+    r->line = s->line;
+    r->frame = frame;
+    r->frameBytes = frame >= 0 ? s->archive->used - frame : 0;
+    r->decision = s->progress.decision;
+    s->batches++;
+}
+
+void ingestFlush(ingest* s) {
+    /*
+    Name: ingestFlush
+    Function: Check and accumulate the readings buffered for the batch in progress
+    Paramaters: ingest* s - Pointer to the ingestion state
+    Variables: alerts, first, used
+    Readings are buffered in chunks of INGEST_CHUNK so the tolerance check, statistics, control chart, sketch and archive encoding
+    run over contiguous arrays.
+    Under a sampling plan only the readings up to the plan's decision are used, as if the rest had not been measured
+     */
+    int alerts;
+    long first, used = s->pending;
+
+    if (s->pending == 0) {
+        return;
+    }
+    if (s->plan == NULL) {
+        s->fail += classifyReadings(s->readings, s->pending, s->lower, s->upper, NULL);
+    } else {
+        used = 0;
+        if (s->progress.decision == PLAN_MORE) {
+            classifyReadings(s->readings, s->pending, s->lower, s->upper, s->failMask);
+            used = planAdd(s->plan, &s->progress, s->failMask, s->pending);
+        }
+        s->fail = s->progress.defects;
+        s->offered += s->pending;
+    }
+    statsAddBlock(&s->sample, s->readings, used);
+    if (s->sketch != NULL) {
+        sketchAddBlock(s->sketch, s->readings, used, s->batch.nominalValue);
+    }
+    if (s->archive != NULL) {
+        archiveAddBlock(s->archive, s->readings, used);
+    }
+    if (s->chart >= 0 && used > 0 && (alerts = spcAdd(&s->charts->charts[s->chart], s->readings, used, s->lower, s->upper, &first)) != 0) {
+        printAlerts(&s->charts->charts[s->chart], s->suppliers, alerts, s->charts->charts[s->chart].readings - used + first + 1, s->batch.day);
+    }
+    s->pending = 0;
+}
+
+int ingestKey(const char* line, const char* end) {
+    /*
+    Name: ingestKey
+    Function: Find the batch key (supplier,date,bands) at the start of a measurement line
+    Paramaters: const char* line, const char* end - Line contents (end excludes the newline)
+    Variables: p, fields
+    Returns the length of the key, 0 for a blank or comment line, -1 if the line has no reading field
+     */
+    const char* p;
+    int fields = 0;
+
+    if (end == line || *line == '#') {
+        return 0;
+    }
+    for (p = line; p < end; p++) {
+        if ((*p == ',' || *p == '\t') && ++fields == 3) {
+            return p - line;
+        }
+    }
+    return -1;
+}
+
+void ingestError(ingest* s, const char* message, const char* detail) {
+    /*
+    Name: ingestError
+    Function: Report a problem with the current line of a measurement file
+    Paramaters: ingest* s - Pointer to the ingestion state, const char* message - printf format for the problem
+                            const char* detail - String for a %s in message (NULL if it has none)
+    Variables: part, m
+    Worker threads keep their messages with the number of records before them, so ingestParallel() prints them in file order
+     */
+    ingestPart* part = s->part;
+    ingestMessage* m;
+
+    if (part == NULL) {
+        ingestWhere(s);
+        fprintf(stderr, message, detail);
+        fprintf(stderr, "\n");
+        return;
+    }
+    if (part->messageCount == part->messageMax) {
+        m = realloc(part->messages, (part->messageMax * 2 + 16) * sizeof(*m));
+        if (m == NULL) {
+            part->failed = 1;
+            return;
+        }
+        part->messages = m;
+        part->messageMax = part->messageMax * 2 + 16;
+    }
+    m = &part->messages[part->messageCount++];
+    m->line = s->line;
+    m->after = part->resultCount;
+    sprintf(m->text, message, detail);
+}
+
+void ingestWhere(const ingest* s) {
+    /*
+    Name: ingestWhere
+    Function: Start a message about the current line on stderr with where it is
+    Paramaters: const ingest* s - Pointer to the ingestion state
+    Variables: -
+    The rig reads several sources at once, so its messages also name the source
+     */
+    if (s->source != NULL) {
+        fprintf(stderr, "%s line %ld: ", s->source, s->line);
+    } else {
+        fprintf(stderr, "Line %ld: ", s->line);
+    }
+}
+
+int ingestWrite(ingest* s, data* batch, int decision, const unsigned char* frame, long frameBytes) {
+    /*
+    Name: ingestWrite
+    Function: Write a finished batch to the text output or binary log, and its readings to the archive
+    Paramaters: ingest* s - Pointer to the ingestion state, data* batch - Pointer to the batch
+                            int decision - The sampling plan's decision (ignored without a plan)
+                            const unsigned char* frame, long frameBytes - The batch's archive frame (archiveEnd()), NULL if it has none
+    Variables: date
+    Batches a sampling plan rejected or couldn't decide are reported on stderr and every decision is counted for ingestDecisions()
+    Returns 0 on success, 1 if the batch can't be added to a binary log (the supplier has no id or the log can't be written)
+     */
+    char date[9];
+
+    if (s->plan != NULL) {
+        s->decisions[decision]++;
+        s->needed += batch->sampleSize;
+        if (decision != PLAN_ACCEPT) {
+            fprintf(stderr, "%s: %s %g Ohms, batch of %s, %.0f of %ld readings outside tolerance\n", decision == PLAN_REJECT ? "Rejected" : "Undecided",
+                    batch->company, batch->nominalValue, formatDate(batch->day, date), batch->failureRate * batch->sampleSize / 100, batch->sampleSize);
+        }
+    }
+    if (s->log == NULL) {
+        writeRecord(s->out, batch);
+    } else if (logWriterAppend(s->log, batch) != 0) {
+        ingestWhere(s);
+        if (supplierId(s->suppliers, batch->company) < 0) {
+            fprintf(stderr, "supplier %s has no id, batch not logged\n", batch->company);
+        } else {
+            fprintf(stderr, "unable to write the log, batch not logged\n");
+        }
+        return 1;
+    }
+    if (s->archiveFile != NULL && frame == NULL && supplierId(s->suppliers, batch->company) < 0) {
+        ingestWhere(s);
+        fprintf(stderr, "supplier %s has no id, readings not archived\n", batch->company);
+    } else if (frame != NULL && fwrite(frame, 1, frameBytes, s->archiveFile) != (size_t) frameBytes) {
+        ingestWhere(s);
+        fprintf(stderr, "unable to write the readings to the archive\n");
+    }
+    s->batches++;
+    return 0;
+}
+
+void ingestDecisions(const ingest* s) {
+    /*
+    Name: ingestDecisions
+    Function: Report how the sampling plan decided the batches of a measurement file and how many readings it needed
+    Paramaters: const ingest* s - Pointer to the ingestion state that wrote the records
+    Variables: -
+     */
+    fprintf(stderr, "Sampling plan: %ld batches accepted, %ld rejected, %ld undecided, %ld of %ld readings needed (%.1f%%)\n",
+            s->decisions[PLAN_ACCEPT], s->decisions[PLAN_REJECT], s->decisions[PLAN_MORE], s->needed, s->offered,
+            s->offered > 0 ? 100.0 * s->needed / s->offered : 0.0);
+}
+
+#ifdef INGEST_THREADS
+long ingestBoundary(const char* base, long size, long pos) {
+    /*
+    Name: ingestBoundary
+    Function: Find the first batch that starts at or after an offset of a measurement file
+    Paramaters: const char* base, long size - File contents, long pos - Offset to search from
+    Variables: start, end, key, keyLen, len
+    The key of the last line with one before the next line start is found, then lines are skipped while they have the same key
+    (or none), so a batch is never split between two workers. Returns the offset of the first line of that batch (size if none)
+     */
+    const char *p, *key = NULL, *lineStart;
+    long end;
+    int keyLen = 0, len;
+
+    p = memchr(base + pos, '\n', size - pos);
+    if (p == NULL) {
+        return size;
+    }
+    pos = p + 1 - base;
+    for (end = pos - 1; end > 0 && key == NULL; end = lineStart - base - 1) {
+        for (lineStart = base + end; lineStart > base && lineStart[-1] != '\n'; lineStart--);
+        len = ingestKey(lineStart, base + end);
+        if (len > 0) {
+            key = lineStart;
+            keyLen = len;
+        }
+    }
+    while (pos < size) {
+        p = memchr(base + pos, '\n', size - pos);
+        end = p == NULL ? size : p - base;
+        len = ingestKey(base + pos, base + end);
+        if (len > 0 && (len != keyLen || memcmp(base + pos, key, len) != 0)) {
+            break;
+        }
+        pos = end + 1;
+    }
+    return pos < size ? pos : size;
+}
+
+void* ingestWorker(void* arg) {
+    /*
+    Name: ingestWorker
+    Function: Thread function, run the lines of one part of a measurement file through the batch calculations
+    Paramaters: void* arg - Pointer to the ingestPart
+    Variables: part, start, lineEnd
+    The records and messages are kept in the part instead of being written, the line numbers are relative to the start of the part
+     */
+    ingestPart* part = arg;
+    const char *start = part->start, *lineEnd;
+    PROFILE_TIMER(timer);
+
+    PROFILE_BEGIN(timer);
+    while (start < part->end) {
+        lineEnd = memchr(start, '\n', part->end - start);
+        if (lineEnd == NULL) {
+            lineEnd = part->end;
+        }
+        part->state.line++;
+        ingestLine(&part->state, start, lineEnd);
+        start = lineEnd + 1;
+    }
+    if (part->state.valid) {
+        ingestBatchEnd(&part->state);
+    }
+    PROFILE_END(PROFILE_PARSE, timer, part->state.line, part->end - part->start);
+    return NULL;
+}
+#endif
+
+int ingestParallel(const char* fileName, const registry* suppliers, FILE* out, logWriter* log, int threads, sketchTable* sketches, FILE* archive,
+        const samplingPlan* plan) {
+    /*
+    Name: ingestParallel
+    Function: Multi-threaded version of ingestFile(), the output is the same as a single threaded run
+    Paramaters: const char* fileName - Measurement file, const registry* suppliers - Supplier ids for the sketches and archive
+                            FILE* out - Destination for the records (text log format)
+                            logWriter* log - Binary log to append the records to instead of out (NULL to use out)
+                            int threads - Number of worker threads (at most INGEST_MAX_THREADS)
+                            sketchTable* sketches - Sketches of deviation from nominal to add the readings to (NULL for none)
+                            FILE* archive - Raw reading archive to append each batch's readings to (NULL for none)
+                            const samplingPlan* plan - Sampling plan deciding each batch (NULL to use every reading)
+    Variables: base, size, parts, tid, started, state, k, r, m, offset, status
+    The mapped file is split into one part per thread at batch boundaries (ingestBoundary()). Each worker has its own ingest state
+    and keeps its records, which are then written by this thread in file order, so the text log, binary log, supplier index and
+    aggregate are identical to ingestFile()'s. Each part keeps its own sketches, merged in file order once the workers finish, so
+    the counts and histograms match ingestFile()'s exactly and the quantiles to within the sketch's error. The parts depend on the
+    number of threads, so the quantiles are repeatable for a thread count but can differ between thread counts (see sketchMerge()). The archive frames are
+    encoded by the workers too and written with their records, so the archive is also identical. stdin, and platforms without
+    threads, use ingestFile().
+    Returns 0 on success, 1 if the file can't be read or a worker ran out of memory
+     */
+#ifdef INGEST_THREADS
+    const char* base;
+    long size, offset = 0, r, m, pos;
+    ingestPart* parts;
+    pthread_t tid[INGEST_MAX_THREADS];
+    int k, started, status = 0;
+    ingest state;
+
+    if (threads > INGEST_MAX_THREADS) {
+        threads = INGEST_MAX_THREADS;
+    }
+    if (threads < 2 || strcmp(fileName, "-") == 0 || mapFile(fileName, &base, &size) != 0) {
+        return ingestFile(fileName, suppliers, out, log, NULL, sketches, archive, plan);
+    }
+    parts = calloc(threads, sizeof(*parts));
+    if (parts == NULL) {
+        unmapFile(base, size);
+        return ingestFile(fileName, suppliers, out, log, NULL, sketches, archive, plan);
+    }
+    for (k = 0, pos = 0; k < threads; k++) {
+        parts[k].start = base + pos;
+        pos = k == threads - 1 ? size : ingestBoundary(base, size, size / threads * (k + 1));
+        if (base + pos < parts[k].start) {
+            pos = parts[k].start - base;
+        }
+        parts[k].end = base + pos;
+        parts[k].state.part = &parts[k];
+        parts[k].state.suppliers = suppliers;
+        parts[k].state.plan = plan;
+        if (sketches != NULL) {
+            parts[k].state.sketches = &parts[k].sketches;
+            sketchTableInit(&parts[k].sketches);
+        }
+        if (archive != NULL) {
+            parts[k].state.archive = &parts[k].archive;
+        }
+    }
+    for (started = 0; started < threads; started++) {
+        if (pthread_create(&tid[started], NULL, ingestWorker, &parts[started]) != 0) {
+            break;
+        }
+    }
+    /*Any part a thread couldn't be started for is run here*/
+    for (k = started; k < threads; k++) {
+        ingestWorker(&parts[k]);
+    }
+    for (k = 0; k < started; k++) {
+        pthread_join(tid[k], NULL);
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.out = out;
+    state.suppliers = suppliers;
+    state.log = log;
+    state.archiveFile = archive;
+    state.plan = plan;
+    for (k = 0; k < threads; k++) {
+        if (parts[k].failed || parts[k].archive.failed) {
+            status = 1;
+        }
+        for (r = 0, m = 0; r <= parts[k].resultCount; r++) {
+            for (; m < parts[k].messageCount && parts[k].messages[m].after <= r; m++) {
+                fprintf(stderr, "Line %ld: %s\n", offset + parts[k].messages[m].line, parts[k].messages[m].text);
+            }
+            if (r < parts[k].resultCount) {
+                state.line = offset + parts[k].results[r].line;
+                ingestWrite(&state, &parts[k].results[r].batch, parts[k].results[r].decision, parts[k].results[r].frame >= 0
+                        ? parts[k].archive.bytes + parts[k].results[r].frame : NULL, parts[k].results[r].frameBytes);
+            }
+        }
+        offset += parts[k].state.line;
+        state.offered += parts[k].state.offered;
+        if (sketches != NULL && sketchTableMerge(sketches, &parts[k].sketches) != 0) {
+            status = 1;
+        }
+        if (sketches != NULL) {
+            sketchTableFree(&parts[k].sketches);
+        }
+        archiveFree(&parts[k].archive);
+        free(parts[k].results);
+        free(parts[k].messages);
+    }
+    if (status != 0) {
+        fprintf(stderr, "Not enough memory to ingest %s, some batches are missing\n", fileName);
+    }
+    if (plan != NULL) {
+        ingestDecisions(&state);
+    }
+    free(parts);
+    unmapFile(base, size);
+    return status;
+#else
+    return ingestFile(fileName, suppliers, out, log, NULL, sketches, archive, plan);
+#endif
+}
+
+int openCharts(spcTable* charts, const char* fileName) {
+    /*
+    Name: openCharts
+    Function: Load the control charts kept in a file, starting new ones if it doesn't exist yet
+    Paramaters: spcTable* charts - Pointer to the charts, const char* fileName - Charts file
+    Variables: -
+    Returns 0 on success, 1 (after printing the reason) if the file isn't a charts file
+     */
+    spcInit(charts);
+    if (spcLoad(charts, fileName) > 0) {
+        fprintf(stderr, "%s is not a control chart file (or memory ran out)\n", fileName);
+        spcFree(charts);
+        return 1;
+    }
+    return 0;
+}
+
+int closeCharts(spcTable* charts, const char* fileName) {
+    /*
+    Name: closeCharts
+    Function: Save the control charts for the next run and release them
+    Paramaters: spcTable* charts - Pointer to the charts, const char* fileName - Charts file
+    Variables: status
+    Returns 0 on success, 1 (after printing the reason) if the file can't be written
+     */
+    int status = spcSave(charts, fileName);
+
+    if (status != 0) {
+        fprintf(stderr, "Unable to save the control charts to %s\n", fileName);
+    }
+    spcFree(charts);
+    return status;
+}
+
+void printAlerts(const spcChart* c, const registry* suppliers, int alerts, double reading, long day) {
+    /*
+    Name: printAlerts
+    Function: Report the alerts a control chart has raised
+    Paramaters: const spcChart* c - Pointer to the chart, const registry* suppliers - Supplier names
+                            int alerts - spcAlert flags, double reading - Number of the reading (from 1)
+                            that raised the first alert in the chart's history, long day - Day number of the batch it was in
+    Variables: date, i
+     */
+    char date[9];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (alerts & (1 << i)) {
+            fprintf(stderr, "Out of control: %s %g Ohms, batch of %s, reading %.0f: %s\n", supplierName(suppliers, c->supplier), c->nominal,
+                    formatDate(day, date), reading, spcAlerts[i]);
+        }
+    }
+}
+
+void viewCharts(const char* fileName, const registry* suppliers) {
+    /*
+    Name: viewCharts
+    Function: Print the control charts kept in a file
+    Paramaters: const char* fileName - Charts file, const registry* suppliers - Supplier names
+    Variables: charts, c, state, i
+    Offsets are the in-control mean from the nominal value and the EWMA and CUSUMs are in standard deviations of the in-control readings
+     */
+    spcTable charts;
+    const spcChart* c;
+    const char* state;
+    unsigned int i;
+
+    spcInit(&charts);
+    if (spcLoad(&charts, fileName) != 0) {
+        printf("File not found or not a control chart file. Exiting program.");
+        exit(0);
+    }
+    printf("%-20s\t%-20s\t%-11s\t%-12s\t%-10s\t%-10s\t%-8s\t%-8s\t%-8s\t%-8s\t%s\n", "Company", "Nominal Value (Ohms)", "Tolerance",
+            "Readings", "Offset (%)", "SD (%)", "EWMA", "CUSUM+", "CUSUM-", "Alerts", "State");
+    for (i = 0; i < charts.count; i++) {
+        c = &charts.charts[i];
+        state = c->scale == 0 ? "Warming up" : (c->state & (SPC_EWMA_HIGH | SPC_CUSUM_HIGH)) && (c->state & (SPC_EWMA_LOW | SPC_CUSUM_LOW)) ? "High and low"
+                : (c->state & (SPC_EWMA_HIGH | SPC_CUSUM_HIGH)) ? "High" : (c->state & (SPC_EWMA_LOW | SPC_CUSUM_LOW)) ? "Low" : "In control";
+        printf("%-20s\t%-20f\t%-11f\t%-12.0f\t%-10.4f\t%-10.4f\t%-8.3f\t%-8.3f\t%-8.3f\t%-8u\t%s\n", supplierName(suppliers, c->supplier), c->nominal,
+                c->tolerance, c->readings, 100 * (c->mean - c->nominal) / c->nominal, c->scale > 0 ? 100 / (c->scale * c->nominal) : 0.0,
+                c->ewma, c->cusumHigh, c->cusumLow, c->alerts, state);
+    }
+    spcFree(&charts);
+}
+
+int openSketches(sketchTable* sketches, const char* fileName) {
+    /*
+    Name: openSketches
+    Function: Load the sketches kept in a file, starting new ones if it doesn't exist yet
+    Paramaters: sketchTable* sketches - Pointer to the sketches, const char* fileName - Sketch file
+    Variables: -
+    Returns 0 on success, 1 (after printing the reason) if the file isn't a sketch file
+     */
+    sketchTableInit(sketches);
+    if (sketchLoad(sketches, fileName) > 0) {
+        fprintf(stderr, "%s is not a sketch file (or memory ran out)\n", fileName);
+        sketchTableFree(sketches);
+        return 1;
+    }
+    return 0;
+}
+
+int closeSketches(sketchTable* sketches, const char* fileName) {
+    /*
+    Name: closeSketches
+    Function: Save the sketches for the next run and release them
+    Paramaters: sketchTable* sketches - Pointer to the sketches, const char* fileName - Sketch file
+    Variables: status
+    Returns 0 on success, 1 (after printing the reason) if the file can't be written
+     */
+    int status = sketchSave(sketches, fileName);
+
+    if (status != 0) {
+        fprintf(stderr, "Unable to save the sketches to %s\n", fileName);
+    }
+    sketchTableFree(sketches);
+    return status;
+}
+
+void viewQuantiles(const registry* suppliers, int count, char* files[]) {
+    /*
+    Name: viewQuantiles
+    Function: Print the quantiles of each supplier's deviation from nominal kept in one or more sketch files
+    Paramaters: const registry* suppliers - Supplier names, int count - Number of files
+                            char* files[] - Sketch files (e.g. one per log segment), merged into one set
+    Variables: sketches, q, out, s, i, k
+    Deviations are percentages of the nominal value. The minimum and maximum are exact, the others are within the sketch's error
+     */
+    static const double q[7] = {0, 0.01, 0.05, 0.5, 0.95, 0.99, 1};
+    double out[7];
+    sketchTable sketches;
+    const sketch* s;
+    unsigned int i;
+    int k;
+
+    sketchTableInit(&sketches);
+    for (k = 0; k < count; k++) {
+        if (sketchLoad(&sketches, files[k]) != 0) {
+            printf("File %s not found or not a sketch file. Exiting program.", files[k]);
+            exit(0);
+        }
+    }
+    printf("%-20s\t%-12s\t%-10s\t%-10s\t%-10s\t%-10s\t%-10s\t%-10s\t%s\n", "Company", "Readings", "Min (%)", "P1 (%)", "P5 (%)",
+            "P50 (%)", "P95 (%)", "P99 (%)", "Max (%)");
+    for (i = 0; i < sketches.count; i++) {
+        s = sketches.sketches[sketches.order[i]];
+        sketchQuantiles(s, q, 7, out);
+        printf("%-20s\t%-12.0f", supplierName(suppliers, sketches.order[i]), s->count);
+        for (k = 0; k < 7; k++) {
+            printf("\t%-10.4f", 100 * out[k]);
+        }
+        printf("\n");
+    }
+    sketchTableFree(&sketches);
+}
+
+void viewHistogram(const registry* suppliers, int supplier, int count, char* files[]) {
+    /*
+    Name: viewHistogram
+    Function: Print the histogram of a supplier's deviation from nominal kept in one or more sketch files
+    Paramaters: const registry* suppliers - Supplier names, int supplier - Supplier id, int count - Number of files
+                            char* files[] - Sketch files, merged into one set
+    Variables: sketches, s, low, high, b, k
+    Only bins holding readings are printed, the deviations are percentages of the nominal value
+     */
+    sketchTable sketches;
+    const sketch* s;
+    double low, high;
+    int b, k;
+
+    sketchTableInit(&sketches);
+    for (k = 0; k < count; k++) {
+        if (sketchLoad(&sketches, files[k]) != 0) {
+            printf("File %s not found or not a sketch file. Exiting program.", files[k]);
+            exit(0);
+        }
+    }
+    s = sketches.sketches[supplier];
+    if (s == NULL || s->count == 0) {
+        printf("No readings of %s\n", supplierName(suppliers, supplier));
+        sketchTableFree(&sketches);
+        return;
+    }
+    printf("%-12s\t%-12s\t%-12s\t%s\n", "From (%)", "To (%)", "Readings", "Share (%)");
+    for (b = 0; b < SKETCH_BINS; b++) {
+        if (s->bins[b] > 0) {
+            sketchBinRange(b, &low, &high);
+            printf("%-12.5g\t%-12.5g\t%-12.0f\t%.4f\n", 100 * low, 100 * high, s->bins[b], 100 * s->bins[b] / s->count);
+        }
+    }
+    sketchTableFree(&sketches);
+}
+
+int openArchive(FILE** fp, const char* fileName) {
+    /*
+    Name: openArchive
+    Function: Open the raw reading archive for appending, creating it if it doesn't exist
+    Paramaters: FILE** fp - Set to the archive, const char* fileName - Archive name
+    Variables: -
+    A frame left incomplete by a crash is cut off the end by archiveOpen()
+    Returns 0 on success, 1 (after printing the reason) if it can't be opened
+     */
+    if (archiveOpen(fp, fileName) != 0) {
+        fprintf(stderr, "Unable to open archive %s (not a raw reading archive, damaged or too large to read)\n", fileName);
+        return 1;
+    }
+    return 0;
+}
+
+int viewArchive(const char* fileName, const registry* suppliers, int supplier, const reportSettings* settings) {
+    /*
+    Name: viewArchive
+    Function: Re-analyse the batches of a raw reading archive, optionally only those of one supplier
+    Paramaters: const char* fileName - Archive name, const registry* suppliers - Supplier names, int supplier - Supplier id to show, or -1 for every batch
+                            const reportSettings* settings - Format and page of the report (NULL for every batch as a table)
+    Variables: base, size, offset, next, frame, resolution, readings, grown, max, d, r, note, batches, total, status
+    Each batch's readings are decoded and evaluated again with evaluateBatch(), the records are reported as options 3 and 4 show
+    them, then the size of the archive per reading (on stderr for CSV and JSON). Batches outside the report's page aren't decoded.
+    Returns 0 on success, 1 if the report can't be written
+     */
+    const char* base;
+    long size, offset, next, max = 0, batches = 0;
+    struct archiveFrame frame;
+    double resolution, total = 0, *readings = NULL, *grown;
+    data d;
+    report r;
+    FILE* note = settings == NULL || settings->format == REPORT_TABLE ? stdout : stderr;
+    int status = 0;
+    PROFILE_TIMER(timer);
+
+    if (mapFile(fileName, &base, &size) != 0 || (offset = archiveFirst(base, size, &resolution)) < 0) {
+        printf("File not found or not a raw reading archive. Exiting program.");
+        exit(0);
+    }
+    if (reportOpen(&r, stdout, suppliers, settings) != 0) {
+        printf("Not enough memory for the report. Exiting program.");
+        exit(0);
+    }
+    PROFILE_BEGIN(timer);
+    for (; (next = archiveFrameAt(base, size, offset, &frame)) > 0; offset = next, batches++) {
+        total += frame.readings;
+        if ((supplier >= 0 && frame.supplier != supplier) || reportSkip(&r)) {
+            continue;
+        }
+        if (frame.readings > max) {
+            grown = realloc(readings, frame.readings * sizeof(*readings));
+            if (grown == NULL) {
+                status = 1;
+                break;
+            }
+            readings = grown;
+            max = frame.readings;
+        }
+        if (archiveDecode(&frame, (const unsigned char*) base + offset + sizeof(frame), resolution, readings) < 0) {
+            status = 2;
+            break;
+        }
+        memset(&d, 0, sizeof(d));
+        strcpy(d.company, supplierName(suppliers, frame.supplier));
+        d.day = frame.day;
+        d.nominalValue = frame.nominal;
+        d.tolerance = frame.tolerance;
+        evaluateBatch(&d, readings, frame.readings);
+        reportRecord(&r, &d);
+    }
+    PROFILE_END(PROFILE_SCAN, timer, batches, offset);
+    if (reportClose(&r) != 0) {
+        fprintf(stderr, "Unable to write the report\n");
+        status = 3;
+    }
+    if ((status != 0 && status != 3) || offset < size) {
+        fprintf(note, "%s after batch %ld.\n", status == 1 ? "Not enough memory for the readings" : "The archive is damaged", batches);
+    }
+    fprintf(note, "%ld batches, %.0f readings in %ld bytes (%.2f bytes a reading)\n", batches, total, size, total > 0 ? size / total : 0.0);
+    free(readings);
+    unmapFile(base, size);
+    return status == 3;
+}
+
+int viewReadings(const char* fileName, const registry* suppliers, long batch) {
+    /*
+    Name: viewReadings
+    Function: Print the raw readings of one batch of an archive
+    Paramaters: const char* fileName - Archive name, const registry* suppliers - Supplier names
+                            long batch - Batch number, from 1 in the order they were archived
+    Variables: base, size, offset, next, frame, resolution, readings, date, i
+    The frames are skipped by their sizes, so only the batch asked for is decoded
+    Returns 0 on success, 1 if there is no such batch or it is damaged
+     */
+    const char* base;
+    long size, offset, next, i;
+    struct archiveFrame frame;
+    double resolution, *readings;
+    char date[9];
+
+    if (mapFile(fileName, &base, &size) != 0 || (offset = archiveFirst(base, size, &resolution)) < 0) {
+        printf("File not found or not a raw reading archive. Exiting program.");
+        exit(0);
+    }
+    for (i = 1; (next = archiveFrameAt(base, size, offset, &frame)) > 0 && i < batch; i++) {
+        offset = next;
+    }
+    readings = next > 0 ? malloc(frame.readings * sizeof(*readings)) : NULL;
+    if (readings == NULL || archiveDecode(&frame, (const unsigned char*) base + offset + sizeof(frame), resolution, readings) < 0) {
+        if (next > 0) {
+            fprintf(stderr, "Batch %ld of %s is damaged\n", batch, fileName);
+        } else {
+            fprintf(stderr, "%s has no batch %ld\n", fileName, batch);
+        }
+        free(readings);
+        unmapFile(base, size);
+        return 1;
+    }
+    printf("%s, %s, %g Ohms, tolerance %g, %u readings\n", supplierName(suppliers, frame.supplier), formatDate(frame.day, date), frame.nominal,
+            frame.tolerance, frame.readings);
+    for (i = 0; i < (long) frame.readings; i++) {
+        printf("%.9g\n", readings[i]);
+    }
+    free(readings);
+    unmapFile(base, size);
+    return 0;
+}
+
+int reportOptions(int argc, char* argv[], reportSettings* settings) {
+    /*
+    Name: reportOptions
+    Function: Take the report options (--format, --offset and --limit) out of the command line of a log view
+    Paramaters: int argc, char* argv[] - The command line, reportSettings* settings - Set to the options given, or the defaults
+    Variables: i, used
+    The options can be anywhere after the file name, the other arguments are left in order
+    Returns the number of arguments left, or -1 if an option's value isn't valid
+     */
+    int i, used = 2;
+
+    settings->format = REPORT_TABLE;
+    settings->offset = 0;
+    settings->limit = -1;
+    for (i = 2; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--format") == 0) {
+            settings->format = strcmp(argv[i + 1], "table") == 0 ? REPORT_TABLE : strcmp(argv[i + 1], "csv") == 0 ? REPORT_CSV
+                    : strcmp(argv[i + 1], "json") == 0 ? REPORT_JSON : -1;
+        } else if (i + 1 < argc && strcmp(argv[i], "--offset") == 0) {
+            settings->offset = isdigit((unsigned char) argv[i + 1][0]) ? atol(argv[i + 1]) : -1;
+        } else if (i + 1 < argc && strcmp(argv[i], "--limit") == 0) {
+            settings->limit = isdigit((unsigned char) argv[i + 1][0]) ? atol(argv[i + 1]) : -2;
+        } else {
+            argv[used++] = argv[i];
+            continue;
+        }
+        i++;
+    }
+    argv[used] = NULL;
+    if (settings->format < 0 || settings->offset < 0 || settings->limit < -1) {
+        return -1;
+    }
+    return used;
+}
+
+int reportOpen(report* r, FILE* out, const registry* suppliers, const reportSettings* settings) {
+    /*
+    Name: reportOpen
+    Function: Start a report of log records and put its header in the output buffer
+    Paramaters: report* r - Pointer to the report, FILE* out - Destination, const registry* suppliers - Supplier names and ids of the records
+                            const reportSettings* settings - Format, first row and most rows (NULL for every row as a table)
+    Variables: -
+    Rows are formatted into a REPORT_BUFFER buffer and written when it fills, so the report streams in large writes however long
+    it is. Nothing is written before the first row or reportClose(), so a view can still exit with an error message.
+    Returns 0 on success, 1 if there isn't enough memory
+     */
+    r->out = out;
+    r->suppliers = suppliers;
+    r->format = settings != NULL ? settings->format : REPORT_TABLE;
+    r->offset = settings != NULL ? settings->offset : 0;
+    r->limit = settings != NULL ? settings->limit : -1;
+    r->rows = 0;
+    r->failed = 0;
+    r->buffer = malloc(REPORT_BUFFER);
+    if (r->buffer == NULL) {
+        return 1;
+    }
+    if (r->format == REPORT_TABLE) {
+        r->used = sprintf(r->buffer, "%-20s\t%-8s\t%-3s\t%-20s\t%-11s\t%-16s\t%-8s\t%-8s\n", "Company", "Date", "Failure Rate (%)",
+                "Nominal Value (Ohms)", "Tolerance", "Mean (Ohms)", "Standard Deviation", "Variance");
+    } else if (r->format == REPORT_CSV) {
+        r->used = sprintf(r->buffer, "company,date,failure_rate,nominal,tolerance,mean,standard_deviation,variance\n");
+    } else {
+        r->used = sprintf(r->buffer, "[");
+    }
+    return 0;
+}
+
+int reportSkip(report* r) {
+    /*
+    Name: reportSkip
+    Function: Count a row of the report against its offset and limit before it is formatted
+    Paramaters: report* r - Pointer to the report
+    Variables: -
+    Views call this for each matching record before decoding it, so rows outside the page cost almost nothing
+    Returns 1 if the row isn't to be written, 0 if it is
+     */
+    if (r->offset > 0) {
+        r->offset--;
+        return 1;
+    }
+    return reportFull(r);
+}
+
+int reportFull(const report* r) {
+    /*
+    Name: reportFull
+    Function: Check whether a report has all the rows its limit allows, so a view can stop reading
+    Paramaters: const report* r - Pointer to the report
+    Variables: -
+    Returns 1 if it is full, 0 if not
+     */
+    return r->limit >= 0 && r->rows >= r->limit;
+}
+
+void reportRecord(report* r, const data* d) {
+    /*
+    Name: reportRecord
+    Function: Add a record to the report, after reportSkip()
+    Paramaters: report* r - Pointer to the report, const data* d - Pointer to the record
+    Variables: number[][], date, value, field, length, i
+    Each value is formatted as writeRecord() stores it ("%f") by formatFixed(), so binary and text logs display identically
+     */
+    char number[6][REPORT_NUMBER_MAX], date[9];
+    double value[6];
+    const char* field[TEXT_LOG_LINES];
+    int length[TEXT_LOG_LINES], i;
+
+    value[0] = d->failureRate;
+    value[1] = d->nominalValue;
+    value[2] = d->tolerance;
+    value[3] = d->meanResistance;
+    value[4] = d->standDevResistance;
+    value[5] = d->varianceResistance;
+    field[0] = d->company;
+    length[0] = (int) strlen(d->company);
+    field[1] = formatDate(d->day, date);
+    length[1] = (int) strlen(date);
+    for (i = 0; i < 6; i++) {
+        field[i + 2] = number[i];
+        length[i + 2] = (int) (formatFixed(number[i], value[i]) - number[i]);
+    }
+    reportWrite(r, field, length);
+}
+
+void reportWrite(report* r, const char** field, const int* length) {
+    /*
+    Name: reportWrite
+    Function: Add a row of eight text fields, in the order of the text log format, to the report
+    Paramaters: report* r - Pointer to the report, const char** field - The fields (need not end in '\0'), const int* length - Their lengths
+    Variables: p, i, n, keys, widths
+    Text logs are reported straight from their lines through this, without converting the numbers. A field that isn't a number is
+    written to JSON as null. Fields longer than REPORT_FIELD_MAX characters are cut short so a row always fits in REPORT_ROW_MAX.
+     */
+    char* p;
+    int i, n;
+    static const char* const keys[TEXT_LOG_LINES] = {"{\"company\": ", ", \"date\": ", ", \"failure_rate\": ", ", \"nominal\": ",
+            ", \"tolerance\": ", ", \"mean\": ", ", \"standard_deviation\": ", ", \"variance\": "};
+    static const int widths[TEXT_LOG_LINES] = {20, 8, 3, 20, 9, 16, 8, 8};
+
+    if (REPORT_BUFFER - r->used < REPORT_ROW_MAX) {
+        reportFlush(r);
+    }
+    p = r->buffer + r->used;
+    for (i = 0; i < TEXT_LOG_LINES; i++) {
+        n = length[i] < REPORT_FIELD_MAX ? length[i] : REPORT_FIELD_MAX;
+        if (r->format == REPORT_TABLE) {
+            /*The columns of printf("%-20s\t%-8.8s\t%-3s\t\t%-20s\t%-9s\t%-16s\t%-8s\t\t%-8s\n") as options 3 and 4 always printed them*/
+            if (i == 1 && n > 8) {
+                n = 8;
+            }
+            memcpy(p, field[i], n);
+            p += n;
+            for (; n < widths[i]; n++) {
+                *p++ = ' ';
+            }
+            if (i == 2 || i == 6) {
+                *p++ = '\t';
+            }
+            *p++ = i < TEXT_LOG_LINES - 1 ? '\t' : '\n';
+        } else if (r->format == REPORT_CSV) {
+            p = reportCsv(p, field[i], n);
+            *p++ = i < TEXT_LOG_LINES - 1 ? ',' : '\n';
+        } else {
+            if (i == 0 && r->rows > 0) {
+                *p++ = ',';
+            }
+            if (i == 0) {
+                memcpy(p, "\n  ", 3);
+                p += 3;
+            }
+            memcpy(p, keys[i], strlen(keys[i]));
+            p += strlen(keys[i]);
+            if (i < 2) {
+                p = reportJsonString(p, field[i], n);
+            } else if (reportIsNumber(field[i], n)) {
+                memcpy(p, field[i], n);
+                p += n;
+            } else {
+                memcpy(p, "null", 4);
+                p += 4;
+            }
+            if (i == TEXT_LOG_LINES - 1) {
+                *p++ = '}';
+            }
+        }
+    }
+    r->used = p - r->buffer;
+    r->rows++;
+}
+
+char* reportCsv(char* p, const char* s, int n) {
+    /*
+    Name: reportCsv
+    Function: Write a CSV field, quoted if it holds a comma, quote or line break
+    Paramaters: char* p - Destination (room for 2 * n + 2 characters), const char* s - Field, int n - Its length
+    Variables: i
+    Returns a pointer to the character after the field
+     */
+    int i;
+
+    for (i = 0; i < n && s[i] != ',' && s[i] != '"' && s[i] != '\n' && s[i] != '\r'; i++);
+    if (i == n) {
+        memcpy(p, s, n);
+        return p + n;
+    }
+    *p++ = '"';
+    for (i = 0; i < n; i++) {
+        if (s[i] == '"') {
+            *p++ = '"';
+        }
+        *p++ = s[i];
+    }
+    *p++ = '"';
+    return p;
+}
+
+char* reportJsonString(char* p, const char* s, int n) {
+    /*
+    Name: reportJsonString
+    Function: Write a JSON string, escaping quotes, backslashes and control characters
+    Paramaters: char* p - Destination (room for 6 * n + 2 characters), const char* s - Text, int n - Its length
+    Variables: i
+    Returns a pointer to the character after the closing quote
+     */
+    int i;
+
+    *p++ = '"';
+    for (i = 0; i < n; i++) {
+        if (s[i] == '"' || s[i] == '\\') {
+            *p++ = '\\';
+            *p++ = s[i];
+        } else if ((unsigned char) s[i] < 0x20) {
+            p += sprintf(p, "\\u%04x", (unsigned char) s[i]);
+        } else {
+            *p++ = s[i];
+        }
+    }
+    *p++ = '"';
+    return p;
+}
+
+int reportIsNumber(const char* s, int n) {
+    /*
+    Name: reportIsNumber
+    Function: Check that a field of a text log is a number JSON accepts (no nan, inf or hex)
+    Paramaters: const char* s - Field, int n - Its length
+    Variables: i, digits
+    Returns 1 if it is, 0 if not
+     */
+    int i = 0, digits;
+
+    if (i < n && s[i] == '-') {
+        i++;
+    }
+    for (digits = 0; i < n && isdigit((unsigned char) s[i]); i++, digits++);
+    if (digits == 0) {
+        return 0;
+    }
+    if (i < n && s[i] == '.') {
+        for (i++, digits = 0; i < n && isdigit((unsigned char) s[i]); i++, digits++);
+        if (digits == 0) {
+            return 0;
+        }
+    }
+    if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+        i++;
+        if (i < n && (s[i] == '+' || s[i] == '-')) {
+            i++;
+        }
+        for (digits = 0; i < n && isdigit((unsigned char) s[i]); i++, digits++);
+        if (digits == 0) {
+            return 0;
+        }
+    }
+    return i == n;
+}
+
+void reportFlush(report* r) {
+    /*
+    Name: reportFlush
+    Function: Write the report's buffered rows to its destination
+    Paramaters: report* r - Pointer to the report
+    Variables: -
+    A failed write is remembered for reportClose() and later rows are still formatted, but the report stops growing
+     */
+    if (r->used > 0 && fwrite(r->buffer, 1, r->used, r->out) != (size_t) r->used) {
+        r->failed = 1;
+    }
+    r->used = 0;
+}
+
+int reportClose(report* r) {
+    /*
+    Name: reportClose
+    Function: Finish a report, write what is left of it and free its buffer
+    Paramaters: report* r - Pointer to the report
+    Variables: -
+    Returns 0 on success, 1 if it couldn't all be written
+     */
+    if (r->format == REPORT_JSON) {
+        r->used += sprintf(r->buffer + r->used, r->rows > 0 ? "\n]\n" : "]\n");
+    }
+    reportFlush(r);
+    if (fflush(r->out) != 0) {
+        r->failed = 1;
+    }
+    free(r->buffer);
+    return r->failed;
+}
+
+char* formatFixed(char* p, double x) {
+    /*
+    Name: formatFixed
+    Function: Write a value with six decimal places exactly as printf("%f") does, without going through printf
+    Paramaters: char* p - Destination (at least REPORT_NUMBER_MAX characters), double x - Value
+    Variables: whole, part, rest, digits, n
+    The fraction is scaled by 10^6 in floating point, which is out by far less than 10^-6 of the last digit, so only a
+    fraction that lands that close to half way might round differently from printf. Those, negative and very large values
+    (and nan and inf) go to sprintf().
+    Returns a pointer to the character after the text
+     */
+    unsigned long long whole, part;
+    double rest;
+    char digits[24];
+    int n = 0;
+
+    if (!(x > 0 && x < 1e15)) {
+        return p + sprintf(p, "%f", x);
+    }
+    whole = (unsigned long long) x;
+    rest = (x - (double) whole) * 1e6;
+    part = (unsigned long long) rest;
+    rest -= (double) part;
+    if (rest > 0.5 - 1e-6 && rest < 0.5 + 1e-6) {
+        return p + sprintf(p, "%f", x);
+    }
+    if (rest > 0.5 && ++part == 1000000) {
+        part = 0;
+        whole++;
+    }
+    do {
+        digits[n++] = (char) ('0' + whole % 10);
+        whole /= 10;
+    } while (whole > 0);
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    *p++ = '.';
+    for (n = 5; n >= 0; n--) {
+        p[n] = (char) ('0' + part % 10);
+        part /= 10;
+    }
+    return p + 6;
+}
+
+int viewLog(const char* fileName, const registry* suppliers, int supplier, const reportSettings* settings) {
+    /*
+    Name: viewLog
+    Function: Print the records of a text or binary log, optionally only those of one supplier, as a table, CSV or JSON
+    Paramaters: const char* fileName - Log name, const registry* suppliers - Supplier names and ids, int supplier - Supplier id to show, or -1 for all records
+                            const reportSettings* settings - Format and page of the report (NULL for every record as a table)
+    Variables: r
+    This is options 3 and 4, and --view
+    Returns 0 on success, 1 if the report can't be written
+     */
+    report r;
+
+    if (reportOpen(&r, stdout, suppliers, settings) != 0) {
+        printf("Not enough memory for the report. Exiting program.");
+        exit(0);
+    }
+    if (isBinaryLog(fileName)) {
+        viewBinaryLog(fileName, supplier, &r);
+    } else {
+        viewTextLog(fileName, supplier, &r);
+    }
+    if (reportClose(&r) != 0) {
+        fprintf(stderr, "Unable to write the report\n");
+        return 1;
+    }
+    return 0;
+}
+
+void viewTextLog(const char* fileName, int supplier, report* r) {
+    /*
+    Name: viewTextLog
+    Function: Add the records of a text log (the eight line format of writeRecord()) to a report, optionally only those of one supplier
+    Paramaters: const char* fileName - Log name, int supplier - Supplier id to show, or -1 for all records, report* r - The report
+    Variables: base, size, p, end, next, line, length, name, fp, records, i
+    The log is read in place through mapFile() and the fields go to the report as they are in the log. Without a supplier
+    the records before the report's offset are skipped by counting lines, every record being TEXT_LOG_LINES lines. The view
+    stops at the report's limit. An incomplete record at the end of the file is ignored.
+     */
+    const char *base, *p, *end, *next, *line[TEXT_LOG_LINES];
+    long size, records = 0;
+    int length[TEXT_LOG_LINES], i;
+    char name[REPORT_FIELD_MAX + 1];
+    FILE* fp;
+    PROFILE_TIMER(timer);
+
+    if (mapFile(fileName, &base, &size) != 0) {
+        fp = fopen(fileName, "r");
+        if (fp == NULL) {
+            printf("File not found. Exiting program.");
+            exit(0);
+        }
+        /*An empty log*/
+        fclose(fp);
+        return;
+    }
+    PROFILE_BEGIN(timer);
+    p = base;
+    end = base + size;
+    if (supplier < 0) {
+        for (; r->offset > 0 && p < end; r->offset--) {
+            for (i = 0; i < TEXT_LOG_LINES && p != NULL; i++) {
+                p = memchr(p, '\n', end - p);
+                p = p != NULL ? p + 1 : NULL;
+            }
+            if (p == NULL) {
+                p = end;
+            }
+        }
+    }
+    while (p < end && !reportFull(r)) {
+        for (i = 0; i < TEXT_LOG_LINES && p < end; i++) {
+            next = memchr(p, '\n', end - p);
+            line[i] = p;
+            length[i] = (int) ((next != NULL ? next : end) - p);
+            if (length[i] > 0 && p[length[i] - 1] == '\r') {
+                length[i]--;
+            }
+            p = next != NULL ? next + 1 : end;
+        }
+        if (i < TEXT_LOG_LINES) {
+            break;
+        }
+        records++;
+        if (supplier >= 0) {
+            i = length[0] < REPORT_FIELD_MAX ? length[0] : REPORT_FIELD_MAX;
+            memcpy(name, line[0], i);
+            name[i] = '\0';
+            if (supplierId(r->suppliers, name) != supplier) {
+                continue;
+            }
+        }
+        if (!reportSkip(r)) {
+            reportWrite(r, line, length);
+        }
+    }
+    PROFILE_END(PROFILE_SCAN, timer, records, (long) (p - base));
+    unmapFile(base, size);
+}
+
+void viewBinaryLog(const char* fileName, int supplier, report* r) {
+    /*
+    Name: viewBinaryLog
+    Function: Add the records of a binary log to a report, optionally only those of one supplier
+    Paramaters: const char* fileName - Log name, int supplier - Supplier id to show, or -1 for all records, report* r - The report
+    Variables: v, c, block, first, i
+    A supplier filter uses the supplier index when it is up to date, otherwise only the supplier column is scanned. Without one,
+    every block holds LOG_BLOCK_RECORDS records, so the view seeks straight to the block and record at the report's offset.
+    The view stops at the report's limit.
+     */
+    logView v;
+    columns c;
+    long block = 0, first, i;
+    PROFILE_TIMER(timer);
+
+    if (logOpen(&v, fileName) != 0) {
+        printf("File not found or not a binary log. Exiting program.");
+        exit(0);
+    }
+    if (supplier < 0 || indexLookup(fileName, &v, supplier, printColumnsRecord, r) < 0) {
+        PROFILE_BEGIN(timer);
+        if (supplier < 0) {
+            block = r->offset / LOG_BLOCK_RECORDS;
+            r->offset -= block * LOG_BLOCK_RECORDS;
+        }
+        for (first = block; block * (long) LOG_BLOCK_RECORDS < (long) v.records && !reportFull(r); block++) {
+            logColumns(&v, block, &c);
+            i = 0;
+            if (supplier < 0) {
+                i = r->offset < (long) c.count ? r->offset : (long) c.count;
+                r->offset -= i;
+            }
+            for (; i < (long) c.count && !reportFull(r); i++) {
+                if (supplier < 0 || c.supplier[i] == supplier) {
+                    printColumnsRecord(&c, i, r);
+                }
+            }
+        }
+        i = (block - first) * LOG_BLOCK_RECORDS;
+        PROFILE_END(PROFILE_SCAN, timer, i, i * WAL_RECORD_BYTES);
+    }
+    logClose(&v);
+}
+
+void printColumnsRecord(const columns* c, long i, void* context) {
+    /*
+    Name: printColumnsRecord
+    Function: Add one record of a binary log block to a report, used as the callback of indexLookup() and logDateRange()
+    Paramaters: const columns* c - Pointer to the block's columns, long i - Record within the block, void* context - The report
+    Variables: record
+    Records outside the report's page aren't decoded
+     */
+    data record;
+    if (reportSkip(context)) {
+        return;
+    }
+    logRecord(c, i, ((const report*) context)->suppliers, &record);
+    reportRecord(context, &record);
+}
+
+int viewDateRange(const char* fileName, const registry* suppliers, long from, long to, int supplier, const reportSettings* settings) {
+    /*
+    Name: viewDateRange
+    Function: Print the records of a log between two dates, optionally only those of one supplier
+    Paramaters: const char* fileName - Log name, const registry* suppliers - Supplier names and ids
+                            long from, long to - Day numbers of the range, int supplier - Supplier id or -1 for all
+                            const reportSettings* settings - Format and page of the report (NULL for every record as a table)
+    Variables: v, st, record, r, name, i
+    A text log is loaded into a column store first, so the range is a scan of its day column
+    Returns 0 on success, 1 if the report can't be written
+     */
+    logView v;
+    store st;
+    data record;
+    report r;
+    int name = -1;
+    long i;
+
+    if (reportOpen(&r, stdout, suppliers, settings) != 0) {
+        printf("Not enough memory for the report. Exiting program.");
+        exit(0);
+    }
+    if (!isBinaryLog(fileName)) {
+        storeInit(&st);
+        if (loadTextLog(&st, fileName) != 0) {
+            printf("File not found or out of memory. Exiting program.");
+            exit(0);
+        }
+        if (supplier >= 0) {
+            for (name = 0; name < (int) st.supplierCount && strcmp(st.names[name], supplierName(suppliers, supplier)) != 0; name++);
+        }
+        for (i = 0; i < st.count && !reportFull(&r); i++) {
+            if (st.day[i] >= from && st.day[i] <= to && (name < 0 || st.supplier[i] == name) && !reportSkip(&r)) {
+                storeRecord(&st, i, &record);
+                reportRecord(&r, &record);
+            }
+        }
+        storeFree(&st);
+    } else {
+        if (logOpen(&v, fileName) != 0) {
+            printf("File not found or not a binary log. Exiting program.");
+            exit(0);
+        }
+        logDateRange(&v, from, to, supplier, printColumnsRecord, &r);
+        logClose(&v);
+    }
+    if (reportClose(&r) != 0) {
+        fprintf(stderr, "Unable to write the report\n");
+        return 1;
+    }
+    return 0;
+}
+
+void viewSummary(const char* fileName, const registry* suppliers, int supplier) {
+    /*
+    Name: viewSummary
+    Function: Print the batch count, mean failure rate and deviation from nominal of each supplier (or one supplier) in a binary log
+    Paramaters: const char* fileName - Log name, const registry* suppliers - Supplier names, int supplier - Supplier id, or -1 for every supplier with records
+    Variables: name, v, a, base, size, header, table, s, i, built
+    Only the log header and the aggregate snapshot are read. If the snapshot doesn't match the log's record count it is updated first
+     */
+    char name[FILENAME_MAX];
+    logView v;
+    aggregate* a;
+    const char* base = NULL;
+    long size = 0;
+    const struct aggFileHeader* header;
+    const struct aggEntry* table;
+    stats s;
+    int i, built;
+
+    if (logOpen(&v, fileName) != 0 || sidecarName(name, fileName, AGG_EXTENSION) != 0) {
+        printf("File not found or not a binary log. Exiting program.");
+        exit(0);
+    }
+    header = NULL;
+    if (mapFile(name, &base, &size) == 0) {
+        header = (const struct aggFileHeader*) base;
+        if (size != (long) (sizeof(*header) + sizeof(a->table)) || memcmp(header->magic, AGG_MAGIC, sizeof(header->magic)) != 0
+                || header->version != AGG_VERSION || header->records != v.records) {
+            unmapFile(base, size);
+            header = NULL;
+        }
+    }
+    if (header == NULL) {
+        a = malloc(sizeof(*a));
+        built = a != NULL && aggOpen(a, fileName, v.records) == 0;
+        if (built) {
+            aggClose(a);
+        }
+        free(a);
+        if (!built || mapFile(name, &base, &size) != 0) {
+            printf("Unable to build the summary for %s\n", fileName);
+            logClose(&v);
+            return;
+        }
+        header = (const struct aggFileHeader*) base;
+    }
+    table = (const struct aggEntry*) (base + sizeof(*header));
+    printf("%-20s\t%-8s\t%-16s\t%-12s\t%-20s\t%-20s\n", "Company", "Batches", "Failure Rate (%)", "Readings", "Mean Deviation (%)", "Deviation StdDev (%)");
+    for (i = 0; i < INDEX_SUPPLIERS; i++) {
+        if ((supplier < 0 && table[i].batches > 0) || i == supplier) {
+            aggStats(&table[i], &s);
+            printf("%-20s\t%-8u\t%-16f\t%-12.0f\t%-20f\t%-20f\n", supplierName(suppliers, i), table[i].batches,
+                    table[i].batches > 0 ? table[i].failureSum / table[i].batches : 0.0, table[i].readings,
+                    100 * s.mean, 100 * sqrt(statsVariance(&s)));
+        }
+    }
+    unmapFile(base, size);
+    logClose(&v);
+}
+
+int loadLog(store* st, const char* fileName, const registry* suppliers) {
+    /*
+    Name: loadLog
+    Function: Add every record of a text or binary log to a column store
+    Paramaters: store* st - Pointer to the store, const char* fileName - Log name, const registry* suppliers - Supplier names of a binary log's ids
+    Variables: -
+    Returns 0 on success, 1 if the log can't be read or memory runs out
+     */
+    return isBinaryLog(fileName) ? storeLoadLog(st, fileName, suppliers) : loadTextLog(st, fileName);
+}
+
+int loadTextLog(store* st, const char* fileName) {
+    /*
+    Name: loadTextLog
+    Function: Add every record of a text log (the eight line format of writeRecord()) to a column store
+    Paramaters: store* st - Pointer to the store, const char* fileName - Log name
+    Variables: fp, line, record, i, n, first, bytes
+    Text logs don't hold the sample size, it is stored as 0. An incomplete record at the end of the file is ignored.
+    Returns 0 on success, 1 if the log can't be read or memory runs out
+     */
+    FILE* fp = fopen(fileName, "r");
+    char line[TEXT_LOG_LINES][64];
+    data record;
+    int i;
+    long first = st->count, bytes = 0, n;
+    PROFILE_TIMER(timer);
+
+    if (fp == NULL) {
+        return 1;
+    }
+    PROFILE_BEGIN(timer);
+    while (1) {
+        for (i = 0; i < TEXT_LOG_LINES && fgets(line[i], sizeof(line[i]), fp) != NULL; i++) {
+            n = strcspn(line[i], "\r\n");
+            line[i][n] = '\0';
+            bytes += n + 1;
+        }
+        if (i < TEXT_LOG_LINES) {
+            break;
+        }
+        strncpy(record.company, line[0], sizeof(record.company) - 1);
+        record.company[sizeof(record.company) - 1] = '\0';
+        if (!parseDate(line[1], strlen(line[1]), &record.day)) {
+            record.day = 0;
+        }
+        record.failureRate = (float) atof(line[2]);
+        record.nominalValue = atof(line[3]);
+        record.tolerance = atof(line[4]);
+        record.meanResistance = atof(line[5]);
+        record.standDevResistance = (float) atof(line[6]);
+        record.varianceResistance = (float) atof(line[7]);
+        record.sampleSize = 0;
+        if (storeAdd(st, &record) != 0) {
+            fclose(fp);
+            return 1;
+        }
+    }
+    PROFILE_END(PROFILE_SCAN, timer, st->count - first, bytes);
+    fclose(fp);
+    return 0;
+}
+
+void viewStoreSummary(const char* fileName, const registry* suppliers, const char* supplier) {
+    /*
+    Name: viewStoreSummary
+    Function: Print the batch count, mean failure rate and deviation from nominal of each supplier (or one supplier) in a text log
+    Paramaters: const char* fileName - Log name, const registry* suppliers - Supplier names of a binary log's ids
+                            const char* supplier - Supplier name, or NULL for every supplier
+    Variables: st, table, s, i
+    The log is loaded into a column store and totalled with storeTotals(), in the same layout as viewSummary() prints for binary logs.
+    Text logs don't record sample sizes, so only the batch counts and failure rates are filled in
+     */
+    store st;
+    struct aggEntry* table;
+    stats s;
+    unsigned int i;
+
+    storeInit(&st);
+    if (loadLog(&st, fileName, suppliers) != 0) {
+        printf("File not found or out of memory. Exiting program.");
+        exit(0);
+    }
+    table = malloc((st.supplierCount > 0 ? st.supplierCount : 1) * sizeof(*table));
+    if (table == NULL) {
+        printf("Unable to build the summary for %s\n", fileName);
+        storeFree(&st);
+        return;
+    }
+    storeTotals(&st, table);
+    printf("%-20s\t%-8s\t%-16s\t%-12s\t%-20s\t%-20s\n", "Company", "Batches", "Failure Rate (%)", "Readings", "Mean Deviation (%)", "Deviation StdDev (%)");
+    for (i = 0; i < st.supplierCount; i++) {
+        if (supplier == NULL || strcmp(st.names[i], supplier) == 0) {
+            aggStats(&table[i], &s);
+            printf("%-20s\t%-8u\t%-16f\t%-12.0f\t%-20f\t%-20f\n", st.names[i], table[i].batches,
+                    table[i].batches > 0 ? table[i].failureSum / table[i].batches : 0.0, table[i].readings,
+                    100 * s.mean, 100 * sqrt(statsVariance(&s)));
+        }
+    }
+    free(table);
+    storeFree(&st);
+}
+
+int queryKeys(const char* text) {
+    /*
+    Name: queryKeys
+    Function: Convert a comma separated list of group by fields to query keys
+    Paramaters: const char* text - Field names (supplier, month, tolerance, nominal) or "all" for one group of every record
+    Variables: names, keys, len, i
+    Returns the keys, or -1 if a field isn't recognised
+     */
+    const char* names[4] = {"supplier", "month", "tolerance", "nominal"};
+    int keys = 0, i;
+    size_t len;
+
+    if (strcmp(text, "all") == 0) {
+        return 0;
+    }
+    while (*text != '\0') {
+        len = strcspn(text, ",");
+        for (i = 0; i < 4 && (strlen(names[i]) != len || strncmp(text, names[i], len) != 0); i++);
+        if (i == 4) {
+            return -1;
+        }
+        keys |= 1 << i;
+        text += len;
+        if (*text == ',') {
+            text++;
+        }
+    }
+    return keys;
+}
+
+int runQuery(const char* fileName, const registry* suppliers, int keys) {
+    /*
+    Name: runQuery
+    Function: Print grouped totals of a log: batches, mean and worst failure rate, and the mean and spread of batch means about nominal
+    Paramaters: const char* fileName - Log name (text or binary), const registry* suppliers - Supplier names of a binary log's ids
+                            int keys - Fields to group by (see queryKeys())
+    Variables: st, q, g, i, date, field
+    The log is loaded into a column store and grouped in one set of passes by queryRun(), then one line is printed per group in key order.
+    Returns 0 on success, 1 if the log can't be read
+     */
+    store st;
+    query q;
+    const struct queryGroup* g;
+    unsigned int i;
+    char date[9], field[32];
+
+    storeInit(&st);
+    queryInit(&q, keys);
+    if (loadLog(&st, fileName, suppliers) != 0 || queryRun(&q, &st) != 0) {
+        fprintf(stderr, "Unable to read %s\n", fileName);
+        storeFree(&st);
+        queryFree(&q);
+        return 1;
+    }
+    qsort(q.groups, q.count, sizeof(*q.groups), queryCompare);
+    if (keys & QUERY_SUPPLIER) {
+        printf("%-20s\t", "Company");
+    }
+    if (keys & QUERY_MONTH) {
+        printf("%-8s\t", "Month");
+    }
+    if (keys & QUERY_TOLERANCE) {
+        printf("%-11s\t", "Tolerance");
+    }
+    if (keys & QUERY_NOMINAL) {
+        printf("%-20s\t", "Nominal Value (Ohms)");
+    }
+    printf("%-8s\t%-16s\t%-16s\t%-8s\t%-20s\t%-20s\n", "Batches", "Failure Rate (%)", "Worst Batch (%)", "Date", "Mean Deviation (%)", "Deviation StdDev (%)");
+    for (i = 0; i < q.count; i++) {
+        g = &q.groups[i];
+        if (keys & QUERY_SUPPLIER) {
+            printf("%-20s\t", st.names[g->supplier]);
+        }
+        if (keys & QUERY_MONTH) {
+            printf("%02d/%04d \t", g->month % 12 + 1, g->month / 12);
+        }
+        if (keys & QUERY_TOLERANCE) {
+            sprintf(field, "%g%%", 100 * g->tolerance);
+            printf("%-11s\t", field);
+        }
+        if (keys & QUERY_NOMINAL) {
+            printf("%-20lf\t", g->nominal);
+        }
+        printf("%-8ld\t%-16f\t%-16f\t%-8s\t%-20f\t%-20f\n", g->batches, g->failureSum / g->batches, g->worstRate, formatDate(st.day[g->worst], date),
+                100 * g->deviationMean, g->deviations > 1 ? 100 * sqrt(g->deviationM2 / (g->deviations - 1)) : 0.0);
+    }
+    storeFree(&st);
+    queryFree(&q);
+    return 0;
+}
+
+double benchNow() {
+    /*
+    Name: benchNow
+    Function: Read a monotonic clock for the benchmarks
+    Paramaters: -
+    Variables: now
+    Returns the time in seconds from an arbitrary start (processor time where there is no monotonic clock)
+     */
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+unsigned long benchRandom(unsigned long long* seed) {
+    /*
+    Name: benchRandom
+    Function: Next value of a seeded pseudo random sequence (64 bit linear congruential, upper 32 bits returned)
+    Paramaters: unsigned long long* seed - Pointer to the generator state
+    Variables: -
+    The sequence only depends on the seed, so every run benchmarks the same data. The state is unsigned long long as unsigned long
+    is only 32 bits on Windows
+     */
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (unsigned long) (*seed >> 32);
+}
+
+int compareTimes(const void* a, const void* b) {
+    /*
+    Name: compareTimes
+    Function: qsort() comparison for the repetition times of a benchmark
+    Paramaters: const void* a, const void* b - Pointers to the two times
+    Variables: -
+     */
+    double x = *(const double*) a, y = *(const double*) b;
+    return x < y ? -1 : x > y;
+}
+
+void benchReport(FILE* out, const char* name, long records, long items, double* times, int repeats) {
+    /*
+    Name: benchReport
+    Function: Write the result of one benchmark as a JSON object
+    Paramaters: FILE* out - Destination, const char* name - Benchmark name, long records - Log size (0 for microbenchmarks)
+                            long items - Items processed by one repetition, double* times - Time of each repetition (sorted here), int repeats - Number of repetitions
+    Variables: i
+    Throughput is items per second at the median repetition time, the latencies are percentiles of the repetition time in microseconds
+     */
+    qsort(times, repeats, sizeof(*times), compareTimes);
+    fprintf(out, "    {\"name\": \"%s\", \"records\": %ld, \"items\": %ld, \"repeats\": %d, \"throughput\": %.1f, "
+            "\"latency_us\": {\"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}}",
+            name, records, items, repeats, times[repeats / 2] > 0 ? items / times[repeats / 2] : 0.0, times[0] * 1e6,
+            times[repeats / 2] * 1e6, times[repeats * 9 / 10] * 1e6, times[repeats * 99 / 100] * 1e6, times[repeats - 1] * 1e6);
+}
+
+void benchRecord(data* d, long i, unsigned long long* seed) {
+    /*
+    Name: benchRecord
+    Function: Fill a synthetic batch record for the log benchmarks
+    Paramaters: data* d - Pointer to the record, long i - Record number (sets the date, 100 records a day), unsigned long long* seed - Generator state
+    Variables: -
+     */
+    strcpy(d->company, suppliers[benchRandom(seed) % SUPPLIER_COUNT]);
+    d->day = BENCH_FIRST_DAY + i / 100;
+    d->nominalValue = 10.0 * (1 + benchRandom(seed) % 1000);
+    d->tolerance = 0.05;
+    d->meanResistance = d->nominalValue * (0.98 + (benchRandom(seed) % 4000) / 100000.0);
+    d->failureRate = (float) (benchRandom(seed) % 1000) / 100;
+    d->standDevResistance = (float) (d->nominalValue / 100);
+    d->varianceResistance = d->standDevResistance * d->standDevResistance;
+    d->sampleSize = 10;
+}
+
+void benchVisit(const columns* c, long i, void* context) {
+    /*
+    Name: benchVisit
+    Function: Callback of indexLookup() and logDateRange() for the benchmarks, adds up the failure rates it is given
+    Paramaters: const columns* c - Pointer to the block's columns, long i - Record within the block, void* context - Pointer to the double total
+    Variables: -
+     */
+    *(double*) context += c->failureRate[i];
+}
+
+double benchScan(const logView* v, int supplier) {
+    /*
+    Name: benchScan
+    Function: Column scan of a binary log, total of the failure rates of all records or of one supplier's records
+    Paramaters: const logView* v - Pointer to the open log, int supplier - Supplier id, or -1 for all records
+    Variables: c, block, i, total
+     */
+    columns c;
+    long block, i;
+    double total = 0;
+
+    for (block = 0; block * (long) LOG_BLOCK_RECORDS < (long) v->records; block++) {
+        logColumns(v, block, &c);
+        for (i = 0; i < (long) c.count; i++) {
+            if (supplier < 0 || c.supplier[i] == supplier) {
+                total += c.failureRate[i];
+            }
+        }
+    }
+    return total;
+}
+
+void benchRemoveLog(const char* fileName) {
+    /*
+    Name: benchRemoveLog
+    Function: Delete a benchmark log and the files kept beside it
+    Paramaters: const char* fileName - Log name
+    Variables: name
+     */
+    char name[FILENAME_MAX];
+
+    remove(fileName);
+    if (sidecarName(name, fileName, INDEX_EXTENSION) == 0) {
+        remove(name);
+    }
+    if (sidecarName(name, fileName, AGG_EXTENSION) == 0) {
+        remove(name);
+    }
+    if (sidecarName(name, fileName, WAL_EXTENSION) == 0) {
+        remove(name);
+    }
+}
+
+int runBenchmarks(FILE* out, long maxRecords) {
+    /*
+    Name: runBenchmarks
+    Function: Run the benchmarks and write the results as JSON
+    Paramaters: FILE* out - Destination for the results, long maxRecords - Largest log for the end to end benchmarks (10^4 upwards in powers of 10)
+    Variables: seed, codes, nominal, tolerance, tempco, status, readings, decoded, sample, archive, frame, times, log, v, st, table, q, d,
+               records, offset, repeats, i, r, start, sink
+    Microbenchmarks time BENCH_REPEATS repetitions of BENCH_ITEMS items: band code decode, tolerance classification, statistics,
+    raw reading archive encode and decode, log append, log scan and supplier filter, then loading the log into a column store, totalling it by supplier and grouping it by
+    supplier and month. The end to end benchmarks write a synthetic log of each size then time a full scan,
+    a supplier filter through the index and a date range query of the latest 10% of days. All data comes from benchRandom() with
+    a fixed seed so runs are comparable. Logs are written to BENCH_LOG in the working directory and deleted afterwards.
+    The built in suppliers are used whatever suppliers.cfg holds, again so runs are comparable.
+    Returns 0 on success, 1 if a benchmark log can't be written
+     */
+    unsigned long long seed = 1;
+    static bandCode codes[BENCH_ITEMS];
+    static double nominal[BENCH_ITEMS], tolerance[BENCH_ITEMS], readings[BENCH_ITEMS], decoded[BENCH_ITEMS];
+    static int tempco[BENCH_ITEMS];
+    static unsigned char status[BENCH_ITEMS];
+    double times[BENCH_REPEATS], start, sink = 0;
+    stats sample;
+    archiveBuffer archive;
+    struct archiveFrame frame;
+    logWriter log;
+    logView v;
+    store st;
+    struct aggEntry table[SUPPLIER_COUNT];
+    query q;
+    data d;
+    long records, offset = -1, i;
+    int repeats, r;
+
+    for (i = 0; i < BENCH_ITEMS; i++) {
+        codes[i].bands = 4;
+        codes[i].colour[0] = (unsigned char) (1 + benchRandom(&seed) % 9);
+        codes[i].colour[1] = (unsigned char) (benchRandom(&seed) % 10);
+        codes[i].colour[2] = (unsigned char) (benchRandom(&seed) % 10);
+        codes[i].colour[3] = (unsigned char) (benchRandom(&seed) % 7);
+        readings[i] = 1000 * (0.9 + (benchRandom(&seed) % 20000) / 100000.0);
+    }
+    fprintf(out, "{\n  \"benchmark\": \"resistor\",\n  \"version\": 1,\n  \"time\": %ld,\n  \"results\": [\n", (long) time(NULL));
+
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        sink += decodeBands(codes, BENCH_ITEMS, nominal, tolerance, tempco, status);
+        times[r] = benchNow() - start;
+    }
+    benchReport(out, "decode", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        sink += classifyReadings(readings, BENCH_ITEMS, minTolVal(1000, 0.05), maxTolVal(1000, 0.05), NULL);
+        times[r] = benchNow() - start;
+    }
+    benchReport(out, "classify", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        statsInit(&sample);
+        statsAddBlock(&sample, readings, BENCH_ITEMS);
+        times[r] = benchNow() - start;
+        sink += sample.mean;
+    }
+    benchReport(out, "stats", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+
+    archiveInit(&archive);
+    memset(&d, 0, sizeof(d));
+    strcpy(d.company, supplierName(NULL, 0));
+    d.nominalValue = 1000;
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        archive.used = 0;
+        start = benchNow();
+        archiveBegin(&archive, 1000);
+        archiveAddBlock(&archive, readings, BENCH_ITEMS);
+        offset = archiveEnd(&archive, &d, NULL);
+        times[r] = benchNow() - start;
+    }
+    if (offset < 0) {
+        fprintf(stderr, "Not enough memory for the archive benchmark\n");
+        archiveFree(&archive);
+        return 1;
+    }
+    benchReport(out, "archive_encode", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+    archiveFrameAt((const char*) archive.bytes, archive.used, 0, &frame);
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        sink += archiveDecode(&frame, archive.bytes + sizeof(frame), ARCHIVE_RESOLUTION, decoded);
+        times[r] = benchNow() - start;
+        sink += decoded[BENCH_ITEMS - 1];
+    }
+    benchReport(out, "archive_decode", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    archiveFree(&archive);
+    fprintf(out, ",\n");
+
+    benchRemoveLog(BENCH_LOG);
+    if (logWriterOpen(&log, BENCH_LOG, NULL) != 0) {
+        fprintf(stderr, "Unable to write the benchmark log %s\n", BENCH_LOG);
+        return 1;
+    }
+    for (r = 0, records = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        for (i = 0; i < BENCH_ITEMS; i++, records++) {
+            benchRecord(&d, records, &seed);
+            logWriterAppend(&log, &d);
+        }
+        times[r] = benchNow() - start;
+    }
+    if (logWriterClose(&log) != 0) {
+        fprintf(stderr, "Unable to write the benchmark log %s\n", BENCH_LOG);
+        return 1;
+    }
+    benchReport(out, "log_append", 0, BENCH_ITEMS, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+
+    if (logOpen(&v, BENCH_LOG) != 0) {
+        fprintf(stderr, "Unable to read the benchmark log %s\n", BENCH_LOG);
+        return 1;
+    }
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        sink += benchScan(&v, -1);
+        times[r] = benchNow() - start;
+    }
+    benchReport(out, "log_scan", records, records, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        indexLookup(BENCH_LOG, &v, 0, benchVisit, &sink);
+        times[r] = benchNow() - start;
+    }
+    benchReport(out, "log_filter", records, records, times, BENCH_REPEATS);
+    logClose(&v);
+    fprintf(out, ",\n");
+
+    storeInit(&st);
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        storeFree(&st);
+        start = benchNow();
+        if (storeLoadLog(&st, BENCH_LOG, NULL) != 0) {
+            fprintf(stderr, "Unable to load the benchmark log %s\n", BENCH_LOG);
+            return 1;
+        }
+        times[r] = benchNow() - start;
+    }
+    benchReport(out, "store_load", records, records, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        start = benchNow();
+        storeTotals(&st, table);
+        times[r] = benchNow() - start;
+        sink += table[0].failureSum;
+    }
+    benchReport(out, "store_totals", records, records, times, BENCH_REPEATS);
+    fprintf(out, ",\n");
+    for (r = 0; r < BENCH_REPEATS; r++) {
+        queryInit(&q, QUERY_SUPPLIER | QUERY_MONTH);
+        start = benchNow();
+        if (queryRun(&q, &st) != 0) {
+            fprintf(stderr, "Not enough memory for the query benchmark\n");
+            return 1;
+        }
+        times[r] = benchNow() - start;
+        sink += q.count;
+        queryFree(&q);
+    }
+    benchReport(out, "query_supplier_month", records, records, times, BENCH_REPEATS);
+    storeFree(&st);
+
+    for (records = 10000; records <= maxRecords; records *= 10) {
+        repeats = records > 10000000 ? 3 : records > 1000000 ? 11 : BENCH_REPEATS;
+        benchRemoveLog(BENCH_LOG);
+        seed = 1;
+        start = benchNow();
+        if (logWriterOpen(&log, BENCH_LOG, NULL) != 0) {
+            fprintf(stderr, "Unable to write the benchmark log %s\n", BENCH_LOG);
+            return 1;
+        }
+        logWriterSync(&log, 0, 0);
+        for (i = 0; i < records; i++) {
+            benchRecord(&d, i, &seed);
+            logWriterAppend(&log, &d);
+        }
+        if (logWriterClose(&log) != 0) {
+            fprintf(stderr, "Unable to write the benchmark log %s\n", BENCH_LOG);
+            return 1;
+        }
+        times[0] = benchNow() - start;
+        fprintf(out, ",\n");
+        benchReport(out, "e2e_write", records, records, times, 1);
+        if (logOpen(&v, BENCH_LOG) != 0) {
+            fprintf(stderr, "Unable to read the benchmark log %s\n", BENCH_LOG);
+            return 1;
+        }
+        for (r = 0; r < repeats; r++) {
+            start = benchNow();
+            sink += benchScan(&v, -1);
+            times[r] = benchNow() - start;
+        }
+        fprintf(out, ",\n");
+        benchReport(out, "e2e_scan", records, records, times, repeats);
+        for (r = 0; r < repeats; r++) {
+            start = benchNow();
+            indexLookup(BENCH_LOG, &v, 1, benchVisit, &sink);
+            times[r] = benchNow() - start;
+        }
+        fprintf(out, ",\n");
+        benchReport(out, "e2e_filter", records, records, times, repeats);
+        for (r = 0; r < repeats; r++) {
+            start = benchNow();
+            logDateRange(&v, BENCH_FIRST_DAY + (records - 1) / 100 - records / 1000, BENCH_FIRST_DAY + (records - 1) / 100, -1, benchVisit, &sink);
+            times[r] = benchNow() - start;
+        }
+        fprintf(out, ",\n");
+        benchReport(out, "e2e_range", records, records, times, repeats);
+        logClose(&v);
+    }
+    benchRemoveLog(BENCH_LOG);
+    /*Printing the results of the benchmarked calls stops the compiler removing them*/
+    fprintf(out, "\n  ],\n  \"checksum\": %g\n}\n", sink);
+    return 0;
+}
+
+profileSettings profiling = {NULL, PROFILE_DUMP_SECONDS, 0, 0};
+#ifdef INGEST_THREADS
+pthread_mutex_t profileLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+int profileOptions(int argc, char* argv[]) {
+    /*
+    Name: profileOptions
+    Function: Handle the profiling options in front of the other command line options and remove them from argv
+    Paramaters: int argc, char* argv[] - The command line
+    Variables: used, on, dumper
+    --profile prints the time, records and bytes of each stage to stderr at exit, --profile-dump <file> also rewrites the report
+    in file every --profile-every seconds (PROFILE_DUMP_SECONDS by default, only at exit without threads) to watch a long run.
+    Without -DRESISTOR_PROFILE the stages aren't timed, so the options only print a warning.
+    Returns the number of arguments left
+     */
+    int used = 1, on = 0;
+#if defined(RESISTOR_PROFILE) && defined(INGEST_THREADS)
+    pthread_t dumper;
+#endif
+
+    while (used < argc) {
+        if (strcmp(argv[used], "--profile") == 0) {
+            on = 1;
+            used++;
+        } else if (used + 1 < argc && strcmp(argv[used], "--profile-dump") == 0) {
+            profiling.dumpFile = argv[used + 1];
+            on = 1;
+            used += 2;
+        } else if (used + 1 < argc && strcmp(argv[used], "--profile-every") == 0 && atol(argv[used + 1]) > 0) {
+            profiling.dumpSeconds = atol(argv[used + 1]);
+            used += 2;
+        } else {
+            break;
+        }
+    }
+    memmove(argv + 1, argv + used, (argc - used + 1) * sizeof(*argv));
+    if (!on) {
+        return argc - used + 1;
+    }
+#ifdef RESISTOR_PROFILE
+    profileStart();
+    profiling.start = benchNow();
+    atexit(profileExit);
+#ifdef INGEST_THREADS
+    if (profiling.dumpFile != NULL && pthread_create(&dumper, NULL, profileDumper, NULL) == 0) {
+        pthread_detach(dumper);
+    }
+#endif
+#else
+    fprintf(stderr, "Profiling is not built in, compile with -DRESISTOR_PROFILE to use --profile\n");
+#endif
+    return argc - used + 1;
+}
+
+void profileReport(FILE* out) {
+    /*
+    Name: profileReport
+    Function: Print the time, records and bytes of each instrumented stage
+    Paramaters: FILE* out - Destination for the report
+    Variables: totals, nanos, total, seconds, threads, i
+    Stage times are exclusive (see profileEnd()) and summed over every thread, so with several threads they can add up to more than
+    the elapsed time. Log scans include the callback that prints or collects each record
+     */
+    struct profileCounter totals[PROFILE_STAGES];
+    double nanos[PROFILE_STAGES], total = 0, seconds = benchNow() - profiling.start;
+    int threads = profileTotals(totals), i;
+
+    for (i = 0; i < PROFILE_STAGES; i++) {
+        nanos[i] = profileNanos(totals[i].ticks);
+        total += nanos[i];
+    }
+    fprintf(out, "%-12s\t%-10s\t%-12s\t%-14s\t%-10s\t%-10s\t%-10s\t%-8s\n", "Stage", "Calls", "Records", "Bytes", "Time (ms)", "ns/record", "MB/s", "Share (%)");
+    for (i = 0; i < PROFILE_STAGES; i++) {
+        fprintf(out, "%-12s\t%-10llu\t%-12llu\t%-14llu\t%-10.3f\t%-10.1f\t%-10.1f\t%-8.1f\n", profileStages[i], totals[i].calls,
+                totals[i].records, totals[i].bytes, nanos[i] / 1e6, totals[i].records > 0 ? nanos[i] / totals[i].records : 0.0,
+                nanos[i] > 0 ? totals[i].bytes * 1e3 / nanos[i] : 0.0, total > 0 ? 100 * nanos[i] / total : 0.0);
+    }
+    fprintf(out, "%d thread(s) timed %.3f ms of stages in %.3f s\n", threads, total / 1e6, seconds);
+}
+
+void profileWrite(const char* fileName) {
+    /*
+    Name: profileWrite
+    Function: Replace the contents of the profile dump file with the current report
+    Paramaters: const char* fileName - Dump file name
+    Variables: name, fp
+    The report is written to <file>.tmp and renamed over the dump file, so a reader never sees half a report
+     */
+    char name[FILENAME_MAX];
+    FILE* fp;
+
+    if (strlen(fileName) + 5 > sizeof(name)) {
+        return;
+    }
+    sprintf(name, "%s.tmp", fileName);
+    fp = fopen(name, "w");
+    if (fp == NULL) {
+        return;
+    }
+    profileReport(fp);
+    fclose(fp);
+    remove(fileName);
+    rename(name, fileName);
+}
+
+void profileExit() {
+    /*
+    Name: profileExit
+    Function: atexit() handler, stop the dump thread and print the final report
+    Paramaters: -
+    Variables: -
+     */
+#ifdef INGEST_THREADS
+    pthread_mutex_lock(&profileLock);
+#endif
+    profiling.stopped = 1;
+    if (profiling.dumpFile != NULL) {
+        profileWrite(profiling.dumpFile);
+    }
+#ifdef INGEST_THREADS
+    pthread_mutex_unlock(&profileLock);
+#endif
+    profileReport(stderr);
+}
+
+void* profileDumper(void* arg) {
+    /*
+    Name: profileDumper
+    Function: Thread function, rewrite the profile dump file every profiling.dumpSeconds seconds until the program exits
+    Paramaters: void* arg - Unused
+    Variables: -
+     */
+    (void) arg;
+#ifdef INGEST_THREADS
+    for (;;) {
+        sleep((unsigned int) profiling.dumpSeconds);
+        pthread_mutex_lock(&profileLock);
+        if (profiling.stopped) {
+            pthread_mutex_unlock(&profileLock);
+            return NULL;
+        }
+        profileWrite(profiling.dumpFile);
+        pthread_mutex_unlock(&profileLock);
+    }
+#else
+    return NULL;
+#endif
+}
+
+void generatorInit(generator* g, const registry* suppliers) {
+    /*
+    Name: generatorInit
+    Function: Set the default generator settings
+    Paramaters: generator* g - Pointer to the settings, const registry* suppliers - The registered suppliers
+    Variables: i
+    The defaults are the registered suppliers (the first GENERATOR_MAX_ITEMS), random 4 band codes (1 ohm to 9.9M, Gold 5%), 10 readings a batch, 100 batches a day
+    from 01012024, 2% defects, 0.1% outliers, a spread of 0.3 and no drift, with seed 1
+     */
+    int i;
+
+    memset(g, 0, sizeof(*g));
+    g->seed = 1;
+    g->readings = 10;
+    g->perDay = 100;
+    g->firstDay = dayNumber(1, 1, 2024);
+    g->defects = 0.02;
+    g->outliers = 0.001;
+    g->spread = 0.3;
+    for (i = 0; i < supplierLimit(suppliers) && g->suppliers < GENERATOR_MAX_ITEMS; i++) {
+        if (supplierId(suppliers, supplierName(suppliers, i)) == i) {
+            strcpy(g->supplier[g->suppliers++], supplierName(suppliers, i));
+        }
+    }
+}
+
+int generatorOption(generator* g, const char* option, const char* value) {
+    /*
+    Name: generatorOption
+    Function: Apply one command line option to the generator settings
+    Paramaters: generator* g - Pointer to the settings, const char* option - Option name, const char* value - Option value
+    Variables: p, end, n, len
+    Lists (--suppliers, --bands, --tolerances) are comma separated, repeating an item makes it more likely to be picked.
+    Returns 0 on success, 1 if the option or value isn't valid
+     */
+    const char *p, *end;
+    int n = 0;
+    size_t len;
+
+    if (strcmp(option, "--suppliers") == 0) {
+        for (p = value; *p != '\0' && n < GENERATOR_MAX_ITEMS; p = *end == ',' ? end + 1 : end) {
+            end = strchr(p, ',');
+            if (end == NULL) {
+                end = p + strlen(p);
+            }
+            len = end - p;
+            if (len == 0 || len >= sizeof(g->supplier[0])) {
+                return 1;
+            }
+            memcpy(g->supplier[n], p, len);
+            g->supplier[n++][len] = '\0';
+        }
+        g->suppliers = n;
+        return *p != '\0';
+    }
+    if (strcmp(option, "--bands") == 0) {
+        for (p = value; *p != '\0' && n < GENERATOR_MAX_ITEMS; p = *end == ',' ? end + 1 : end) {
+            end = strchr(p, ',');
+            if (end == NULL) {
+                end = p + strlen(p);
+            }
+            if (!parseBandCode(p, end - p, &g->code[n++])) {
+                return 1;
+            }
+        }
+        g->codes = n;
+        return *p != '\0';
+    }
+    if (strcmp(option, "--tolerances") == 0) {
+        for (p = value; *p != '\0' && n < GENERATOR_MAX_ITEMS; p = *end == ',' ? end + 1 : end) {
+            end = strchr(p, ',');
+            if (end == NULL) {
+                end = p + strlen(p);
+            }
+            if (end - p != 1 || *p < '0' || *p > '6') {
+                return 1;
+            }
+            g->tolerance[n++] = *p - '0';
+        }
+        g->tolerances = n;
+        return *p != '\0';
+    }
+    if (strcmp(option, "--start") == 0) {
+        return !parseDate(value, strlen(value), &g->firstDay);
+    }
+    if (strcmp(option, "--seed") == 0) {
+        g->seed = strtoull(value, NULL, 10);
+    } else if (strcmp(option, "--readings") == 0) {
+        g->readings = atoi(value);
+    } else if (strcmp(option, "--per-day") == 0) {
+        g->perDay = atol(value);
+    } else if (strcmp(option, "--defects") == 0) {
+        g->defects = atof(value) / 100;
+    } else if (strcmp(option, "--outliers") == 0) {
+        g->outliers = atof(value) / 100;
+    } else if (strcmp(option, "--spread") == 0) {
+        g->spread = atof(value);
+    } else if (strcmp(option, "--drift") == 0) {
+        g->drift = atof(value);
+    } else {
+        return 1;
+    }
+    return g->readings < 1 || g->readings > GENERATOR_MAX_READINGS || g->perDay < 1 || g->defects < 0 || g->defects > 1
+            || g->outliers < 0 || g->outliers > 1 || g->spread < 0;
+}
+
+double generatorUniform(generator* g) {
+    /*
+    Name: generatorUniform
+    Function: Next uniformly distributed value of the generator's sequence
+    Paramaters: generator* g - Pointer to the generator
+    Variables: -
+    Returns a value greater than 0 and less than 1
+     */
+    return (benchRandom(&g->seed) + 0.5) / 4294967296.0;
+}
+
+double generatorNormal(generator* g) {
+    /*
+    Name: generatorNormal
+    Function: Next normally distributed value (mean 0, standard deviation 1) of the generator's sequence
+    Paramaters: generator* g - Pointer to the generator
+    Variables: r, a
+    Box-Muller transform, the second value of each pair is kept for the next call
+     */
+    double r, a;
+
+    if (g->hasSpare) {
+        g->hasSpare = 0;
+        return g->spare;
+    }
+    r = sqrt(-2 * log(generatorUniform(g)));
+    a = 6.283185307179586 * generatorUniform(g);
+    g->spare = r * sin(a);
+    g->hasSpare = 1;
+    return r * cos(a);
+}
+
+int generateBatch(generator* g, long number, data* batch, char* code, double* readings) {
+    /*
+    Name: generateBatch
+    Function: Generate the details and readings of one batch
+    Paramaters: generator* g - Pointer to the generator, long number - Batch number (sets the date), data* batch - Set to the supplier, date, nominal value and tolerance
+                            char* code - Set to the band code as digits (7 characters), double* readings - Set to g->readings readings
+    Variables: supplier, bandCode, position, i, tempco, status, half, centre, u
+    Readings are normally distributed around the nominal value, moved by the supplier's drift, with a standard deviation of spread
+    times half the tolerance window. A fraction (defects) is placed just outside the window and a fraction (outliers) is a gross
+    error of a factor of 10 either way. Returns the number of readings generated outside the tolerance window
+     */
+    int supplier, position, i, tempco, defects = 0;
+    bandCode band;
+    unsigned char status;
+    double half, centre, u;
+
+    supplier = benchRandom(&g->seed) % g->suppliers;
+    if (g->codes > 0) {
+        band = g->code[benchRandom(&g->seed) % g->codes];
+    } else {
+        band.bands = 4;
+        band.colour[0] = (unsigned char) (1 + benchRandom(&g->seed) % 9);
+        band.colour[1] = (unsigned char) (benchRandom(&g->seed) % 10);
+        band.colour[2] = (unsigned char) (2 + benchRandom(&g->seed) % 6);
+        band.colour[3] = 1;
+    }
+    position = band.bands == 6 ? 4 : band.bands - 1;
+    if (g->tolerances > 0) {
+        band.colour[position] = (unsigned char) g->tolerance[benchRandom(&g->seed) % g->tolerances];
+    }
+    strcpy(batch->company, g->supplier[supplier]);
+    batch->day = g->firstDay + number / g->perDay;
+    for (i = 0; i < band.bands; i++) {
+        code[i] = (char) ('0' + band.colour[i]);
+    }
+    code[i] = '\0';
+    if (decodeBands(&band, 1, &batch->nominalValue, &batch->tolerance, &tempco, &status) != 0) {
+        return -1;
+    }
+    half = batch->nominalValue * batch->tolerance;
+    centre = batch->nominalValue + g->drift * half * g->batches[supplier]++ / 1000;
+    for (i = 0; i < g->readings; i++) {
+        u = generatorUniform(g);
+        if (u < g->defects) {
+            readings[i] = batch->nominalValue + (u < g->defects / 2 ? -1 : 1) * half * (1.01 + generatorUniform(g));
+            defects++;
+        } else if (u < g->defects + g->outliers) {
+            readings[i] = batch->nominalValue * (generatorUniform(g) < 0.5 ? 0.1 : 10);
+            defects++;
+        } else {
+            readings[i] = centre + g->spread * half * generatorNormal(g);
+        }
+        if (readings[i] < 0) {
+            readings[i] = 0;
+        }
+    }
+    return defects;
+}
+
+char* formatReading(char* p, double x) {
+    /*
+    Name: formatReading
+    Function: Write a reading as text with three decimal places, without going through printf
+    Paramaters: char* p - Destination (at least 32 characters), double x - Reading
+    Variables: scaled, digits, n
+    Returns a pointer to the character after the text
+     */
+    unsigned long long scaled;
+    char digits[24];
+    int n = 0;
+
+    if (x < 0 || x >= 1e15) {
+        return p + sprintf(p, "%.3f", x);
+    }
+    scaled = (unsigned long long) (x * 1000 + 0.5);
+    do {
+        digits[n++] = (char) ('0' + scaled % 10);
+        scaled /= 10;
+    } while (scaled > 0 || n < 4);
+    while (n > 3) {
+        *p++ = digits[--n];
+    }
+    *p++ = '.';
+    while (n > 0) {
+        *p++ = digits[--n];
+    }
+    return p;
+}
+
+int generateFile(generator* g, const registry* suppliers, int format, const char* fileName, long count) {
+    /*
+    Name: generateFile
+    Function: Write synthetic measurements or batch records for load testing
+    Paramaters: generator* g - Pointer to the generator settings, const registry* suppliers - Supplier ids of a binary log
+                            int format - GENERATE_MEASUREMENTS or GENERATE_LOG
+                            const char* fileName - Output file (NULL for stdout, a *.rlog name writes a binary log), long count - Number of batches
+    Variables: fp, log, binary, buffer, p, prefix, prefixLen, code, date, batch, readings, n, i, fail, skipped, failed
+    Measurements are written in the --ingest format, one line per reading, through one large buffer. Records are the batch
+    statistics of the same readings, in the option 2 text format or the binary log format. The output only depends on the settings
+    (including the seed), so the same command always writes the same file, which is why a binary log is written with its journal off.
+    Generation stops at the first write that fails, and the output is closed on every path.
+    Returns 0 on success, 1 if the output can't be written
+     */
+    FILE* fp = stdout;
+    logWriter log;
+    int binary = fileName != NULL && isBinaryLog(fileName), prefixLen, i, failed = 0;
+    char *buffer, *p, prefix[GENERATOR_PREFIX], code[7], date[9];
+    double readings[GENERATOR_MAX_READINGS];
+    data batch;
+    long n, fail, skipped = 0;
+
+    if (binary ? format != GENERATE_LOG || logWriterOpen(&log, fileName, suppliers) != 0 : fileName != NULL && (fp = fopen(fileName, "wb")) == NULL) {
+        fprintf(stderr, "Unable to write %s\n", fileName);
+        return 1;
+    }
+    if (binary) {
+        logWriterSync(&log, 0, 0);
+    }
+    buffer = malloc(GENERATOR_BUFFER_SIZE);
+    if (buffer == NULL) {
+        fprintf(stderr, "Not enough memory to generate data\n");
+        if (binary) {
+            logWriterClose(&log);
+        } else if (fp != stdout) {
+            fclose(fp);
+        }
+        return 1;
+    }
+    p = buffer;
+    for (n = 0; n < count && !failed; n++) {
+        memset(&batch, 0, sizeof(batch));
+        fail = generateBatch(g, n, &batch, code, readings);
+        if (fail < 0) {
+            skipped++;
+            continue;
+        }
+        if (format == GENERATE_MEASUREMENTS) {
+            prefixLen = sprintf(prefix, "%s,%s,%s,", batch.company, formatDate(batch.day, date), code);
+            for (i = 0; i < g->readings; i++) {
+                if (p - buffer > GENERATOR_BUFFER_SIZE - GENERATOR_PREFIX - 32) {
+                    failed = fwrite(buffer, 1, p - buffer, fp) != (size_t) (p - buffer);
+                    p = buffer;
+                }
+                memcpy(p, prefix, prefixLen);
+                p = formatReading(p + prefixLen, readings[i]);
+                *p++ = '\n';
+            }
+            continue;
+        }
+        evaluateBatch(&batch, readings, g->readings);
+        if (!binary) {
+            writeRecord(fp, &batch);
+            failed = ferror(fp) != 0;
+        } else if (logWriterAppend(&log, &batch) != 0) {
+            failed = log.failed;
+            skipped += !failed;
+        }
+    }
+    if (!failed && p > buffer) {
+        failed = fwrite(buffer, 1, p - buffer, fp) != (size_t) (p - buffer);
+    }
+    free(buffer);
+    if (binary) {
+        failed = logWriterClose(&log) != 0 || failed;
+    } else if (fp != stdout) {
+        failed = fclose(fp) != 0 || failed;
+    } else {
+        failed = fflush(fp) != 0 || failed;
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "%ld batches skipped (invalid band code, or a supplier without an id in a binary log)\n", skipped);
+    }
+    if (failed) {
+        fprintf(stderr, "Unable to write %s\n", fileName != NULL ? fileName : "the output");
+    }
+    return failed;
+}
+
+int serveEvaluate(const char* line, const char* end, const samplingPlan* plan, data* batch, double* readings, int* decision, const char** error) {
+    /*
+    Name: serveEvaluate
+    Function: Decode and evaluate one batch submitted to the acceptance service
+    Paramaters: const char* line, const char* end - Submission (supplier,date,bands,reading,reading,...)
+                            const samplingPlan* plan - Sampling plan deciding the batch (NULL to use every reading), data* batch - Set to the batch record
+                            double* readings - Space for SERVE_MAX_READINGS readings, int* decision - Set to the plan's decision
+                            const char** error - Set to the reason the batch was rejected
+    Variables: field, len, i, n, p, code, nominal, tempco, status, ok, progress
+    The first three fields are as in a measurement file, the rest of the line is the readings separated by commas, spaces or tabs.
+    Negative, nan and infinite readings reject the whole batch so they can't reach the log, aggregates, charts or sketches.
+    With a plan the record only covers the readings the plan needed (evaluatePlan()).
+    Returns 0 if the batch was evaluated, otherwise 1
+     */
+    const char* field[3];
+    int len[3], i, tempco, ok;
+    long n = 0;
+    const char* p = line;
+    bandCode code;
+    unsigned char status = DECODE_BAD_BANDS;
+    planProgress progress;
+
+    for (i = 0; i < 3; i++) {
+        field[i] = p;
+        while (p < end && *p != ',' && *p != '\t') {
+            p++;
+        }
+        len[i] = p - field[i];
+        if (p == end) {
+            *error = "expected supplier,date,bands,readings";
+            return 1;
+        }
+        p++;
+    }
+    memset(batch, 0, sizeof(*batch));
+    if (len[0] >= (int) sizeof(batch->company)) {
+        *error = "supplier name is too long";
+        return 1;
+    }
+    memcpy(batch->company, field[0], len[0]);
+    if (!parseDate(field[1], len[1], &batch->day)) {
+        *error = "invalid date (format ddMMyyyy)";
+        return 1;
+    }
+    if (parseBandCode(field[2], len[2], &code)) {
+        decodeBands(&code, 1, &batch->nominalValue, &batch->tolerance, &tempco, &status);
+    }
+    if (status != DECODE_OK) {
+        *error = decodeErrors[status];
+        return 1;
+    }
+    while (p < end) {
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+        for (field[0] = p; p < end && *p != ',' && *p != ' ' && *p != '\t' && *p != '\r'; p++);
+        if (p == field[0]) {
+            break;
+        }
+        if (n == SERVE_MAX_READINGS) {
+            *error = "too many readings";
+            return 1;
+        }
+        readings[n] = parseReading(field[0], p, &ok);
+        if (!ok || readings[n] < 0 || !isfinite(readings[n])) {
+            *error = "invalid resistance value";
+            return 1;
+        }
+        n++;
+    }
+    if (n == 0) {
+        *error = "no readings";
+        return 1;
+    }
+    if (plan != NULL) {
+        evaluatePlan(batch, readings, n, plan, &progress);
+        *decision = progress.decision;
+        return 0;
+    }
+    evaluateBatch(batch, readings, n);
+    return 0;
+}
+
+#ifdef SERVE_EPOLL
+volatile sig_atomic_t serveStop = 0;
+
+void serveSignal(int number) {
+    /*
+    Name: serveSignal
+    Function: SIGINT and SIGTERM handler of the acceptance service, asks the event loop to shut down
+    Paramaters: int number - Signal number (unused)
+    Variables: -
+     */
+    (void) number;
+    serveStop = 1;
+}
+
+int serveSend(int fd, const char* text, long len) {
+    /*
+    Name: serveSend
+    Function: Send the whole of a response on a non-blocking socket, waiting while the client's receive buffer is full
+    Paramaters: int fd - Socket, const char* text - Response, long len - Response length
+    Variables: sent, wait
+    Returns 0 on success, 1 if the client has gone
+     */
+    long sent;
+    struct pollfd wait;
+
+    while (len > 0) {
+        sent = send(fd, text, len, MSG_NOSIGNAL);
+        if (sent > 0) {
+            text += sent;
+            len -= sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            wait.fd = fd;
+            wait.events = POLLOUT;
+            if (poll(&wait, 1, SERVE_SEND_TIMEOUT_MS) <= 0) {
+                return 1;
+            }
+        } else if (sent < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int serveClientData(server* sv, serveClient* c, archiveBuffer* archive) {
+    /*
+    Name: serveClientData
+    Function: Read what a client has sent, evaluate each complete line and send the responses
+    Paramaters: server* sv - Pointer to the service, serveClient* c - Pointer to the client
+                            archiveBuffer* archive - The worker's buffer for encoding archive frames
+    Variables: got, start, lineEnd, batch, readings, error, reply, replyLen, closed, failed, status, chart, alerts, first, s, frame
+    Called by one worker at a time for a client (the socket is registered with EPOLLONESHOT), so a client's responses are in the
+    order of its submissions. Log writes and control chart and sketch updates are serialised by sv->logLock, so the charts see the
+    readings in log order. The readings are encoded for the archive before taking the lock, which then only covers writing them.
+    Everything else runs in parallel across clients. A line longer than SERVE_LINE_MAX gets one error and the rest of it, up to its
+    newline, is discarded (c->discard), so its tail isn't taken for another submission.
+    Returns 1 if the client has disconnected, otherwise 0
+     */
+    long got;
+    char *start, *lineEnd;
+    data batch;
+    double readings[SERVE_MAX_READINGS];
+    const char* error;
+    char reply[SERVE_REPLY_BYTES];
+    int replyLen, closed = 0, failed, status, alerts, decision = PLAN_MORE;
+    long chart, first, frame = -1;
+    sketch* s;
+    PROFILE_TIMER(timer);
+
+    for (;;) {
+        got = recv(c->fd, c->buffer + c->used, SERVE_LINE_MAX - c->used, 0);
+        if (got == 0) {
+            closed = 1;
+        } else if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            closed = errno != EAGAIN && errno != EWOULDBLOCK;
+        } else {
+            c->used += got;
+        }
+        start = c->buffer;
+        if (c->discard) {
+            lineEnd = memchr(start, '\n', c->used);
+            if (lineEnd != NULL) {
+                start = lineEnd + 1;
+                c->discard = 0;
+            } else {
+                start += c->used;
+            }
+        }
+        while ((lineEnd = memchr(start, '\n', c->buffer + c->used - start)) != NULL) {
+            if (lineEnd > start && !(lineEnd == start + 1 && *start == '\r')) {
+                PROFILE_BEGIN(timer);
+                status = serveEvaluate(start, lineEnd, sv->plan, &batch, readings, &decision, &error);
+                PROFILE_END(PROFILE_PARSE, timer, 1, lineEnd + 1 - start);
+                if (status != 0) {
+                    replyLen = sprintf(reply, "ERR %s\n", error);
+                } else {
+                    if (sv->archive != NULL) {
+                        archiveBegin(archive, batch.nominalValue);
+                        archiveAddBlock(archive, readings, batch.sampleSize);
+                        frame = archiveEnd(archive, &batch, sv->suppliers);
+                    }
+                    pthread_mutex_lock(&sv->logLock);
+                    failed = 0;
+                    if (sv->log == NULL) {
+                        writeRecord(sv->out, &batch);
+                    } else {
+                        failed = logWriterAppend(sv->log, &batch);
+                    }
+                    if (sv->charts != NULL && !failed && (chart = supplierId(sv->suppliers, batch.company)) >= 0
+                            && (chart = spcFind(sv->charts, chart, batch.nominalValue, batch.tolerance)) >= 0
+                            && (alerts = spcAdd(&sv->charts->charts[chart], readings, batch.sampleSize, minTolVal(batch.nominalValue, batch.tolerance),
+                            maxTolVal(batch.nominalValue, batch.tolerance), &first)) != 0) {
+                        printAlerts(&sv->charts->charts[chart], sv->suppliers, alerts, sv->charts->charts[chart].readings - batch.sampleSize + first + 1, batch.day);
+                    }
+                    if (sv->sketches != NULL && !failed && (s = sketchFind(sv->sketches, supplierId(sv->suppliers, batch.company))) != NULL) {
+                        sketchAddBlock(s, readings, batch.sampleSize, batch.nominalValue);
+                    }
+                    if (sv->archive != NULL && !failed && frame >= 0
+                            && fwrite(archive->bytes + frame, 1, archive->used - frame, sv->archive) != (size_t) (archive->used - frame)) {
+                        fprintf(stderr, "Unable to write the readings of a batch of %s to the archive\n", batch.company);
+                    }
+                    sv->dirty = 1;
+                    pthread_mutex_unlock(&sv->logLock);
+                    archive->used = 0;
+                    replyLen = failed && supplierId(sv->suppliers, batch.company) < 0 ? sprintf(reply, "ERR supplier %s has no id, batch not logged\n", batch.company)
+                            : failed ? sprintf(reply, "ERR unable to write the log, batch not logged\n") : sprintf(reply, "OK %f %f %f %f %ld%s%s\n", batch.failureRate, batch.meanResistance,
+                            batch.standDevResistance, batch.varianceResistance, batch.sampleSize, sv->plan != NULL ? " " : "",
+                            sv->plan != NULL ? planDecisions[decision] : "");
+                }
+                if (serveSend(c->fd, reply, replyLen) != 0) {
+                    return 1;
+                }
+            }
+            start = lineEnd + 1;
+        }
+        c->used -= start - c->buffer;
+        memmove(c->buffer, start, c->used);
+        if (c->used == SERVE_LINE_MAX) {
+            c->used = 0;
+            c->discard = 1;
+            if (serveSend(c->fd, "ERR line too long\n", 18) != 0) {
+                return 1;
+            }
+        }
+        if (closed || got < 0) {
+            return closed;
+        }
+    }
+}
+
+void* serveWorker(void* arg) {
+    /*
+    Name: serveWorker
+    Function: Thread function of the acceptance service's worker pool, handles clients with data waiting until the service stops
+    Paramaters: void* arg - Pointer to the server
+    Variables: sv, c, event, archive
+    Clients that disconnect are closed and freed here, others are registered with the event loop again for their next data
+     */
+    server* sv = arg;
+    serveClient* c;
+    struct epoll_event event;
+    archiveBuffer archive;
+
+    archiveInit(&archive);
+    for (;;) {
+        pthread_mutex_lock(&sv->queueLock);
+        while (sv->head == NULL && !sv->stop) {
+            pthread_cond_wait(&sv->queueReady, &sv->queueLock);
+        }
+        c = sv->head;
+        if (c == NULL) {
+            pthread_mutex_unlock(&sv->queueLock);
+            archiveFree(&archive);
+            return NULL;
+        }
+        sv->head = c->next;
+        pthread_mutex_unlock(&sv->queueLock);
+
+        if (serveClientData(sv, c, &archive) != 0) {
+            close(c->fd);
+            free(c);
+            continue;
+        }
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = c;
+        epoll_ctl(sv->epoll, EPOLL_CTL_MOD, c->fd, &event);
+    }
+}
+
+int serveListen(const char* address) {
+    /*
+    Name: serveListen
+    Function: Open the listening socket of the acceptance service
+    Paramaters: const char* address - Unix socket path, or a port number for TCP on localhost (127.0.0.1)
+    Variables: fd, local, inet, on
+    An existing socket file at the path is replaced. Returns the socket, or -1 if it can't be opened
+     */
+    int fd, on = 1;
+    struct sockaddr_un local;
+    struct sockaddr_in inet;
+
+    if (strspn(address, "0123456789") == strlen(address)) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        memset(&inet, 0, sizeof(inet));
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons((unsigned short) atoi(address));
+        inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        if (fd >= 0 && (bind(fd, (struct sockaddr*) &inet, sizeof(inet)) != 0 || listen(fd, SOMAXCONN) != 0)) {
+            close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+    if (strlen(address) >= sizeof(local.sun_path)) {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    strcpy(local.sun_path, address);
+    unlink(address);
+    if (fd >= 0 && (bind(fd, (struct sockaddr*) &local, sizeof(local)) != 0 || listen(fd, SOMAXCONN) != 0)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+int serveConnect(const char* address) {
+    /*
+    Name: serveConnect
+    Function: Connect to an acceptance service
+    Paramaters: const char* address - Unix socket path, or a port number for TCP on localhost
+    Variables: fd, local, inet
+    Returns the socket, or -1 if the service can't be reached
+     */
+    int fd;
+    struct sockaddr_un local;
+    struct sockaddr_in inet;
+
+    if (strspn(address, "0123456789") == strlen(address)) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        memset(&inet, 0, sizeof(inet));
+        inet.sin_family = AF_INET;
+        inet.sin_port = htons((unsigned short) atoi(address));
+        inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || connect(fd, (struct sockaddr*) &inet, sizeof(inet)) != 0) {
+            return -1;
+        }
+        return fd;
+    }
+    if (strlen(address) >= sizeof(local.sun_path)) {
+        return -1;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&local, 0, sizeof(local));
+    local.sun_family = AF_UNIX;
+    strcpy(local.sun_path, address);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &local, sizeof(local)) != 0) {
+        return -1;
+    }
+    return fd;
+}
+#endif
+
+int serve(const char* address, const registry* suppliers, FILE* out, logWriter* log, spcTable* charts, const char* chartFile, sketchTable* sketches,
+        const char* sketchFile, FILE* archive, const samplingPlan* plan, int threads) {
+    /*
+    Name: serve
+    Function: Run the acceptance service until SIGINT or SIGTERM
+    Paramaters: const char* address - Unix socket path or localhost TCP port, const registry* suppliers - Supplier ids for the charts, sketches and archive
+                            FILE* out - Text log for the records
+                            logWriter* log - Binary log to append the records to instead of out (NULL to use out)
+                            spcTable* charts - Control charts to add the readings to (NULL for none), const char* chartFile - Where they are saved
+                            sketchTable* sketches - Sketches to add the readings to (NULL for none), const char* sketchFile - Where they are saved
+                            FILE* archive - Raw reading archive to append each batch's readings to (NULL for none)
+                            const samplingPlan* plan - Sampling plan deciding each batch, its decision ends the reply (NULL for none)
+                            int threads - Worker threads
+    Variables: sv, tid, events, n, i, k, fd, c, event, action, now, flushed
+    One thread runs the epoll event loop, accepting clients and queueing those with data waiting; the worker pool evaluates their
+    submissions and writes the records, one at a time, to the log. The log and archive are flushed (and the control charts and sketches saved)
+    every SERVE_FLUSH_MS while anything has been logged, however busy the service is, and on shutdown. Linux only, elsewhere an error is reported.
+    Returns 0 after a clean shutdown, 1 if the service can't be started
+     */
+#ifdef SERVE_EPOLL
+    server sv;
+    pthread_t tid[SERVE_MAX_THREADS];
+    struct epoll_event events[SERVE_EVENTS], event;
+    struct sigaction action;
+    serveClient* c;
+    int n, i, k, fd;
+    double now, flushed;
+
+    memset(&sv, 0, sizeof(sv));
+    sv.out = out;
+    sv.suppliers = suppliers;
+    sv.log = log;
+    sv.charts = charts;
+    sv.chartFile = chartFile;
+    sv.sketches = sketches;
+    sv.sketchFile = sketchFile;
+    sv.archive = archive;
+    sv.plan = plan;
+    sv.listener = serveListen(address);
+    sv.epoll = epoll_create1(0);
+    if (sv.listener < 0 || sv.epoll < 0) {
+        fprintf(stderr, "Unable to listen on %s\n", address);
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(sv.epoll, EPOLL_CTL_ADD, sv.listener, &event);
+    pthread_mutex_init(&sv.queueLock, NULL);
+    pthread_mutex_init(&sv.logLock, NULL);
+    pthread_cond_init(&sv.queueReady, NULL);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serveSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (threads > SERVE_MAX_THREADS) {
+        threads = SERVE_MAX_THREADS;
+    }
+    for (k = 0; k < threads; k++) {
+        if (pthread_create(&tid[k], NULL, serveWorker, &sv) != 0) {
+            break;
+        }
+    }
+    threads = k;
+    if (threads == 0) {
+        fprintf(stderr, "Unable to start the worker threads\n");
+        return 1;
+    }
+    fprintf(stderr, "Listening on %s with %d workers\n", address, threads);
+
+    flushed = benchNow();
+    while (!serveStop) {
+        n = epoll_wait(sv.epoll, events, SERVE_EVENTS, SERVE_FLUSH_MS);
+        now = benchNow();
+        if (now - flushed >= SERVE_FLUSH_MS / 1000.0) {
+            /*Write out anything logged since the last flush, on time rather than when idle so a busy service still checkpoints*/
+            pthread_mutex_lock(&sv.logLock);
+            if (sv.dirty) {
+                if (log == NULL) {
+                    fflush(out);
+                } else if (logWriterFlush(log) != 0) {
+                    fprintf(stderr, "Unable to write the log, its records are kept in the journal\n");
+                }
+                if (charts != NULL && spcSave(charts, chartFile) != 0) {
+                    fprintf(stderr, "Unable to save the control charts to %s\n", chartFile);
+                }
+                if (archive != NULL) {
+                    fflush(archive);
+                }
+                if (sketches != NULL && sketchSave(sketches, sketchFile) != 0) {
+                    fprintf(stderr, "Unable to save the sketches to %s\n", sketchFile);
+                }
+                sv.dirty = 0;
+            }
+            pthread_mutex_unlock(&sv.logLock);
+            flushed = now;
+        }
+        for (i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                while ((fd = accept(sv.listener, NULL, NULL)) >= 0) {
+                    c = malloc(sizeof(*c));
+                    if (c == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+                        free(c);
+                        close(fd);
+                        continue;
+                    }
+                    c->fd = fd;
+                    c->used = 0;
+                    c->discard = 0;
+                    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                    event.data.ptr = c;
+                    epoll_ctl(sv.epoll, EPOLL_CTL_ADD, fd, &event);
+                }
+                continue;
+            }
+            c = events[i].data.ptr;
+            c->next = NULL;
+            pthread_mutex_lock(&sv.queueLock);
+            if (sv.head == NULL) {
+                sv.head = c;
+            } else {
+                sv.tail->next = c;
+            }
+            sv.tail = c;
+            pthread_cond_signal(&sv.queueReady);
+            pthread_mutex_unlock(&sv.queueLock);
+        }
+    }
+
+    fprintf(stderr, "Shutting down\n");
+    pthread_mutex_lock(&sv.queueLock);
+    sv.stop = 1;
+    pthread_cond_broadcast(&sv.queueReady);
+    pthread_mutex_unlock(&sv.queueLock);
+    for (k = 0; k < threads; k++) {
+        pthread_join(tid[k], NULL);
+    }
+    close(sv.listener);
+    close(sv.epoll);
+    if (strspn(address, "0123456789") != strlen(address)) {
+        unlink(address);
+    }
+    return 0;
+#else
+    fprintf(stderr, "The acceptance service needs Linux (epoll)\n");
+    return 1;
+#endif
+}
+
+int submit(const char* address) {
+    /*
+    Name: submit
+    Function: Send batches from stdin to an acceptance service, one per line, and print each response
+    Paramaters: const char* address - Unix socket path or localhost TCP port of the service
+    Variables: fd, line, reply, len, got, used
+    Returns 0 on success, 1 if the service can't be reached or closes the connection
+     */
+#ifdef SERVE_EPOLL
+    int fd;
+    char line[SERVE_LINE_MAX], reply[SERVE_REPLY_BYTES];
+    long len, got, used;
+
+    fd = serveConnect(address);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to connect to %s\n", address);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') {
+            line[len++] = '\n';
+        }
+        if (len == 1 || serveSend(fd, line, len) != 0) {
+            continue;
+        }
+        used = 0;
+        do {
+            got = recv(fd, reply + used, sizeof(reply) - 1 - used, 0);
+            if (got <= 0) {
+                fprintf(stderr, "Connection to %s closed\n", address);
+                close(fd);
+                return 1;
+            }
+            used += got;
+        } while (reply[used - 1] != '\n' && used < (long) sizeof(reply) - 1);
+        fwrite(reply, 1, used, stdout);
+    }
+    close(fd);
+    return 0;
+#else
+    fprintf(stderr, "The acceptance service needs Linux (epoll)\n");
+    return 1;
+#endif
+}
+
+int rig(int count, char* sources[], const registry* suppliers, FILE* out, logWriter* log, spcTable* charts, const char* chartFile,
+        sketchTable* sketches, const char* sketchFile, FILE* archive, const samplingPlan* plan, long idle, int follow) {
+    /*
+    Name: rig
+    Function: Read the measurement streams of several instruments at once and evaluate each station's batches as readings arrive
+    Paramaters: int count - Number of sources, char* sources[] - FIFOs (created if they don't exist), "-" for stdin, or files
+                            const registry* suppliers - Supplier ids for the charts, sketches and archive
+                            FILE* out - Text log for the records, logWriter* log - Binary log to append the records to instead of out (NULL to use out)
+                            spcTable* charts - Control charts to add the readings to (NULL for none), const char* chartFile - Where they are saved
+                            sketchTable* sketches - Sketches to add the readings to (NULL for none), const char* sketchFile - Where they are saved
+                            FILE* archive - Raw reading archive to append each batch's readings to (NULL for none)
+                            const samplingPlan* plan - Sampling plan deciding each batch (NULL to use every reading)
+                            long idle - Milliseconds without readings after which a station's batch is finished (0 never)
+                            int follow - Keep reading: reopen a FIFO for its next writer and wait for more of a file, until SIGINT or SIGTERM
+    Variables: stations, st, total, epoll, events, action, n, i, k, active, dirty, now, flushed
+    Each source is a station with its own batch state (as ingestFile() keeps for a file), so readings in the --ingest format
+    from different instruments never mix. FIFOs and pipes are non-blocking and waited on with epoll, files are read to their end
+    on every wake up (epoll doesn't work on files). One thread does everything, in the order the readings arrive. A station's
+    batch ends when its key changes, its writer closes, it has been idle or the rig stops. The log and archive are flushed
+    (and the control charts and sketches saved) every RIG_WAIT_MS while anything has been logged, however busy the stations are.
+    Linux only, elsewhere an error is reported.
+    Returns 0 when every source has ended (or after SIGINT or SIGTERM), 1 if a source can't be opened
+     */
+#ifdef SERVE_EPOLL
+    rigStation *stations, *st;
+    ingest total;
+    struct epoll_event events[SERVE_EVENTS];
+    struct sigaction action;
+    int epoll, n, i, k, active, dirty = 0;
+    double now, flushed = 0;
+
+    stations = calloc(count, sizeof(*stations));
+    epoll = epoll_create1(0);
+    if (stations == NULL || epoll < 0) {
+        fprintf(stderr, "Not enough memory for %d stations\n", count);
+        free(stations);
+        return 1;
+    }
+    for (k = 0; k < count; k++) {
+        st = &stations[k];
+        st->path = sources[k];
+        st->fd = -1;
+        st->state.out = out;
+        st->state.suppliers = suppliers;
+        st->state.log = log;
+        st->state.charts = charts;
+        st->state.sketches = sketches;
+        st->state.plan = plan;
+        st->state.source = sources[k];
+        archiveInit(&st->frames);
+        if (archive != NULL) {
+            st->state.archive = &st->frames;
+            st->state.archiveFile = archive;
+        }
+        if (rigOpen(st, epoll) != 0) {
+            fprintf(stderr, "Unable to open %s\n", sources[k]);
+            for (; k >= 0; k--) {
+                if (stations[k].fd > 0) {
+                    close(stations[k].fd);
+                }
+            }
+            close(epoll);
+            free(stations);
+            return 1;
+        }
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = serveSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    fprintf(stderr, "Reading %d station%s\n", count, count > 1 ? "s" : "");
+
+    for (active = count; active > 0 && !serveStop;) {
+        for (k = 0; k < count; k++) {
+            st = &stations[k];
+            if (st->fd >= 0 && !st->fifo && rigRead(st) != 0 && !follow) {
+                rigClose(st, epoll);
+                active--;
+                dirty = 1;
+            }
+        }
+        n = epoll_wait(epoll, events, SERVE_EVENTS, RIG_WAIT_MS);
+        for (i = 0; i < n; i++) {
+            st = events[i].data.ptr;
+            if (rigRead(st) == 0) {
+                continue;
+            }
+            /*Every writer has closed the FIFO (or the pipe)*/
+            rigClose(st, epoll);
+            dirty = 1;
+            if (!follow || strcmp(st->path, "-") == 0 || rigOpen(st, epoll) != 0) {
+                active--;
+            }
+        }
+        now = benchNow();
+        for (k = 0; k < count; k++) {
+            st = &stations[k];
+            if (st->last > flushed) {
+                dirty = 1;
+            }
+            if (idle > 0 && st->state.valid && now - st->last >= idle / 1000.0) {
+                rigEndBatch(st);
+                dirty = 1;
+            }
+        }
+        if (dirty && now - flushed >= RIG_WAIT_MS / 1000.0) {
+            /*Write out anything logged since the last flush, on time rather than when quiet so a steady stream still checkpoints*/
+            if (log == NULL) {
+                fflush(out);
+            } else if (logWriterFlush(log) != 0) {
+                fprintf(stderr, "Unable to write the log, its records are kept in the journal\n");
+            }
+            if (archive != NULL) {
+                fflush(archive);
+            }
+            if (charts != NULL && spcSave(charts, chartFile) != 0) {
+                fprintf(stderr, "Unable to save the control charts to %s\n", chartFile);
+            }
+            if (sketches != NULL && sketchSave(sketches, sketchFile) != 0) {
+                fprintf(stderr, "Unable to save the sketches to %s\n", sketchFile);
+            }
+            dirty = 0;
+            flushed = now;
+        }
+    }
+
+    memset(&total, 0, sizeof(total));
+    for (k = 0; k < count; k++) {
+        st = &stations[k];
+        if (st->fd >= 0) {
+            rigClose(st, epoll);
+        }
+        fprintf(stderr, "%s: %ld lines, %ld batches\n", st->path, st->state.line, st->state.batches);
+        if (st->frames.failed) {
+            fprintf(stderr, "Not enough memory to archive %s, some batches are missing from the archive\n", st->path);
+        }
+        for (i = 0; i < 3; i++) {
+            total.decisions[i] += st->state.decisions[i];
+        }
+        total.offered += st->state.offered;
+        total.needed += st->state.needed;
+        archiveFree(&st->frames);
+    }
+    if (plan != NULL) {
+        ingestDecisions(&total);
+    }
+    close(epoll);
+    free(stations);
+    return 0;
+#else
+    fprintf(stderr, "The rig input needs Linux (epoll)\n");
+    return 1;
+#endif
+}
+
+#ifdef SERVE_EPOLL
+int rigOpen(rigStation* st, int epoll) {
+    /*
+    Name: rigOpen
+    Function: Open a station's source for non-blocking reads and wait on it with epoll if it is a FIFO or pipe
+    Paramaters: rigStation* st - Pointer to the station, int epoll - The rig's epoll instance
+    Variables: info, event, flags
+    A source that doesn't exist is created as a FIFO for an instrument (or --replay) to write to. Opening a FIFO doesn't wait
+    for a writer, and epoll only reports it once one has connected.
+    Returns 0 on success, 1 if it can't be opened
+     */
+    struct stat info;
+    struct epoll_event event;
+    int flags;
+
+    if (strcmp(st->path, "-") == 0) {
+        st->fd = 0;
+    } else {
+        if (stat(st->path, &info) != 0 && mkfifo(st->path, 0600) != 0) {
+            return 1;
+        }
+        st->fd = open(st->path, O_RDONLY | O_NONBLOCK);
+    }
+    if (st->fd < 0 || fstat(st->fd, &info) != 0 || (flags = fcntl(st->fd, F_GETFL)) < 0 || fcntl(st->fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        return 1;
+    }
+    st->fifo = !S_ISREG(info.st_mode);
+    st->used = 0;
+    if (st->fifo) {
+        event.events = EPOLLIN;
+        event.data.ptr = st;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, st->fd, &event) != 0) {
+            close(st->fd);
+            st->fd = -1;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int rigRead(rigStation* st) {
+    /*
+    Name: rigRead
+    Function: Read what a station's source has waiting and evaluate each complete line
+    Paramaters: rigStation* st - Pointer to the station
+    Variables: got, start, end, lineEnd, lines
+    Lines go through ingestLine() as soon as they are complete, a partial line is kept for the next read. A line longer than
+    RIG_LINE_MAX is dropped.
+    Returns 0 when there is nothing more to read for now, 1 at the end of the source
+     */
+    long got, lines;
+    const char *start, *end, *lineEnd;
+    PROFILE_TIMER(timer);
+
+    for (;;) {
+        got = read(st->fd, st->buffer + st->used, RIG_LINE_MAX - st->used);
+        if (got < 0) {
+            return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+        }
+        if (got == 0) {
+            return 1;
+        }
+        st->last = benchNow();
+        start = st->buffer;
+        end = st->buffer + st->used + got;
+        lines = st->state.line;
+        PROFILE_BEGIN(timer);
+        while ((lineEnd = memchr(start, '\n', end - start)) != NULL) {
+            st->state.line++;
+            ingestLine(&st->state, start, lineEnd);
+            start = lineEnd + 1;
+        }
+        PROFILE_END(PROFILE_PARSE, timer, st->state.line - lines, got);
+        st->used = end - start;
+        if (st->used == RIG_LINE_MAX) {
+            fprintf(stderr, "%s line %ld is too long, skipping it\n", st->path, st->state.line + 1);
+            st->used = 0;
+        } else {
+            memmove(st->buffer, start, st->used);
+        }
+    }
+}
+
+void rigEndBatch(rigStation* st) {
+    /*
+    Name: rigEndBatch
+    Function: Finish a station's batch in progress and write its record
+    Paramaters: rigStation* st - Pointer to the station
+    Variables: -
+    The key is forgotten too, so the station's next reading starts a new batch even if its key is the same
+     */
+    if (st->state.valid) {
+        ingestBatchEnd(&st->state);
+    }
+    st->state.valid = 0;
+    st->state.keyLen = 0;
+}
+
+void rigClose(rigStation* st, int epoll) {
+    /*
+    Name: rigClose
+    Function: Close a station's source, evaluating a last line without a newline and finishing its batch
+    Paramaters: rigStation* st - Pointer to the station, int epoll - The rig's epoll instance
+    Variables: -
+     */
+    if (st->used > 0) {
+        st->state.line++;
+        ingestLine(&st->state, st->buffer, st->buffer + st->used);
+        st->used = 0;
+    }
+    rigEndBatch(st);
+    if (st->fifo) {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, st->fd, NULL);
+    }
+    if (st->fd > 0) {
+        close(st->fd);
+    }
+    st->fd = -1;
+}
+
+long replayBatch(const char* base, long size, long pos) {
+    /*
+    Name: replayBatch
+    Function: Find the end of the batch starting at an offset of a measurement file
+    Paramaters: const char* base, long size - File contents, long pos - Offset of the batch's first line
+    Variables: p, lineEnd, key, keyLen, n
+    Blank, comment and unreadable lines stay with the batch they are in
+    Returns the offset of the next batch's first line (size if none)
+     */
+    const char *p, *lineEnd, *key = NULL;
+    int keyLen = 0, n;
+
+    while (pos < size) {
+        p = base + pos;
+        lineEnd = memchr(p, '\n', size - pos);
+        n = ingestKey(p, lineEnd != NULL ? lineEnd : base + size);
+        if (n > 0) {
+            if (key == NULL) {
+                key = p;
+                keyLen = n;
+            } else if (n != keyLen || memcmp(p, key, n) != 0) {
+                break;
+            }
+        }
+        pos = lineEnd != NULL ? lineEnd + 1 - base : size;
+    }
+    return pos;
+}
+#endif
+
+int replay(const char* fileName, int count, char* targets[], double rate) {
+    /*
+    Name: replay
+    Function: Simulate instruments by writing a measurement file to FIFOs (or files) at a set rate, for testing --rig offline
+    Paramaters: const char* fileName - Measurement file, int count - Number of targets, char* targets[] - FIFOs or files to write to
+                            double rate - Readings a second written to each target (0 as fast as they are read)
+    Variables: base, size, fd, pos, end, credit, action, start, last, now, active, lines, total, from, k, i
+    The file's batches are dealt to the targets in turn, and each target writes its batches' lines one after another, paced in
+    RIG_TICK_MS steps, so the targets stream concurrently as instruments at different stations would. Opening a FIFO waits for
+    the rig to open it. Each target is closed after its last batch, which ends that station for the rig.
+    Linux only, elsewhere an error is reported.
+    Returns 0 on success, 1 if the file or a target can't be opened, or a target closes early
+     */
+#ifdef SERVE_EPOLL
+    const char *base, *p;
+    long size, pos[RIG_MAX_SOURCES], end[RIG_MAX_SOURCES], lines, total = 0, from;
+    int fd[RIG_MAX_SOURCES], active, status = 0, k, i;
+    double credit[RIG_MAX_SOURCES], start, last, now;
+    struct sigaction action;
+    struct timespec tick;
+
+    if (mapFile(fileName, &base, &size) != 0) {
+        fprintf(stderr, "Unable to read measurement file %s\n", fileName);
+        return 1;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, NULL);
+    for (k = 0; k < count; k++) {
+        fd[k] = open(targets[k], O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd[k] < 0) {
+            fprintf(stderr, "Unable to open %s\n", targets[k]);
+            for (k--; k >= 0; k--) {
+                close(fd[k]);
+            }
+            unmapFile(base, size);
+            return 1;
+        }
+        for (pos[k] = 0, i = 0; i < k; i++) {
+            pos[k] = replayBatch(base, size, pos[k]);
+        }
+        end[k] = replayBatch(base, size, pos[k]);
+        credit[k] = 0;
+    }
+    tick.tv_sec = 0;
+    tick.tv_nsec = RIG_TICK_MS * 1000000L;
+    start = last = benchNow();
+    for (active = count; active > 0;) {
+        now = benchNow();
+        for (k = 0; k < count; k++) {
+            if (fd[k] < 0) {
+                continue;
+            }
+            credit[k] += rate * (now - last);
+            if (credit[k] > rate) {
+                /*Don't catch up in a burst after a write had to wait for the reader*/
+                credit[k] = rate;
+            }
+            for (from = pos[k], lines = 0; pos[k] < end[k] && (rate <= 0 || lines < (long) credit[k]); lines++) {
+                p = memchr(base + pos[k], '\n', end[k] - pos[k]);
+                pos[k] = p != NULL ? p + 1 - base : end[k];
+            }
+            credit[k] -= lines;
+            total += lines;
+            for (p = base + from; p < base + pos[k]; p += i) {
+                i = (int) write(fd[k], p, base + pos[k] - p);
+                if (i <= 0) {
+                    fprintf(stderr, "%s was closed by its reader\n", targets[k]);
+                    pos[k] = size;
+                    status = 1;
+                    break;
+                }
+            }
+            if (pos[k] == end[k]) {
+                /*Skip the other targets' batches*/
+                for (i = 1; i < count; i++) {
+                    pos[k] = replayBatch(base, size, pos[k]);
+                }
+                end[k] = replayBatch(base, size, pos[k]);
+            }
+            if (pos[k] >= size) {
+                close(fd[k]);
+                fd[k] = -1;
+                active--;
+            }
+        }
+        last = now;
+        if (rate > 0) {
+            nanosleep(&tick, NULL);
+        }
+    }
+    fprintf(stderr, "Replayed %ld lines to %d target%s in %.2f s\n", total, count, count > 1 ? "s" : "", benchNow() - start);
+    unmapFile(base, size);
+    return status;
+#else
+    fprintf(stderr, "Replaying to FIFOs needs Linux\n");
+    return 1;
+#endif
+}
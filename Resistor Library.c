@@ -0,0 +1,4080 @@
+/* 
+Resistor Library
+    Implementation of Resistor Library.h, see the header for what the library provides
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <time.h>
+#include <limits.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#define LOG_MMAP
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLASSIFY_X86
+#endif
+
+#include "Resistor Library.h"
+
+#if defined(__GNUC__)
+#define PROFILE_LOCAL __thread
+#else
+#define PROFILE_LOCAL
+#endif
+
+/*Colour code decode tables, nominal value tables are indexed by the significant digits then the multiplier band*/
+#define MULTIPLIER_ROW(v) (v) * 0.01, (v) * 0.1, (v) * 1.0, (v) * 10.0, (v) * 100.0, (v) * 1000.0, (v) * 10000.0, (v) * 100000.0, (v) * 1000000.0, (v) * 10000000.0
+#define DIGIT_ROW(v) MULTIPLIER_ROW((v) * 10), MULTIPLIER_ROW((v) * 10 + 1), MULTIPLIER_ROW((v) * 10 + 2), MULTIPLIER_ROW((v) * 10 + 3), MULTIPLIER_ROW((v) * 10 + 4), \
+        MULTIPLIER_ROW((v) * 10 + 5), MULTIPLIER_ROW((v) * 10 + 6), MULTIPLIER_ROW((v) * 10 + 7), MULTIPLIER_ROW((v) * 10 + 8), MULTIPLIER_ROW((v) * 10 + 9)
+#define DIGIT_ROWS(v) DIGIT_ROW((v) * 10), DIGIT_ROW((v) * 10 + 1), DIGIT_ROW((v) * 10 + 2), DIGIT_ROW((v) * 10 + 3), DIGIT_ROW((v) * 10 + 4), \
+        DIGIT_ROW((v) * 10 + 5), DIGIT_ROW((v) * 10 + 6), DIGIT_ROW((v) * 10 + 7), DIGIT_ROW((v) * 10 + 8), DIGIT_ROW((v) * 10 + 9)
+
+static const double multiplierTable[10] = {0.01, 0.1, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000};
+static const double toleranceTable[7] = {0.1, 0.05, 0.01, 0.02, 0.005, 0.0025, 0.001};
+static const int temperatureTable[4] = {100, 50, 15, 25};
+static const double twoDigitTable[1000] = {DIGIT_ROW(0), DIGIT_ROW(1), DIGIT_ROW(2), DIGIT_ROW(3), DIGIT_ROW(4), DIGIT_ROW(5), DIGIT_ROW(6), DIGIT_ROW(7), DIGIT_ROW(8), DIGIT_ROW(9)};
+static const double threeDigitTable[10000] = {DIGIT_ROWS(0), DIGIT_ROWS(1), DIGIT_ROWS(2), DIGIT_ROWS(3), DIGIT_ROWS(4), DIGIT_ROWS(5), DIGIT_ROWS(6), DIGIT_ROWS(7), DIGIT_ROWS(8), DIGIT_ROWS(9)};
+/*Standard (E series) values decodable by idealVal(), each table is every series value times every multiplier, in ascending order*/
+#define E12_DECADE(m) 10 * (m), 12 * (m), 15 * (m), 18 * (m), 22 * (m), 27 * (m), 33 * (m), 39 * (m), 47 * (m), 56 * (m), 68 * (m), 82 * (m)
+#define E24_DECADE(m) 10 * (m), 11 * (m), 12 * (m), 13 * (m), 15 * (m), 16 * (m), 18 * (m), 20 * (m), 22 * (m), 24 * (m), 27 * (m), 30 * (m), \
+        33 * (m), 36 * (m), 39 * (m), 43 * (m), 47 * (m), 51 * (m), 56 * (m), 62 * (m), 68 * (m), 75 * (m), 82 * (m), 91 * (m)
+#define E96_DECADE(m) 100 * (m), 102 * (m), 105 * (m), 107 * (m), 110 * (m), 113 * (m), 115 * (m), 118 * (m), 121 * (m), 124 * (m), 127 * (m), 130 * (m), \
+        133 * (m), 137 * (m), 140 * (m), 143 * (m), 147 * (m), 150 * (m), 154 * (m), 158 * (m), 162 * (m), 165 * (m), 169 * (m), 174 * (m), \
+        178 * (m), 182 * (m), 187 * (m), 191 * (m), 196 * (m), 200 * (m), 205 * (m), 210 * (m), 215 * (m), 221 * (m), 226 * (m), 232 * (m), \
+        237 * (m), 243 * (m), 249 * (m), 255 * (m), 261 * (m), 267 * (m), 274 * (m), 280 * (m), 287 * (m), 294 * (m), 301 * (m), 309 * (m), \
+        316 * (m), 324 * (m), 332 * (m), 340 * (m), 348 * (m), 357 * (m), 365 * (m), 374 * (m), 383 * (m), 392 * (m), 402 * (m), 412 * (m), \
+        422 * (m), 432 * (m), 442 * (m), 453 * (m), 464 * (m), 475 * (m), 487 * (m), 499 * (m), 511 * (m), 523 * (m), 536 * (m), 549 * (m), \
+        562 * (m), 576 * (m), 590 * (m), 604 * (m), 619 * (m), 634 * (m), 649 * (m), 665 * (m), 681 * (m), 698 * (m), 715 * (m), 732 * (m), \
+        750 * (m), 768 * (m), 787 * (m), 806 * (m), 825 * (m), 845 * (m), 866 * (m), 887 * (m), 909 * (m), 931 * (m), 953 * (m), 976 * (m)
+#define ALL_DECADES(DECADE) DECADE(0.01), DECADE(0.1), DECADE(1.0), DECADE(10.0), DECADE(100.0), DECADE(1000.0), DECADE(10000.0), \
+        DECADE(100000.0), DECADE(1000000.0), DECADE(10000000.0)
+
+static const unsigned short e12Digits[12] = {E12_DECADE(1)};
+static const unsigned short e24Digits[24] = {E24_DECADE(1)};
+static const unsigned short e96Digits[96] = {E96_DECADE(1)};
+static const double e12Table[120] = {ALL_DECADES(E12_DECADE)};
+static const double e24Table[240] = {ALL_DECADES(E24_DECADE)};
+static const double e96Table[960] = {ALL_DECADES(E96_DECADE)};
+/*Histogram bin edges of sketchBin(), SKETCH_BINS_PER_DECADE to a decade from SKETCH_BIN_FLOOR up to 1*/
+#define SKETCH_DECADE(m) (m) * 1.0, (m) * 1.1220184543019633, (m) * 1.2589254117941673, (m) * 1.4125375446227544, (m) * 1.5848931924611136, \
+        (m) * 1.7782794100389228, (m) * 1.9952623149688795, (m) * 2.2387211385683394, (m) * 2.5118864315095801, (m) * 2.8183829312644537, \
+        (m) * 3.1622776601683795, (m) * 3.5481338923357550, (m) * 3.9810717055349722, (m) * 4.4668359215096318, (m) * 5.0118723362727220, \
+        (m) * 5.6234132519034912, (m) * 6.3095734448019334, (m) * 7.0794578438413787, (m) * 7.9432823472428158, (m) * 8.9125093813374541
+static const double sketchEdges[SKETCH_SIDE_BINS] = {SKETCH_DECADE(1e-6), SKETCH_DECADE(1e-5), SKETCH_DECADE(1e-4), SKETCH_DECADE(1e-3),
+        SKETCH_DECADE(1e-2), SKETCH_DECADE(1e-1), 1.0};
+/*CRC-32 (IEEE 802.3, reflected) of each 4 bit value, used to check journal frames a nibble at a time*/
+static const unsigned int crcNibbleTable[16] = {0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+/*ANSI/ASQ Z1.4 normal inspection: upper lot size of code letters A to P at general inspection level II (larger lots are Q),
+  sample size of letters A to R, and the AQLs (percent) the letter + AQL diagonals of the tables are numbered by, see planZ14()*/
+static const long z14Lots[14] = {8, 15, 25, 50, 90, 150, 280, 500, 1200, 3200, 10000, 35000, 150000, 500000};
+static const long z14Samples[16] = {2, 3, 5, 8, 13, 20, 32, 50, 80, 125, 200, 315, 500, 800, 1250, 2000};
+static const double z14Aqls[16] = {0.010, 0.015, 0.025, 0.040, 0.065, 0.10, 0.15, 0.25, 0.40, 0.65, 1.0, 1.5, 2.5, 4.0, 6.5, 10};
+/*Plans on the diagonals 3 to 10 past the 0/1 plan (the two between are arrows): single acceptance number, double Ac1, Re1 and Ac2*/
+static const int z14Single[8] = {1, 2, 3, 5, 7, 10, 14, 21};
+static const int z14Double[8][3] = {{0, 2, 1}, {0, 3, 3}, {1, 4, 4}, {2, 5, 6}, {3, 7, 8}, {5, 9, 12}, {7, 11, 18}, {11, 16, 26}};
+const char* const decodeErrors[6] = {"OK", "Invalid number of bands", "Invalid digit band", "Invalid multiplier band", "Invalid tolerance band", "Invalid temperature band"};
+
+const char* const registryErrors[5] = {"OK", "Invalid supplier id", "Invalid supplier name", "Supplier id already used", "Supplier name already used"};
+
+const char* const suppliers[SUPPLIER_COUNT] = {"Farnell", "RSComponents", "Rapid Electronics", "DigiKey"};
+
+const char* const spcAlerts[4] = {"EWMA above the upper control limit", "EWMA below the lower control limit", "CUSUM of increases over the decision limit",
+        "CUSUM of decreases over the decision limit"};
+
+const char* const planDecisions[3] = {"undecided", "accept", "reject"};
+
+const char* const profileStages[PROFILE_STAGES] = {"parse", "decode", "classify", "statistics", "log append", "log scan"};
+
+/*A retained item of a quantile sketch with its level (weight 2^level), see sketchQuantiles()*/
+struct sketchItem {
+    float value;
+    unsigned int level;
+};
+
+/*Instrumentation counters, each thread claims a row of profileSlots the first time it ends a timer (see profileEnd())*/
+static struct profileCounter profileSlots[PROFILE_THREADS][PROFILE_STAGES];
+static int profileUsed = 0;
+static unsigned long long profileBaseTicks = 0;
+static double profileBaseMillis = 0;
+static PROFILE_LOCAL struct profileCounter* profileMine = NULL;
+static PROFILE_LOCAL unsigned long long profileInner = 0;
+
+int parseDate(const char* text, size_t len, long* day) {
+    /*
+    Name: parseDate
+    Function: Validate a date in the form ddMMyyyy and convert it to a day number
+    Paramaters: const char* text - Date text (need not be terminated), size_t len - Length of the text, long* day - Set to the day number if valid
+    Variables: daysPerMonth[], i, d, m, y, dateInt
+    Returns 1 if the text is a valid date, otherwise 0
+     */
+    int daysPerMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int i, d, m, y;
+    long dateInt = 0;
+
+    if (len != 8) {
+        return 0;
+    }
+    for (i = 0; i < 8; i++) {
+        if (!isdigit((unsigned char) text[i])) {
+            return 0;
+        }
+        dateInt = dateInt * 10 + text[i] - '0';
+    }
+    d = dateInt / 1000000;
+    m = dateInt / 10000 - d * 100;
+    y = dateInt - d * 1000000L - m * 10000;
+    if (y % 400 == 0 || (y % 100 != 0 && y % 4 == 0)) {
+        daysPerMonth[1] = 29;
+    }
+    if (d < 1 || m < 1 || m > 12 || daysPerMonth[m - 1] < d) {
+        return 0;
+    }
+    *day = dayNumber(d, m, y);
+    return 1;
+}
+
+long dayNumber(int d, int m, int y) {
+    /*
+    Name: dayNumber
+    Function: Return the number of days from 1 January 1970 to a date, so dates sort and subtract as integers
+    Paramaters: int d, int m, int y - Day, month and year
+    Variables: era, yoe, doy, doe
+    Function counts in 400 year eras of the Gregorian calendar with the year starting in March, so leap days fall at the end of a year
+     */
+    long era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void dayToDate(long day, int* d, int* m, int* y) {
+    /*
+    Name: dayToDate
+    Function: Convert a day number from dayNumber() back to a day, month and year
+    Paramaters: long day - Day number, int* d, int* m, int* y - Set to the date
+    Variables: era, doe, yoe, doy, mp
+     */
+    long era, doe, yoe, doy, mp;
+
+    day += 719468;
+    era = (day >= 0 ? day : day - 146096) / 146097;
+    doe = day - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    *d = (int) (doy - (153 * mp + 2) / 5 + 1);
+    *m = (int) (mp < 10 ? mp + 3 : mp - 9);
+    *y = (int) (yoe + era * 400 + (*m <= 2));
+}
+
+char* formatDate(long day, char* out) {
+    /*
+    Name: formatDate
+    Function: Write a day number as ddMMyyyy text
+    Paramaters: long day - Day number, char* out - Buffer of at least 9 characters
+    Variables: d, m, y
+    Returns out so the call can be used as a printf argument
+     */
+    int d, m, y;
+    dayToDate(day, &d, &m, &y);
+    sprintf(out, "%02d%02d%04d", d, m, y);
+    return out;
+}
+
+double idealVal(int bandOne, int bandTwo, int bandThree, int bandFour, int bands) {
+    /*
+    Name: idealVal
+    Function: to return the nominal value based on the number of bands and the colours given
+    Paramaters: int bandOne, int bandTwo, int bandThree, int bandFout, int bands
+    Variables: -
+    Function will return the nominal value based on the colours of the bands input by using one of two tables (4 or 5/6 bands)
+    If 4 bands is the case, band 3 is the multiplier and indexes twoDigitTable, otherwise band 4 is the multiplier and indexes threeDigitTable
+    The tables hold every digit and multiplier combination and are built at compile time, so no arithmetic is done per call.
+    Returns 0 for invalid colours
+     */
+    if (bandOne < 0 || bandOne > 9 || bandTwo < 0 || bandTwo > 9 || bandThree < 0 || bandThree > 9) {
+        return 0;
+    }
+    switch (bands) {
+        case 4:
+            return twoDigitTable[(bandOne * 10 + bandTwo) * 10 + bandThree];
+        case 5:
+        case 6:
+            if (bandFour >= 0 && bandFour <= 9) {
+                return threeDigitTable[((bandOne * 100) + (bandTwo * 10) + bandThree) * 10 + bandFour];
+            }
+    }
+    return 0;
+}
+
+double multVal(int value) {
+    /*
+    Name: multVal
+    Function: Return the value of the multiplier band
+    Paramaters: int value
+    Variables: -
+    Function will return the value of the multiplier based on an integer input that would represent the index of a colour in the multiplierColours array 
+    Returns 0 for an invalid index
+     */
+    if (value < 0 || value > 9) {
+        return 0;
+    }
+    return multiplierTable[value];
+}
+
+double tolVal(int value) {
+    /*
+    Name: tolVal
+    Function: Return the value of the tolerance band
+    Paramaters: int value
+    Variables: -
+    Function will return the value of the tolerance based on an integer input that would represent the index of a colour in the toleranceColours array
+    Returns 0 for an invalid index
+     */
+    if (value < 0 || value > 6) {
+        return 0;
+    }
+    return toleranceTable[value];
+}
+
+int tempVal(int value) {
+    /*
+    Name: tempVal
+    Function: Return the value of the temperature band
+    Paramaters: int value
+    Variables: -
+    Function will return the value of the temperature based on an integer inpur that would represent the index of a colour in the temperatureColours array 
+    Returns 0 for an invalid index
+     */
+    if (value < 0 || value > 3) {
+        return 0;
+    }
+    return temperatureTable[value];
+}
+
+int parseBandCode(const char* text, size_t len, bandCode* code) {
+    /*
+    Name: parseBandCode
+    Function: Convert a band code written as digits (the menu index of each colour, e.g. 1041) to a bandCode
+    Paramaters: const char* text - Digits (need not be terminated), size_t len - Number of digits, bandCode* code - Set to the code
+    Variables: i
+    Only the form is checked here, whether each colour is valid for its band is checked by decodeBands().
+    Returns 1 if the text is 4 to 6 digits, otherwise 0
+     */
+    size_t i;
+
+    if (len < 4 || len > 6) {
+        return 0;
+    }
+    memset(code, 0, sizeof(*code));
+    code->bands = (unsigned char) len;
+    for (i = 0; i < len; i++) {
+        if (!isdigit((unsigned char) text[i])) {
+            return 0;
+        }
+        code->colour[i] = (unsigned char) (text[i] - '0');
+    }
+    return 1;
+}
+
+long decodeBands(const bandCode* codes, long n, double* nominal, double* tolerance, int* tempco, unsigned char* status) {
+    /*
+    Name: decodeBands
+    Function: Decode an array of band codes in one pass
+    Paramaters: const bandCode* codes - Codes to decode, long n - Number of codes
+                            double* nominal, double* tolerance, int* tempco - Set to the nominal value, tolerance and temperature coefficient (ppm/K, 0 without a 6th band) of each code
+                            unsigned char* status - Set to DECODE_OK or the decodeStatus error of each code (outputs are 0 for codes with errors)
+    Variables: i, c, four, six, digits, multiplier, tol, temp, error, ok
+    The loop has no branches on the data, each band is selected and range checked arithmetically and out of range indexes are masked
+    to 0 before the table lookups, so the compiler can vectorise it. Returns the number of codes with errors
+     */
+    long i, errors = 0;
+    const unsigned char* c;
+    int four, six, digits, multiplier, tol, temp, error, ok;
+    PROFILE_TIMER(timer);
+
+    PROFILE_BEGIN(timer);
+    for (i = 0; i < n; i++) {
+        c = codes[i].colour;
+        four = codes[i].bands == 4;
+        six = codes[i].bands == 6;
+        digits = four ? c[0] * 10 + c[1] : c[0] * 100 + c[1] * 10 + c[2];
+        multiplier = four ? c[2] : c[3];
+        tol = four ? c[3] : c[4];
+        temp = six ? c[5] : 0;
+        error = (codes[i].bands < 4 || codes[i].bands > 6) ? DECODE_BAD_BANDS
+                : (c[0] > 9 || c[1] > 9 || (!four && c[2] > 9)) ? DECODE_BAD_DIGIT
+                : multiplier > 9 ? DECODE_BAD_MULTIPLIER
+                : tol > 6 ? DECODE_BAD_TOLERANCE
+                : temp > 3 ? DECODE_BAD_TEMPERATURE : DECODE_OK;
+        ok = error == DECODE_OK;
+        digits = ok ? digits * 10 + multiplier : 0;
+        tol = ok ? tol : 0;
+        temp = ok ? temp : 0;
+        nominal[i] = ok ? (four ? twoDigitTable[digits] : threeDigitTable[digits]) : 0;
+        tolerance[i] = ok ? toleranceTable[tol] : 0;
+        tempco[i] = ok && six ? temperatureTable[temp] : 0;
+        status[i] = (unsigned char) error;
+        errors += !ok;
+    }
+    PROFILE_END(PROFILE_DECODE, timer, n, n * sizeof(*codes));
+    return errors;
+}
+
+const struct standardSeries* findSeries(const char* name) {
+    /*
+    Name: findSeries
+    Function: Return the standard value series with a given name (E12, E24 or E96), or NULL if there is none
+    Paramaters: const char* name - Series name
+    Variables: series[], i
+    tolerance is the index in toleranceColours of the series' usual tolerance (10%, 5% and 1%)
+     */
+    static const struct standardSeries series[3] = {
+        {"E12", 120, 2, 0, e12Digits, e12Table},
+        {"E24", 240, 2, 1, e24Digits, e24Table},
+        {"E96", 960, 3, 2, e96Digits, e96Table}
+    };
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        if (strcmp(name, series[i].name) == 0) {
+            return &series[i];
+        }
+    }
+    return NULL;
+}
+
+long matchStandard(const double* readings, long n, const struct standardSeries* series, int tolerance, standardMatch* out) {
+    /*
+    Name: matchStandard
+    Function: Find the nearest standard value of a series, and its band code, for each of an array of measured values
+    Paramaters: const double* readings - Measured values, long n - Number of values, const struct standardSeries* series - Series from findSeries()
+                            int tolerance - Index of the tolerance colour (used for the tolerance band and the tolerance check), standardMatch* out - Set to the match for each value
+    Variables: i, base, len, half, index, digits, decade, lower, upper, x
+    The table is searched without data dependent branches: the range halves each step and the comparison only selects which half,
+    so the same number of steps is taken for every value. The nearest of the two neighbouring values is chosen on a log scale
+    (the boundary is their geometric mean), as the series are spaced. Returns the number of values within tolerance of their match
+     */
+    long i, base, len, half, index, inTolerance = 0;
+    int digits, decade;
+    double x, lower, upper;
+
+    for (i = 0; i < n; i++) {
+        x = readings[i];
+        base = 0;
+        len = series->length;
+        while (len > 1) {
+            half = len / 2;
+            base += series->table[base + half - 1] < x ? half : 0;
+            len -= half;
+        }
+        /*table[base] is the first value >= x (or the last value), its lower neighbour is the other candidate*/
+        index = base > 0 && x * x < series->table[base - 1] * series->table[base] ? base - 1 : base;
+        decade = (int) (index / (series->length / 10));
+        digits = series->digits[index % (series->length / 10)];
+        out[i].nominal = series->table[index];
+        memset(&out[i].code, 0, sizeof(out[i].code));
+        if (series->significant == 2) {
+            out[i].code.bands = 4;
+            out[i].code.colour[0] = (unsigned char) (digits / 10);
+            out[i].code.colour[1] = (unsigned char) (digits % 10);
+            out[i].code.colour[2] = (unsigned char) decade;
+            out[i].code.colour[3] = (unsigned char) tolerance;
+        } else {
+            out[i].code.bands = 5;
+            out[i].code.colour[0] = (unsigned char) (digits / 100);
+            out[i].code.colour[1] = (unsigned char) (digits / 10 % 10);
+            out[i].code.colour[2] = (unsigned char) (digits % 10);
+            out[i].code.colour[3] = (unsigned char) decade;
+            out[i].code.colour[4] = (unsigned char) tolerance;
+        }
+        lower = minTolVal(out[i].nominal, toleranceTable[tolerance]);
+        upper = maxTolVal(out[i].nominal, toleranceTable[tolerance]);
+        out[i].inTolerance = x >= lower && x <= upper;
+        inTolerance += out[i].inTolerance;
+    }
+    return inTolerance;
+}
+
+double minTolVal(double a, float b) {
+    /*
+    Name: minTolVal
+    Function: Return the minimum tolerance value of the batch
+    Paramaters: double a, double b
+    Variables: -
+    Function will calulate and return the minimum tolerance value
+     */
+    return a - a * b;
+}
+
+double maxTolVal(double a, float b) {
+    /*
+    Name: maxTolVal
+    Function: Return the maximum tolerance value of the batch
+    Paramaters: double a, double b
+    Variables: -
+    Function will calculate and return the maximum tolerance value
+     */
+    return a + a * b;
+}
+
+long classifyScalar(const double* x, long n, double lower, double upper, unsigned char* failMask) {
+    /*
+    Name: classifyScalar
+    Function: Portable version of classifyReadings()
+    Paramaters: see classifyReadings()
+    Variables: i, fail, bit
+    The comparison results are added rather than branched on so the loop has no data dependent branches
+     */
+    long i, fail = 0;
+    int bit;
+
+    if (failMask != NULL) {
+        memset(failMask, 0, (n + 7) / 8);
+    }
+    for (i = 0; i < n; i++) {
+        bit = (x[i] > upper) | (x[i] < lower);
+        fail += bit;
+        if (failMask != NULL) {
+            failMask[i >> 3] |= (unsigned char) (bit << (i & 7));
+        }
+    }
+    return fail;
+}
+
+#ifdef CLASSIFY_X86
+__attribute__((target("sse2")))
+static long classifySSE2(const double* x, long n, double lower, double upper, unsigned char* failMask) {
+    /*
+    Name: classifySSE2
+    Function: SSE2 version of classifyReadings(), 8 readings (one mask byte) per iteration
+    Paramaters: see classifyReadings()
+    Variables: i, j, fail, bits, lo, hi, v, out
+     */
+    long i, fail = 0;
+    int j, bits;
+    __m128d lo = _mm_set1_pd(lower), hi = _mm_set1_pd(upper), v, out;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        bits = 0;
+        for (j = 0; j < 8; j += 2) {
+            v = _mm_loadu_pd(x + i + j);
+            out = _mm_or_pd(_mm_cmpgt_pd(v, hi), _mm_cmplt_pd(v, lo));
+            bits |= _mm_movemask_pd(out) << j;
+        }
+        fail += __builtin_popcount(bits);
+        if (failMask != NULL) {
+            failMask[i >> 3] = (unsigned char) bits;
+        }
+    }
+    return fail + classifyScalar(x + i, n - i, lower, upper, failMask == NULL ? NULL : failMask + (i >> 3));
+}
+
+__attribute__((target("avx2")))
+static long classifyAVX2(const double* x, long n, double lower, double upper, unsigned char* failMask) {
+    /*
+    Name: classifyAVX2
+    Function: AVX2 version of classifyReadings(), 16 readings (two mask bytes) per iteration
+    Paramaters: see classifyReadings()
+    Variables: i, fail, bits, lo, hi, a, b, c, d
+     */
+    long i, fail = 0;
+    int bits;
+    __m256d lo = _mm256_set1_pd(lower), hi = _mm256_set1_pd(upper), a, b, c, d;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        a = _mm256_loadu_pd(x + i);
+        b = _mm256_loadu_pd(x + i + 4);
+        c = _mm256_loadu_pd(x + i + 8);
+        d = _mm256_loadu_pd(x + i + 12);
+        a = _mm256_or_pd(_mm256_cmp_pd(a, hi, _CMP_GT_OQ), _mm256_cmp_pd(a, lo, _CMP_LT_OQ));
+        b = _mm256_or_pd(_mm256_cmp_pd(b, hi, _CMP_GT_OQ), _mm256_cmp_pd(b, lo, _CMP_LT_OQ));
+        c = _mm256_or_pd(_mm256_cmp_pd(c, hi, _CMP_GT_OQ), _mm256_cmp_pd(c, lo, _CMP_LT_OQ));
+        d = _mm256_or_pd(_mm256_cmp_pd(d, hi, _CMP_GT_OQ), _mm256_cmp_pd(d, lo, _CMP_LT_OQ));
+        bits = _mm256_movemask_pd(a) | _mm256_movemask_pd(b) << 4 | _mm256_movemask_pd(c) << 8 | _mm256_movemask_pd(d) << 12;
+        fail += __builtin_popcount(bits);
+        if (failMask != NULL) {
+            failMask[i >> 3] = (unsigned char) bits;
+            failMask[(i >> 3) + 1] = (unsigned char) (bits >> 8);
+        }
+    }
+    return fail + classifySSE2(x + i, n - i, lower, upper, failMask == NULL ? NULL : failMask + (i >> 3));
+}
+#endif
+
+static long classifySelect(const double* x, long n, double lower, double upper, unsigned char* failMask) {
+    /*
+    Name: classifySelect
+    Function: Run the fastest classifyReadings() implementation the processor supports
+    Paramaters: As classifyReadings()
+    Variables: -
+    Returns the number of readings outside the limits
+     */
+#ifdef CLASSIFY_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return classifyAVX2(x, n, lower, upper, failMask);
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return classifySSE2(x, n, lower, upper, failMask);
+    }
+#endif
+    return classifyScalar(x, n, lower, upper, failMask);
+}
+
+long classifyReadings(const double* x, long n, double lower, double upper, unsigned char* failMask) {
+    /*
+    Name: classifyReadings
+    Function: Count the readings outside the tolerance limits of a batch
+    Paramaters: const double* x - Readings, long n - Number of readings, double lower, double upper - Limits from minTolVal() and maxTolVal()
+                            unsigned char* failMask - Optional ((n + 7) / 8 bytes), bit i is set if reading i is outside the limits
+    Variables: fail, timer
+    AVX2 or SSE2 is used where the processor supports them, otherwise classifyScalar(). The check reads the processor features
+    recorded at start up, so there is no state to share between threads
+    Returns the number of readings outside the limits
+     */
+    long fail;
+    PROFILE_TIMER(timer);
+
+    PROFILE_BEGIN(timer);
+    fail = classifySelect(x, n, lower, upper, failMask);
+    PROFILE_END(PROFILE_CLASSIFY, timer, n, n * sizeof(*x));
+    return fail;
+}
+
+void statsInit(stats* s) {
+    /*
+    Name: statsInit
+    Function: Reset a statistics accumulator to an empty sample
+    Paramaters: stats* s - Pointer to the accumulator
+    Variables: -
+     */
+    s->count = 0;
+    s->mean = 0;
+    s->m2 = 0;
+    s->min = HUGE_VAL;
+    s->max = -HUGE_VAL;
+}
+
+void statsAdd(stats* s, double x) {
+    /*
+    Name: statsAdd
+    Function: Add one reading to a statistics accumulator
+    Paramaters: stats* s - Pointer to the accumulator, double x - Reading
+    Variables: delta
+    Welford's update, m2 holds the sum of squared differences from the current mean so no second pass over the sample is needed
+     */
+    double delta = x - s->mean;
+
+    s->count++;
+    s->mean += delta / s->count;
+    s->m2 += delta * (x - s->mean);
+    if (x < s->min) {
+        s->min = x;
+    }
+    if (x > s->max) {
+        s->max = x;
+    }
+}
+
+void statsAddBlock(stats* s, const double* x, long n) {
+    /*
+    Name: statsAddBlock
+    Function: Add an array of readings to a statistics accumulator
+    Paramaters: stats* s - Pointer to the accumulator, const double* x - Readings, long n - Number of readings
+    Variables: i, block, sum, m2, mean, delta, min, max
+    The block's own mean and m2 are found with two passes over the (cache resident) array, which the compiler can vectorise,
+    and the result is merged into the accumulator. The result matches calling statsAdd() for each reading up to rounding
+     */
+    long i;
+    stats block;
+    double sum = 0, m2 = 0, mean, delta, min, max;
+    PROFILE_TIMER(timer);
+
+    if (n <= 0) {
+        return;
+    }
+    PROFILE_BEGIN(timer);
+    min = x[0];
+    max = x[0];
+    for (i = 0; i < n; i++) {
+        sum += x[i];
+        min = x[i] < min ? x[i] : min;
+        max = x[i] > max ? x[i] : max;
+    }
+    mean = sum / n;
+    for (i = 0; i < n; i++) {
+        delta = x[i] - mean;
+        m2 += delta * delta;
+    }
+    block.count = n;
+    block.mean = mean;
+    block.m2 = m2;
+    block.min = min;
+    block.max = max;
+    statsMerge(s, &block);
+    PROFILE_END(PROFILE_STATS, timer, n, n * sizeof(*x));
+}
+
+void statsMerge(stats* a, const stats* b) {
+    /*
+    Name: statsMerge
+    Function: Combine the accumulator of a second partial sample into the first
+    Paramaters: stats* a - Pointer to the accumulator to update, const stats* b - Pointer to the accumulator to merge in
+    Variables: n, delta
+    Function uses the pairwise update of Chan et al., the result is the same as adding every reading of b to a
+     */
+    double n, delta;
+
+    if (b->count == 0) {
+        return;
+    }
+    if (a->count == 0) {
+        *a = *b;
+        return;
+    }
+    n = (double) a->count + b->count;
+    delta = b->mean - a->mean;
+    a->mean += delta * b->count / n;
+    a->m2 += b->m2 + delta * delta * ((double) a->count * b->count / n);
+    a->count += b->count;
+    if (b->min < a->min) {
+        a->min = b->min;
+    }
+    if (b->max > a->max) {
+        a->max = b->max;
+    }
+}
+
+double statsVariance(const stats* s) {
+    /*
+    Name: statsVariance
+    Function: Return the variance of the sample (divided by the sample size, as the original sampleStandDev() did)
+    Paramaters: const stats* s - Pointer to the accumulator
+    Variables: -
+     */
+    return s->count > 0 ? s->m2 / s->count : 0;
+}
+
+void setBatchStats(data* d, const stats* s, long fail) {
+    /*
+    Name: setBatchStats
+    Function: Set the mean, standard deviation, variance, sample size and failure rate of a batch from its accumulator
+    Paramaters: data* d - Pointer to structure, const stats* s - Pointer to the accumulator, long fail - Readings outside tolerance
+    Variables: variance
+     */
+    double variance = statsVariance(s);
+
+    d->sampleSize = s->count;
+    d->meanResistance = s->mean;
+    d->varianceResistance = variance;
+    d->standDevResistance = sqrt(variance);
+    d->failureRate = s->count > 0 ? 100.0 * fail / s->count : 0;
+}
+
+long evaluateBatch(data* d, const double* readings, long n) {
+    /*
+    Name: evaluateBatch
+    Function: Check the readings of a batch against its tolerance and record the failure rate and statistics
+    Paramaters: data* d - Pointer to a structure with the nominal value and tolerance already set, const double* readings - Readings, long n - Number of readings
+    Variables: fail, sample
+    The calculation of measureBatch() without the console input, for callers that already have the readings
+    Returns the number of readings outside the tolerance limits
+     */
+    long fail;
+    stats sample;
+
+    fail = classifyReadings(readings, n, minTolVal(d->nominalValue, d->tolerance), maxTolVal(d->nominalValue, d->tolerance), NULL);
+    statsInit(&sample);
+    statsAddBlock(&sample, readings, n);
+    setBatchStats(d, &sample, fail);
+    return fail;
+}
+
+int planSprt(samplingPlan* p, double p0, double p1, double alpha, double beta, long limit) {
+    /*
+    Name: planSprt
+    Function: Set up Wald's sequential probability ratio test of a batch's fraction outside tolerance
+    Paramaters: samplingPlan* p - Pointer to the plan, double p0 - Acceptable fraction, double p1 - Rejectable fraction
+                            double alpha - Chance of rejecting a batch at p0, double beta - Chance of accepting a batch at p1
+                            long limit - Most readings to take (0 for PLAN_SPRT_TRUNCATE times the largest expected number)
+    Variables: g, most
+    The log likelihood ratio of d readings outside tolerance in n is d log(p1 / p0) + (n - d) log((1 - p1) / (1 - p0)), so the
+    test's bounds are two parallel lines in n: the batch is accepted once d <= slope * n - acceptOffset and rejected once
+    d >= slope * n + rejectOffset. The expected number of readings is largest between the lines, at about
+    acceptOffset * rejectOffset / (slope * (1 - slope)).
+    Returns 0 on success, 1 if the fractions or risks are out of range
+     */
+    double g, most;
+
+    if (!(p0 > 0 && p0 < p1 && p1 < 1 && alpha > 0 && beta > 0 && alpha + beta < 1) || limit < 0) {
+        return 1;
+    }
+    memset(p, 0, sizeof(*p));
+    p->type = PLAN_SPRT;
+    p->p0 = p0;
+    p->p1 = p1;
+    p->alpha = alpha;
+    p->beta = beta;
+    g = log(p1 / p0) + log((1 - p0) / (1 - p1));
+    p->slope = log((1 - p0) / (1 - p1)) / g;
+    p->acceptOffset = log((1 - alpha) / beta) / g;
+    p->rejectOffset = log((1 - beta) / alpha) / g;
+    most = p->acceptOffset * p->rejectOffset / (p->slope * (1 - p->slope));
+    p->limit = limit > 0 ? limit : (long) ceil(PLAN_SPRT_TRUNCATE * most);
+    return 0;
+}
+
+int planZ14(samplingPlan* p, int stages, long lot, double aql) {
+    /*
+    Name: planZ14
+    Function: Set up the single or double sampling plan of ANSI/ASQ Z1.4 (normal inspection, general inspection level II) for a lot
+    Paramaters: samplingPlan* p - Pointer to the plan, int stages - 1 for single sampling, 2 for double
+                            long lot - Lot size, double aql - Acceptance quality limit (percent, one of the standard's values up to 10)
+    Variables: letter, a, d, step, n
+    The lot size gives the code letter and sample size. The standard's tables are constant along their diagonals, so the plan is
+    found from the letter + AQL diagonal, following the arrows (use the first plan below or above) as the tables do, which can
+    change the sample size. A lot no bigger than the sample is inspected completely.
+    Returns 0 on success, 1 if the lot size or AQL is invalid
+     */
+    int letter, a, d, step = 0;
+    long n;
+
+    for (a = 0; a < 16 && fabs(aql / z14Aqls[a] - 1) > 1e-6; a++);
+    if (a == 16 || lot < 2 || (stages != 1 && stages != 2)) {
+        return 1;
+    }
+    for (letter = 0; letter < 14 && lot > z14Lots[letter]; letter++);
+    for (d = letter + a - 14; d != 0 && (d < 3 || d > 10); d = letter + a - 14) {
+        step = d < 0 || d == 2 ? 1 : -1;
+        if (letter + step < 0 || letter + step > 15) {
+            step = -step;
+        }
+        letter += step;
+    }
+    memset(p, 0, sizeof(*p));
+    p->aql = aql;
+    n = z14Samples[letter];
+    if (stages == 1 || d == 0 || n >= lot) {
+        p->type = PLAN_SINGLE;
+        p->sample[0] = n < lot ? n : lot;
+        p->accept[0] = d == 0 ? 0 : z14Single[d - 3];
+        p->reject[0] = p->accept[0] + 1;
+        return 0;
+    }
+    p->type = PLAN_DOUBLE;
+    p->sample[0] = z14Samples[letter - 1];
+    p->sample[1] = 2 * p->sample[0];
+    p->accept[0] = z14Double[d - 3][0];
+    p->reject[0] = z14Double[d - 3][1];
+    p->accept[1] = z14Double[d - 3][2];
+    p->reject[1] = p->accept[1] + 1;
+    return 0;
+}
+
+int planParse(samplingPlan* p, const char* text) {
+    /*
+    Name: planParse
+    Function: Set up a sampling plan from its command line form
+    Paramaters: samplingPlan* p - Pointer to the plan, const char* text - sprt:<p0 %>,<p1 %>[,<alpha %>,<beta %>[,<most readings>]]
+                            single:<lot size>,<AQL %> or double:<lot size>,<AQL %>
+    Variables: value, count, end, q
+    Returns 0 on success, 1 if the text isn't a valid plan
+     */
+    double value[5] = {0, 0, 100 * PLAN_SPRT_ALPHA, 100 * PLAN_SPRT_BETA, 0};
+    int count = 0;
+    const char* q = strchr(text, ':');
+    char* end;
+
+    if (q == NULL) {
+        return 1;
+    }
+    do {
+        value[count++] = strtod(q + 1, &end);
+        if (end == q + 1 || (*end != ',' && *end != '\0')) {
+            return 1;
+        }
+        q = end;
+    } while (*q == ',' && count < 5);
+    if (*q != '\0') {
+        return 1;
+    }
+    if (strncmp(text, "sprt:", 5) == 0 && (count == 2 || count >= 4) && value[4] == floor(value[4]) && value[4] < 1e9) {
+        return planSprt(p, value[0] / 100, value[1] / 100, value[2] / 100, value[3] / 100, (long) value[4]);
+    }
+    if ((strncmp(text, "single:", 7) == 0 || strncmp(text, "double:", 7) == 0) && count == 2 && value[0] == floor(value[0]) && value[0] < 1e9) {
+        return planZ14(p, text[0] == 's' ? 1 : 2, (long) value[0], value[1]);
+    }
+    return 1;
+}
+
+void planStart(planProgress* s) {
+    /*
+    Name: planStart
+    Function: Start a batch under a sampling plan
+    Paramaters: planProgress* s - Pointer to the batch's progress
+    Variables: -
+     */
+    s->readings = 0;
+    s->defects = 0;
+    s->decision = PLAN_MORE;
+}
+
+long planAdd(const samplingPlan* p, planProgress* s, const unsigned char* failMask, long n) {
+    /*
+    Name: planAdd
+    Function: Take a batch's next readings, in order, until the sampling plan has decided the batch
+    Paramaters: const samplingPlan* p - Pointer to the plan, planProgress* s - Pointer to the batch's progress
+                            const unsigned char* failMask - Readings outside tolerance, from classifyReadings(), long n - Number of readings
+    Variables: i, stage, line
+    Each reading is O(1). An SPRT decides as soon as a bound is crossed and at its reading limit takes the nearer bound. Z1.4 plans
+    are curtailed: a stage rejects as soon as its rejection number is reached and accepts as soon as its remaining readings couldn't
+    reach it, which always gives the decision the full stage would have.
+    Returns the number of readings used, the rest of the array isn't needed once s->decision is no longer PLAN_MORE
+     */
+    long i;
+    int stage;
+    double line;
+
+    for (i = 0; i < n && s->decision == PLAN_MORE; i++) {
+        s->readings++;
+        s->defects += (failMask[i >> 3] >> (i & 7)) & 1;
+        if (p->type == PLAN_SPRT) {
+            line = p->slope * s->readings;
+            if (s->defects >= line + p->rejectOffset) {
+                s->decision = PLAN_REJECT;
+            } else if (s->defects <= line - p->acceptOffset) {
+                s->decision = PLAN_ACCEPT;
+            } else if (s->readings >= p->limit) {
+                s->decision = s->defects < line + (p->rejectOffset - p->acceptOffset) / 2 ? PLAN_ACCEPT : PLAN_REJECT;
+            }
+            continue;
+        }
+        stage = p->type == PLAN_DOUBLE && s->readings > p->sample[0];
+        if (s->defects >= p->reject[stage]) {
+            s->decision = PLAN_REJECT;
+        } else if (s->defects + p->sample[stage] - s->readings <= p->accept[stage]) {
+            s->decision = PLAN_ACCEPT;
+        }
+    }
+    return i;
+}
+
+int planFinish(const samplingPlan* p, planProgress* s) {
+    /*
+    Name: planFinish
+    Function: Decide a batch that has run out of readings
+    Paramaters: const samplingPlan* p - Pointer to the plan, planProgress* s - Pointer to the batch's progress
+    Variables: line
+    An SPRT is truncated here as at its reading limit. A Z1.4 plan needs its full sample, so the batch is left undecided.
+    Returns the decision
+     */
+    double line = p->slope * s->readings;
+
+    if (s->decision == PLAN_MORE && p->type == PLAN_SPRT && s->readings > 0) {
+        s->decision = s->defects < line + (p->rejectOffset - p->acceptOffset) / 2 ? PLAN_ACCEPT : PLAN_REJECT;
+    }
+    return s->decision;
+}
+
+long evaluatePlan(data* d, const double* readings, long n, const samplingPlan* p, planProgress* s) {
+    /*
+    Name: evaluatePlan
+    Function: evaluateBatch() under a sampling plan, only the readings the plan needed are checked and go into the statistics
+    Paramaters: data* d - Pointer to a structure with the nominal value and tolerance already set, const double* readings - Readings
+                            long n - Number of readings, const samplingPlan* p - Pointer to the plan, planProgress* s - Set to the decision
+    Variables: failMask, lower, upper, used, step, sample
+    The readings are classified PLAN_CHUNK at a time, so a batch decided early isn't checked past the chunk it was decided in.
+    The batch's sample size is the number of readings needed.
+    Returns the number of readings used
+     */
+    unsigned char failMask[PLAN_CHUNK / 8];
+    double lower = minTolVal(d->nominalValue, d->tolerance), upper = maxTolVal(d->nominalValue, d->tolerance);
+    long used = 0, step;
+    stats sample;
+
+    planStart(s);
+    while (used < n && s->decision == PLAN_MORE) {
+        step = n - used < PLAN_CHUNK ? n - used : PLAN_CHUNK;
+        classifyReadings(readings + used, step, lower, upper, failMask);
+        used += planAdd(p, s, failMask, step);
+    }
+    planFinish(p, s);
+    statsInit(&sample);
+    statsAddBlock(&sample, readings, used);
+    setBatchStats(d, &sample, s->defects);
+    return used;
+}
+
+double parseReading(const char* p, const char* end, int* ok) {
+    /*
+    Name: parseReading
+    Function: Convert a decimal resistance reading to a double
+    Paramaters: const char* p, const char* end - Text of the value, int* ok - Set to 1 if the whole field was a valid number
+    Variables: powers[], mantissa, digits, exponent, expSign, text
+    Values with up to 15 significant digits and small exponents are converted exactly with one multiply or divide by a power of ten,
+    anything else falls back to strtod(). nan, inf and values too large for a double aren't valid readings
+     */
+    static const double powers[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* start = p;
+    double mantissa = 0;
+    int digits = 0, exponent = 0, expValue = 0, expSign = 1;
+    char text[64], *textEnd;
+
+    while (p < end && (*p == ' ' || *p == '+')) {
+        p++;
+    }
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            mantissa = mantissa * 10 + (*p - '0');
+            exponent--;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '-' || *p == '+')) {
+            expSign = *p == '-' ? -1 : 1;
+            p++;
+        }
+        for (; p < end && *p >= '0' && *p <= '9' && expValue < 10000; p++) {
+            expValue = expValue * 10 + (*p - '0');
+        }
+        exponent += expSign * expValue;
+    }
+    *ok = digits > 0 && p == end;
+    if (*ok && digits <= 15 && exponent >= -22 && exponent <= 22) {
+        return exponent < 0 ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+    }
+    if (end - start >= (long) sizeof(text)) {
+        *ok = 0;
+        return 0;
+    }
+    memcpy(text, start, end - start);
+    text[end - start] = '\0';
+    mantissa = strtod(text, &textEnd);
+    *ok = textEnd != text && *textEnd == '\0' && isfinite(mantissa);
+    return mantissa;
+}
+
+int supplierId(const registry* r, const char* name) {
+    /*
+    Name: supplierId
+    Function: Return the id of a supplier name in a registry, or -1 if it isn't a registered supplier
+    Paramaters: const registry* r - Pointer to the registry, or NULL for the built in suppliers, const char* name - Supplier name
+    Variables: i
+    Without a registry the built in suppliers are searched, their index in suppliers[] is their id
+     */
+    int i;
+
+    if (r != NULL) {
+        return registryFind(r, name, strlen(name));
+    }
+    for (i = 0; i < SUPPLIER_COUNT; i++) {
+        if (strcmp(name, suppliers[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* supplierName(const registry* r, int id) {
+    /*
+    Name: supplierName
+    Function: Return the name of a supplier id in a registry
+    Paramaters: const registry* r - Pointer to the registry, or NULL for the built in suppliers, int id - Supplier id
+    Variables: name
+    Returns the name, or "Unknown" if the id isn't registered
+     */
+    const char* name;
+
+    if (r == NULL) {
+        return id >= 0 && id < SUPPLIER_COUNT ? suppliers[id] : "Unknown";
+    }
+    name = registryName(r, id);
+    return name != NULL ? name : "Unknown";
+}
+
+int supplierLimit(const registry* r) {
+    /*
+    Name: supplierLimit
+    Function: Return one more than the highest supplier id in a registry, so 0 to supplierLimit() - 1 covers every id
+    Paramaters: const registry* r - Pointer to the registry, or NULL for the built in suppliers
+    Variables: -
+     */
+    return r != NULL ? (int) r->limit : SUPPLIER_COUNT;
+}
+
+void registryInit(registry* r) {
+    /*
+    Name: registryInit
+    Function: Start an empty supplier registry
+    Paramaters: registry* r - Pointer to the registry
+    Variables: -
+    Ids run from 0 to INDEX_SUPPLIERS - 1 (the supplier index and aggregate of a binary log have an entry per id) and needn't be
+    contiguous. Names are found through an open addressing hash table of REGISTRY_SLOTS slots holding id + 1, which is never more than
+    half full, so a lookup is a hash and usually one string compare.
+     */
+    memset(r, 0, sizeof(*r));
+}
+
+void registryDefaults(registry* r) {
+    /*
+    Name: registryDefaults
+    Function: Fill a registry with the built in suppliers, using their index in suppliers[] as their id
+    Paramaters: registry* r - Pointer to the registry
+    Variables: i
+     */
+    int i;
+
+    registryInit(r);
+    for (i = 0; i < SUPPLIER_COUNT; i++) {
+        registryAdd(r, i, suppliers[i], strlen(suppliers[i]));
+    }
+}
+
+unsigned int registryHash(const char* name, size_t len) {
+    /*
+    Name: registryHash
+    Function: Hash a supplier name (FNV-1a)
+    Paramaters: const char* name - Name (need not be terminated), size_t len - Length of the name
+    Variables: hash, i
+    Returns the hash
+     */
+    unsigned int hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+int registryAdd(registry* r, int id, const char* name, size_t len) {
+    /*
+    Name: registryAdd
+    Function: Register a supplier name with an id
+    Paramaters: registry* r - Pointer to the registry, int id - Supplier id, const char* name - Name (need not be terminated), size_t len - Length of the name
+    Variables: slot
+    Returns REGISTRY_OK, or the reason the supplier can't be added (see enum registryStatus)
+     */
+    unsigned int slot;
+
+    if (id < 0 || id >= INDEX_SUPPLIERS) {
+        return REGISTRY_BAD_ID;
+    }
+    if (len == 0 || len >= REGISTRY_NAME_MAX || memchr(name, ',', len) != NULL) {
+        return REGISTRY_BAD_NAME;
+    }
+    if (r->names[id][0] != '\0') {
+        return REGISTRY_DUPLICATE_ID;
+    }
+    if (registryFind(r, name, len) >= 0) {
+        return REGISTRY_DUPLICATE_NAME;
+    }
+    for (slot = registryHash(name, len) & (REGISTRY_SLOTS - 1); r->slots[slot] != 0; slot = (slot + 1) & (REGISTRY_SLOTS - 1));
+    r->slots[slot] = (unsigned short) (id + 1);
+    memcpy(r->names[id], name, len);
+    r->names[id][len] = '\0';
+    r->count++;
+    if ((unsigned int) id >= r->limit) {
+        r->limit = id + 1;
+    }
+    return REGISTRY_OK;
+}
+
+int registryFind(const registry* r, const char* name, size_t len) {
+    /*
+    Name: registryFind
+    Function: Look up the id of a supplier name
+    Paramaters: const registry* r - Pointer to the registry, const char* name - Name (need not be terminated), size_t len - Length of the name
+    Variables: slot, id
+    Returns the id, or -1 if the name isn't registered
+     */
+    unsigned int slot;
+    int id;
+
+    if (len >= REGISTRY_NAME_MAX) {
+        return -1;
+    }
+    for (slot = registryHash(name, len) & (REGISTRY_SLOTS - 1); r->slots[slot] != 0; slot = (slot + 1) & (REGISTRY_SLOTS - 1)) {
+        id = r->slots[slot] - 1;
+        if (memcmp(r->names[id], name, len) == 0 && r->names[id][len] == '\0') {
+            return id;
+        }
+    }
+    return -1;
+}
+
+const char* registryName(const registry* r, int id) {
+    /*
+    Name: registryName
+    Function: Look up the name of a supplier id
+    Paramaters: const registry* r - Pointer to the registry, int id - Supplier id
+    Variables: -
+    Returns the name, or NULL if the id isn't registered
+     */
+    return id >= 0 && id < INDEX_SUPPLIERS && r->names[id][0] != '\0' ? r->names[id] : NULL;
+}
+
+int registryLoad(registry* r, const char* fileName, long* line) {
+    /*
+    Name: registryLoad
+    Function: Fill a registry from a config file
+    Paramaters: registry* r - Pointer to the registry, const char* fileName - Config file, long* line - Set to the line of an error
+    Variables: fp, text, start, end, comma, id, status
+    Each line is id,name or just a name, which is given the id after the highest so far. Blank lines and lines starting with # are ignored,
+    and spaces around the id and name are removed. Ids are stored in binary logs, so a supplier must keep its id once it has been logged:
+    add new suppliers with new ids rather than reordering the file.
+    Returns REGISTRY_OK, -1 if the file can't be opened, or the reason a line was rejected (see enum registryStatus)
+     */
+    FILE* fp = fopen(fileName, "r");
+    char text[REGISTRY_LINE_MAX], *start, *end, *comma;
+    long id;
+    int status = REGISTRY_OK;
+
+    *line = 0;
+    if (fp == NULL) {
+        return -1;
+    }
+    registryInit(r);
+    while (status == REGISTRY_OK && fgets(text, sizeof(text), fp) != NULL) {
+        (*line)++;
+        for (start = text; isspace((unsigned char) *start); start++);
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+        comma = strchr(start, ',');
+        id = r->limit;
+        if (comma != NULL) {
+            id = strtol(start, &end, 10);
+            for (; end < comma && isspace((unsigned char) *end); end++);
+            if (end == start || end != comma) {
+                status = REGISTRY_BAD_ID;
+                break;
+            }
+            for (start = comma + 1; isspace((unsigned char) *start); start++);
+        }
+        for (end = start + strlen(start); end > start && isspace((unsigned char) end[-1]); end--);
+        status = registryAdd(r, id > INDEX_SUPPLIERS ? INDEX_SUPPLIERS : (int) id, start, end - start);
+    }
+    fclose(fp);
+    return status;
+}
+
+int isBinaryLog(const char* fileName) {
+    /*
+    Name: isBinaryLog
+    Function: Return 1 if a log name has the binary log extension
+    Paramaters: const char* fileName - Log name
+    Variables: len, extLen
+     */
+    size_t len = strlen(fileName), extLen = strlen(LOG_EXTENSION);
+    return len > extLen && strcmp(fileName + len - extLen, LOG_EXTENSION) == 0;
+}
+
+int logWriterOpen(logWriter* w, const char* fileName, const registry* suppliers) {
+    /*
+    Name: logWriterOpen
+    Function: Open a binary log for appending, creating it if needed
+    Paramaters: logWriter* w - Pointer to the writer, const char* fileName - Log name,
+        const registry* suppliers - Pointer to the registry giving the supplier ids (kept, not copied), or NULL for the built in suppliers
+    Variables: -
+    The file is a 64 byte header (magic, version, records per block, record count) followed by blocks of LOG_BLOCK_RECORDS records.
+    The header also records whether records have been appended in date order (LOG_SORTED) and the latest date appended.
+    Each block is a 64 byte block header (record count and earliest and latest date in the block) then one contiguous array per column (nominal value, tolerance, mean, failure rate,
+    standard deviation, variance, date, sample size, supplier id), so a scan of one column reads only that column's memory.
+    Values are stored in the machine's native byte order. The last, partly filled, block is held in memory and written by logWriterFlush()
+    Appends are also written to a journal beside the log (see walOpen()), any records the log lost in a crash are replayed from it here.
+    The journal is locked before the log or its supplier index and aggregate are read or written, so a writer refused because the log
+    is open in another one leaves all of them as that writer has them.
+    Returns 0 on success, 1 if the file can't be opened, isn't a binary log or is open in another writer
+     */
+    memset(w, 0, sizeof(*w));
+    w->suppliers = suppliers;
+    w->block = calloc(1, LOG_BLOCK_BYTES);
+    if (w->block == NULL) {
+        return 1;
+    }
+    if (walOpen(&w->wal, fileName) != 0) {
+        free(w->block);
+        return 1;
+    }
+    w->wal.syncRecords = WAL_SYNC_RECORDS;
+    w->wal.syncMillis = WAL_SYNC_MS;
+    w->fp = fopen(fileName, "r+b");
+    if (w->fp == NULL) {
+        w->fp = fopen(fileName, "w+b");
+        if (w->fp == NULL) {
+            walClose(&w->wal);
+            free(w->block);
+            return 1;
+        }
+        memcpy(w->header.magic, LOG_MAGIC, sizeof(w->header.magic));
+        w->header.version = LOG_VERSION;
+        w->header.blockRecords = LOG_BLOCK_RECORDS;
+        w->header.flags = LOG_SORTED;
+        if (fwrite(&w->header, sizeof(w->header), 1, w->fp) != 1 || fflush(w->fp) != 0) {
+            fclose(w->fp);
+            walClose(&w->wal);
+            free(w->block);
+            return 1;
+        }
+        /*A journal left beside a new log belonged to a deleted one, so it is emptied rather than replayed*/
+        w->wal.written = 1;
+        walReset(&w->wal);
+        return logWriterSidecars(w, fileName, 1);
+    }
+    if (fread(&w->header, sizeof(w->header), 1, w->fp) != 1 || memcmp(w->header.magic, LOG_MAGIC, sizeof(w->header.magic)) != 0
+            || w->header.version != LOG_VERSION || w->header.blockRecords != LOG_BLOCK_RECORDS) {
+        fclose(w->fp);
+        walClose(&w->wal);
+        free(w->block);
+        return 1;
+    }
+    if (w->header.records % LOG_BLOCK_RECORDS != 0) {
+        if (fseek(w->fp, LOG_HEADER_BYTES + (long) (w->header.records / LOG_BLOCK_RECORDS) * LOG_BLOCK_BYTES, SEEK_SET) != 0
+                || fread(w->block, LOG_BLOCK_BYTES, 1, w->fp) != 1) {
+            fclose(w->fp);
+            walClose(&w->wal);
+            free(w->block);
+            return 1;
+        }
+    }
+    return logWriterSidecars(w, fileName, 0);
+}
+
+int logWriterSidecars(logWriter* w, const char* fileName, int created) {
+    /*
+    Name: logWriterSidecars
+    Function: Open the supplier index and aggregate snapshot of a log being written and replay its journal, closing the writer on failure
+    Paramaters: logWriter* w - Pointer to the writer, const char* fileName - Log name, int created - 1 if the log has just been created
+    Variables: -
+    The writer already holds the journal's lock, so catching up or rebuilding the sidecars can't race another writer.
+    Returns 0 on success, 1 on failure (including replayed records that can't be written to the log)
+     */
+    if (indexOpen(&w->index, fileName, w->header.records) != 0) {
+        fclose(w->fp);
+        walClose(&w->wal);
+        free(w->block);
+        w->fp = NULL;
+        w->block = NULL;
+        return 1;
+    }
+    if (aggOpen(&w->agg, fileName, w->header.records) != 0) {
+        indexClose(&w->index);
+        fclose(w->fp);
+        walClose(&w->wal);
+        free(w->block);
+        w->fp = NULL;
+        w->block = NULL;
+        return 1;
+    }
+    w->recovered = created ? 0 : logWriterRecover(w);
+    if (w->failed) {
+        logWriterClose(w);
+        return 1;
+    }
+    return 0;
+}
+
+int logWriterAppend(logWriter* w, const data* d) {
+    /*
+    Name: logWriterAppend
+    Function: Add a batch record to the journal and to the block held by the writer
+    Paramaters: logWriter* w - Pointer to the writer, const data* d - Pointer to the record
+    Variables: row, id, date, sampleSize, supplier, failed
+    The record is packed into one row of the log's columns, which is also the journal's record format.
+    Returns 0 on success, 1 if the supplier has no id, the journal can't be written or the log can't be (see logWriterFlush())
+     */
+    unsigned char row[WAL_RECORD_BYTES];
+    unsigned int sampleSize = d->sampleSize;
+    unsigned short supplier;
+    int id = supplierId(w->suppliers, d->company), date = (int) d->day, failed;
+    PROFILE_TIMER(timer);
+
+    if (id < 0 || w->failed) {
+        return 1;
+    }
+    PROFILE_BEGIN(timer);
+    supplier = (unsigned short) id;
+    memcpy(row, &d->nominalValue, 8);
+    memcpy(row + 8, &d->tolerance, 8);
+    memcpy(row + 16, &d->meanResistance, 8);
+    memcpy(row + 24, &d->failureRate, 4);
+    memcpy(row + 28, &d->standDevResistance, 4);
+    memcpy(row + 32, &d->varianceResistance, 4);
+    memcpy(row + 36, &date, 4);
+    memcpy(row + 40, &sampleSize, 4);
+    memcpy(row + 44, &supplier, 2);
+    if (w->wal.syncRecords > 0 && walAppend(&w->wal, w->header.records, row) != 0) {
+        return 1;
+    }
+    failed = logWriterStore(w, row);
+    PROFILE_END(PROFILE_APPEND, timer, 1, w->wal.syncRecords > 0 ? WAL_FRAME_BYTES + WAL_RECORD_BYTES : WAL_RECORD_BYTES);
+    return failed;
+}
+
+int logWriterStore(logWriter* w, const unsigned char* row) {
+    /*
+    Name: logWriterStore
+    Function: Copy a packed record into the block held by the writer and add it to the supplier index and aggregate
+    Paramaters: logWriter* w - Pointer to the writer, const unsigned char* row - Record packed by logWriterAppend()
+    Variables: slot, date, sampleSize, supplier, failureRate, variance, nominal, mean, blockHeader
+    A full block is written out before a new one is started. Returns 0 on success, 1 if a full block can't be written
+     */
+    unsigned int slot = w->header.records % LOG_BLOCK_RECORDS, sampleSize;
+    unsigned short supplier;
+    int date;
+    float failureRate, variance;
+    double nominal, mean;
+    struct logBlockHeader* blockHeader = (struct logBlockHeader*) w->block;
+
+    memcpy(&nominal, row, 8);
+    memcpy(&mean, row + 16, 8);
+    memcpy(&failureRate, row + 24, 4);
+    memcpy(&variance, row + 32, 4);
+    memcpy(&date, row + 36, 4);
+    memcpy(&sampleSize, row + 40, 4);
+    memcpy(&supplier, row + 44, 2);
+    if (slot == 0 && w->header.records > 0) {
+        memset(w->block, 0, LOG_BLOCK_BYTES);
+    }
+    if (slot == 0 || date < blockHeader->minDay) {
+        blockHeader->minDay = date;
+    }
+    if (slot == 0 || date > blockHeader->maxDay) {
+        blockHeader->maxDay = date;
+    }
+    if (w->header.records > 0 && date < w->header.lastDay) {
+        w->header.flags &= ~LOG_SORTED;
+    }
+    if (w->header.records == 0 || date > w->header.lastDay) {
+        w->header.lastDay = date;
+    }
+    memcpy(w->block + LOG_COL_NOMINAL + slot * 8, row, 8);
+    memcpy(w->block + LOG_COL_TOLERANCE + slot * 8, row + 8, 8);
+    memcpy(w->block + LOG_COL_MEAN + slot * 8, row + 16, 8);
+    memcpy(w->block + LOG_COL_FAILURE + slot * 4, row + 24, 4);
+    memcpy(w->block + LOG_COL_STANDDEV + slot * 4, row + 28, 4);
+    memcpy(w->block + LOG_COL_VARIANCE + slot * 4, row + 32, 4);
+    memcpy(w->block + LOG_COL_DATE + slot * 4, row + 36, 4);
+    memcpy(w->block + LOG_COL_SAMPLESIZE + slot * 4, row + 40, 4);
+    memcpy(w->block + LOG_COL_SUPPLIER + slot * 2, row + 44, 2);
+    blockHeader->count = slot + 1;
+    indexAdd(&w->index, supplier, w->header.records);
+    aggAdd(&w->agg, supplier, failureRate, sampleSize, nominal, mean, variance);
+    w->header.records++;
+    if (slot + 1 == LOG_BLOCK_RECORDS) {
+        return logWriterFlush(w);
+    }
+    return 0;
+}
+
+int logWriterFlush(logWriter* w) {
+    /*
+    Name: logWriterFlush
+    Function: Write the block in progress and then the header, so the record count only covers records already on disk
+    Paramaters: logWriter* w - Pointer to the writer
+    Variables: failed
+    The supplier index and aggregate are written after the log, so they are never ahead of it. If they can't be written they are
+    left behind the log (or marked as ahead of it) and brought up to date or rebuilt when it is next opened, so that isn't a failure.
+    This is the journal's checkpoint: while the journal is on, the block and then the header are synced to disk before it is emptied.
+    If any write or sync fails the journal is kept (with any frames still waiting committed to it) and the writer refuses appends
+    until a later flush succeeds, so records the log is missing are replayed from the journal when it is next opened.
+    Returns 0 on success, 1 if the log can't be written
+     */
+    int failed;
+
+    if (w->header.records == 0) {
+        return 0;
+    }
+    failed = fseek(w->fp, LOG_HEADER_BYTES + (long) ((w->header.records - 1) / LOG_BLOCK_RECORDS) * LOG_BLOCK_BYTES, SEEK_SET) != 0
+            || fwrite(w->block, LOG_BLOCK_BYTES, 1, w->fp) != 1 || fflush(w->fp) != 0;
+#ifdef LOG_MMAP
+    if (!failed && w->wal.syncRecords > 0) {
+        failed = fsync(fileno(w->fp)) != 0;
+    }
+#endif
+    if (!failed) {
+        failed = fseek(w->fp, 0, SEEK_SET) != 0 || fwrite(&w->header, sizeof(w->header), 1, w->fp) != 1 || fflush(w->fp) != 0;
+    }
+#ifdef LOG_MMAP
+    if (!failed && w->wal.syncRecords > 0) {
+        failed = fsync(fileno(w->fp)) != 0;
+    }
+#endif
+    if (failed) {
+        clearerr(w->fp);
+        if (w->wal.syncRecords > 0) {
+            walCommit(&w->wal);
+        }
+        w->failed = 1;
+        return 1;
+    }
+    w->failed = 0;
+    walReset(&w->wal);
+    indexFlush(&w->index);
+    aggFlush(&w->agg);
+    return 0;
+}
+
+int logWriterClose(logWriter* w) {
+    /*
+    Name: logWriterClose
+    Function: Flush and close a binary log writer
+    Paramaters: logWriter* w - Pointer to the writer
+    Variables: failed
+    Returns 0 on success, 1 if the last records couldn't be written to the log (they stay in its journal)
+     */
+    int failed = 0;
+
+    if (w->fp != NULL) {
+        failed = logWriterFlush(w);
+        failed = fclose(w->fp) != 0 || failed;
+        w->fp = NULL;
+        indexClose(&w->index);
+        aggClose(&w->agg);
+        walClose(&w->wal);
+    }
+    free(w->block);
+    w->block = NULL;
+    return failed;
+}
+
+void logWriterSync(logWriter* w, long records, long millis) {
+    /*
+    Name: logWriterSync
+    Function: Set the group commit interval of a writer's journal
+    Paramaters: logWriter* w - Pointer to the writer, long records - Appends per sync (0 turns the journal off), long millis - Longest time an append waits for a sync
+    Variables: -
+    The journal is synced once the given number of appends are waiting or the oldest has waited the given time, whichever is first, and at
+    every checkpoint. Appends between syncs are lost in a crash, so 1 makes every append durable before logWriterAppend() returns.
+    A checkpoint that fails here is reported by the next logWriterAppend().
+    Intervals above a block are capped at a block, as a full block is a checkpoint. With the journal off nothing is synced (for bulk loads
+    that can be repeated), records since the last checkpoint are lost in a crash. Turning it back on checkpoints the records appended while off.
+     */
+    if (records > 0 && w->wal.syncRecords == 0) {
+        w->wal.syncRecords = 1;
+        logWriterFlush(w);
+    }
+    w->wal.syncRecords = records < 0 ? 0 : records > LOG_BLOCK_RECORDS ? LOG_BLOCK_RECORDS : (unsigned int) records;
+    w->wal.syncMillis = millis < 0 ? 0 : millis;
+}
+
+long logWriterRecover(logWriter* w) {
+    /*
+    Name: logWriterRecover
+    Function: Replay journal records that are missing from the log, then empty the journal
+    Paramaters: logWriter* w - Pointer to the writer
+    Variables: frame, length, crc, sequence, expected, count, i, first
+    Frames are read until the first one that is short, has the wrong length or checksum, or breaks the run of record numbers, which is a
+    torn tail from a crash (or a stale frame beyond it) and is discarded. Frames for records already in the log are skipped.
+    The journal only ever holds records of the log's last block, so replaying them checkpoints the log (emptying the journal) at most once,
+    after the last one. If the log can't be written the journal is kept and w->failed is set. Returns the number of records replayed
+     */
+    unsigned char frame[WAL_FRAME_BYTES];
+    unsigned int length, crc, sequence, expected = 0, count = 0, i;
+    int first = 1;
+
+    fseek(w->wal.fp, sizeof(struct walFileHeader), SEEK_SET);
+    while (count < LOG_BLOCK_RECORDS && fread(frame, WAL_FRAME_BYTES, 1, w->wal.fp) == 1) {
+        memcpy(&length, frame, 4);
+        memcpy(&crc, frame + 4, 4);
+        memcpy(&sequence, frame + 8, 4);
+        if (length != WAL_RECORD_BYTES || crc != walChecksum(frame + 8, 4 + WAL_RECORD_BYTES) || (!first && sequence != expected)
+                || sequence > w->header.records + count) {
+            break;
+        }
+        first = 0;
+        expected = sequence + 1;
+        if (sequence == w->header.records + count) {
+            memcpy(w->wal.buffer + (size_t) count * WAL_RECORD_BYTES, frame + 12, WAL_RECORD_BYTES);
+            count++;
+        }
+    }
+    w->wal.written = 1;
+    for (i = 0; i < count; i++) {
+        logWriterStore(w, w->wal.buffer + (size_t) i * WAL_RECORD_BYTES);
+    }
+    if (count == 0) {
+        walReset(&w->wal);
+    } else if (!w->failed) {
+        logWriterFlush(w);
+    }
+    return count;
+}
+
+unsigned int walChecksum(const unsigned char* bytes, size_t len) {
+    /*
+    Name: walChecksum
+    Function: CRC-32 of a block of bytes
+    Paramaters: const unsigned char* bytes - Bytes to check, size_t len - Number of bytes
+    Variables: crc, i
+    Returns the checksum
+     */
+    unsigned int crc = 0xFFFFFFFF;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ crcNibbleTable[crc & 15];
+        crc = (crc >> 4) ^ crcNibbleTable[crc & 15];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+double walClock() {
+    /*
+    Name: walClock
+    Function: Read a clock for timing group commits
+    Paramaters: -
+    Variables: now
+    Returns the time in milliseconds from an arbitrary start, a monotonic clock on POSIX systems and processor time elsewhere
+     */
+#ifdef LOG_MMAP
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+#else
+    return clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+int walOpen(journal* j, const char* fileName) {
+    /*
+    Name: walOpen
+    Function: Open (creating if needed) the write-ahead journal of a binary log
+    Paramaters: journal* j - Pointer to the journal, const char* fileName - Log name
+    Variables: name, header, valid
+    The journal is a 64 byte header followed by one frame per append since the log's last checkpoint. Each frame is the payload length,
+    a CRC-32 of the rest of the frame, the record number in the log and the record packed as one row of the log's columns.
+    Appends are buffered and written and synced in groups (see logWriterSync()), the journal is emptied when the log is checkpointed.
+    On POSIX systems the journal is locked for the life of the writer, so a second writer on the same log is refused.
+    Returns 0 on success, 1 if the journal can't be opened or another writer has it
+     */
+    char name[FILENAME_MAX];
+    struct walFileHeader header;
+    int valid;
+
+    memset(j, 0, sizeof(*j));
+    if (sidecarName(name, fileName, WAL_EXTENSION) != 0) {
+        return 1;
+    }
+    j->buffer = malloc((size_t) LOG_BLOCK_RECORDS * WAL_FRAME_BYTES);
+    if (j->buffer == NULL) {
+        return 1;
+    }
+    j->fp = fopen(name, "r+b");
+    if (j->fp == NULL) {
+        j->fp = fopen(name, "w+b");
+    }
+    if (j->fp == NULL) {
+        free(j->buffer);
+        return 1;
+    }
+#ifdef LOG_MMAP
+    if (flock(fileno(j->fp), LOCK_EX | LOCK_NB) != 0) {
+        fclose(j->fp);
+        free(j->buffer);
+        j->fp = NULL;
+        return 1;
+    }
+#endif
+    valid = fread(&header, sizeof(header), 1, j->fp) == 1 && memcmp(header.magic, WAL_MAGIC, sizeof(header.magic)) == 0
+            && header.version == WAL_VERSION && header.recordBytes == WAL_RECORD_BYTES;
+    if (!valid) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, WAL_MAGIC, sizeof(header.magic));
+        header.version = WAL_VERSION;
+        header.recordBytes = WAL_RECORD_BYTES;
+        fseek(j->fp, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, j->fp);
+        j->written = 1;
+        walReset(j);
+    }
+    return 0;
+}
+
+int walAppend(journal* j, unsigned int record, const unsigned char* row) {
+    /*
+    Name: walAppend
+    Function: Add a frame for one record to the journal, committing the group if it is due
+    Paramaters: journal* j - Pointer to the journal, unsigned int record - Record number in the log, const unsigned char* row - Packed record
+    Variables: frame, length, crc
+    Returns 0 on success, 1 if a commit fails
+     */
+    unsigned char* frame = j->buffer + (size_t) j->pending * WAL_FRAME_BYTES;
+    unsigned int length = WAL_RECORD_BYTES, crc;
+
+    if (j->pending == 0) {
+        j->oldest = walClock();
+    }
+    memcpy(frame, &length, 4);
+    memcpy(frame + 8, &record, 4);
+    memcpy(frame + 12, row, WAL_RECORD_BYTES);
+    crc = walChecksum(frame + 8, 4 + WAL_RECORD_BYTES);
+    memcpy(frame + 4, &crc, 4);
+    j->pending++;
+    if (j->pending >= j->syncRecords || j->pending == LOG_BLOCK_RECORDS || walClock() - j->oldest >= j->syncMillis) {
+        return walCommit(j);
+    }
+    return 0;
+}
+
+int walCommit(journal* j) {
+    /*
+    Name: walCommit
+    Function: Write the waiting frames to the journal in one call and sync it to disk
+    Paramaters: journal* j - Pointer to the journal
+    Variables: -
+    Returns 0 on success, 1 if the frames can't be written
+     */
+    if (j->pending == 0) {
+        return 0;
+    }
+    if (fwrite(j->buffer, (size_t) j->pending * WAL_FRAME_BYTES, 1, j->fp) != 1 || fflush(j->fp) != 0) {
+        return 1;
+    }
+#ifdef LOG_MMAP
+    if (fsync(fileno(j->fp)) != 0) {
+        return 1;
+    }
+#endif
+    j->written += j->pending;
+    j->pending = 0;
+    return 0;
+}
+
+void walReset(journal* j) {
+    /*
+    Name: walReset
+    Function: Empty the journal after a checkpoint, dropping any frames still waiting (the log now holds their records)
+    Paramaters: journal* j - Pointer to the journal
+    Variables: -
+    On POSIX systems the journal is truncated after its header. Elsewhere new frames overwrite the old ones, which recovery ignores
+    as their record numbers don't follow on
+     */
+    j->pending = 0;
+    if (j->fp == NULL || j->written == 0) {
+        return;
+    }
+    fflush(j->fp);
+#ifdef LOG_MMAP
+    if (ftruncate(fileno(j->fp), sizeof(struct walFileHeader)) == 0) {
+        fsync(fileno(j->fp));
+    }
+#endif
+    fseek(j->fp, sizeof(struct walFileHeader), SEEK_SET);
+    j->written = 0;
+}
+
+void walClose(journal* j) {
+    /*
+    Name: walClose
+    Function: Close a journal, releasing its lock
+    Paramaters: journal* j - Pointer to the journal
+    Variables: -
+    The writer checkpoints before closing, so nothing is left to commit
+     */
+    if (j->fp != NULL) {
+        fclose(j->fp);
+        j->fp = NULL;
+    }
+    free(j->buffer);
+    j->buffer = NULL;
+}
+
+int mapFile(const char* fileName, const char** base, long* size) {
+    /*
+    Name: mapFile
+    Function: Make the contents of a file readable in memory
+    Paramaters: const char* fileName - File name, const char** base - Set to the contents, long* size - Set to the file size
+    Variables: fd, st, fp, mapped, buffer
+    The file is memory mapped where the platform supports it, so it is read in place without copying.
+    Elsewhere the file is read into memory in one call. Release with unmapFile(). Returns 0 on success, 1 if the file can't be read
+     */
+#ifdef LOG_MMAP
+    int fd;
+    struct stat st;
+    void* mapped;
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+    mapped = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return 1;
+    }
+    madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+    *base = mapped;
+    *size = st.st_size;
+#else
+    FILE* fp;
+    char* buffer;
+
+    fp = fopen(fileName, "rb");
+    if (fp == NULL) {
+        return 1;
+    }
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buffer = *size > 0 ? malloc(*size) : NULL;
+    if (buffer == NULL || fread(buffer, *size, 1, fp) != 1) {
+        free(buffer);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    *base = buffer;
+#endif
+    return 0;
+}
+
+void unmapFile(const char* base, long size) {
+    /*
+    Name: unmapFile
+    Function: Release file contents from mapFile()
+    Paramaters: const char* base, long size - Contents and size set by mapFile()
+    Variables: -
+     */
+#ifdef LOG_MMAP
+    munmap((void*) base, size);
+#else
+    free((void*) base);
+#endif
+}
+
+int logOpen(logView* v, const char* fileName) {
+    /*
+    Name: logOpen
+    Function: Open a binary log for reading
+    Paramaters: logView* v - Pointer to the view, const char* fileName - Log name
+    Variables: header
+    The file is read through mapFile(), so on most platforms the columns are used in place without copying.
+    Returns 0 on success, 1 if the file can't be read or isn't a binary log
+     */
+    const struct logFileHeader* header;
+
+    memset(v, 0, sizeof(*v));
+    if (mapFile(fileName, &v->base, &v->size) != 0) {
+        return 1;
+    }
+    header = (const struct logFileHeader*) v->base;
+    if (v->size < LOG_HEADER_BYTES || memcmp(header->magic, LOG_MAGIC, sizeof(header->magic)) != 0 || header->version != LOG_VERSION
+            || header->blockRecords != LOG_BLOCK_RECORDS
+            || LOG_HEADER_BYTES + (double) ((header->records + LOG_BLOCK_RECORDS - 1) / LOG_BLOCK_RECORDS) * LOG_BLOCK_BYTES > v->size) {
+        logClose(v);
+        return 1;
+    }
+    v->records = header->records;
+    v->flags = header->flags;
+    return 0;
+}
+
+void logClose(logView* v) {
+    /*
+    Name: logClose
+    Function: Release a binary log view
+    Paramaters: logView* v - Pointer to the view
+    Variables: -
+     */
+    if (v->base == NULL) {
+        return;
+    }
+    unmapFile(v->base, v->size);
+    v->base = NULL;
+}
+
+void logColumns(const logView* v, long block, columns* c) {
+    /*
+    Name: logColumns
+    Function: Point a set of column pointers at one block of a binary log
+    Paramaters: const logView* v - Pointer to the view, long block - Block number, columns* c - Pointer to the columns to set
+    Variables: b
+    The pointers refer directly to the log's memory, nothing is copied. count is the number of records in the block
+     */
+    const char* b = v->base + LOG_HEADER_BYTES + block * (long) LOG_BLOCK_BYTES;
+
+    c->count = v->records - block * (long) LOG_BLOCK_RECORDS;
+    if (c->count > LOG_BLOCK_RECORDS) {
+        c->count = LOG_BLOCK_RECORDS;
+    }
+    c->minDay = ((const struct logBlockHeader*) b)->minDay;
+    c->maxDay = ((const struct logBlockHeader*) b)->maxDay;
+    c->nominalValue = (const double*) (b + LOG_COL_NOMINAL);
+    c->tolerance = (const double*) (b + LOG_COL_TOLERANCE);
+    c->meanResistance = (const double*) (b + LOG_COL_MEAN);
+    c->failureRate = (const float*) (b + LOG_COL_FAILURE);
+    c->standDevResistance = (const float*) (b + LOG_COL_STANDDEV);
+    c->varianceResistance = (const float*) (b + LOG_COL_VARIANCE);
+    c->date = (const int*) (b + LOG_COL_DATE);
+    c->sampleSize = (const unsigned int*) (b + LOG_COL_SAMPLESIZE);
+    c->supplier = (const unsigned short*) (b + LOG_COL_SUPPLIER);
+}
+
+void logRecord(const columns* c, long i, const registry* suppliers, data* d) {
+    /*
+    Name: logRecord
+    Function: Copy one record of a block into a data structure
+    Paramaters: const columns* c - Pointer to the block's columns, long i - Record within the block,
+        const registry* suppliers - Pointer to the registry naming the supplier ids (NULL for the built in suppliers), data* d - Pointer to structure
+    Variables: name
+     */
+    const char* name = supplierName(suppliers, c->supplier[i]);
+
+    strncpy(d->company, name, sizeof(d->company) - 1);
+    d->company[sizeof(d->company) - 1] = '\0';
+    d->day = c->date[i];
+    d->nominalValue = c->nominalValue[i];
+    d->tolerance = c->tolerance[i];
+    d->meanResistance = c->meanResistance[i];
+    d->failureRate = c->failureRate[i];
+    d->standDevResistance = c->standDevResistance[i];
+    d->varianceResistance = c->varianceResistance[i];
+    d->sampleSize = c->sampleSize[i];
+}
+
+int sidecarName(char* out, const char* fileName, const char* extension) {
+    /*
+    Name: sidecarName
+    Function: Build the name of a file kept beside a log (the log name followed by an extension)
+    Paramaters: char* out - Buffer of FILENAME_MAX characters, const char* fileName - Log name, const char* extension - Extension to add
+    Variables: -
+    Returns 0 on success, 1 if the name is too long
+     */
+    if (strlen(fileName) + strlen(extension) >= FILENAME_MAX) {
+        return 1;
+    }
+    strcpy(out, fileName);
+    strcat(out, extension);
+    return 0;
+}
+
+int indexOpen(supplierIndex* x, const char* fileName, unsigned int records) {
+    /*
+    Name: indexOpen
+    Function: Open (creating or repairing if needed) the supplier index of a binary log for appending
+    Paramaters: supplierIndex* x - Pointer to the index, const char* fileName - Log name, unsigned int records - Records in the log
+    Variables: name, v, c, block, i, valid
+    The index is a 64 byte header, a table holding the first chunk, last chunk and record count of each supplier id, and a chain
+    of chunks per supplier, each holding up to INDEX_CHUNK_RECORDS record numbers in log order.
+    The header records how many log records have been indexed and is written last (indexFlush()), so it is the commit point: a
+    table counting more records or chunks than the header is from an interrupted flush and the index is rebuilt, and chunk entries
+    past the header's count are dropped as chunks are read back (indexAdd()). An index that is behind the log is brought up to date
+    from the log's supplier column, one that is missing, damaged or ahead of the log is rebuilt. Returns 0 on success, 1 on failure
+     */
+    char name[FILENAME_MAX];
+    logView v;
+    columns c;
+    unsigned int block, i;
+    unsigned long counted = 0;
+    int valid = 0;
+
+    memset(x, 0, sizeof(*x));
+    if (sidecarName(name, fileName, INDEX_EXTENSION) != 0) {
+        return 1;
+    }
+    x->fp = fopen(name, "r+b");
+    if (x->fp != NULL) {
+        valid = fread(&x->header, sizeof(x->header), 1, x->fp) == 1 && memcmp(x->header.magic, INDEX_MAGIC, sizeof(x->header.magic)) == 0
+                && x->header.version == INDEX_VERSION && x->header.chunkRecords == INDEX_CHUNK_RECORDS
+                && x->header.suppliers == INDEX_SUPPLIERS && x->header.records <= records
+                && fread(x->table, sizeof(x->table), 1, x->fp) == 1;
+        for (i = 0; valid && i < INDEX_SUPPLIERS; i++) {
+            counted += x->table[i].count;
+            valid = x->table[i].first <= x->header.chunks && x->table[i].last <= x->header.chunks;
+        }
+        if (valid && counted > x->header.records) {
+            valid = 0;
+        }
+        if (!valid) {
+            fclose(x->fp);
+        }
+    }
+    if (!valid) {
+        x->fp = fopen(name, "w+b");
+        if (x->fp == NULL) {
+            return 1;
+        }
+        memset(&x->header, 0, sizeof(x->header));
+        memset(x->table, 0, sizeof(x->table));
+        memcpy(x->header.magic, INDEX_MAGIC, sizeof(x->header.magic));
+        x->header.version = INDEX_VERSION;
+        x->header.chunkRecords = INDEX_CHUNK_RECORDS;
+        x->header.suppliers = INDEX_SUPPLIERS;
+    }
+    if (x->header.records < records) {
+        if (logOpen(&v, fileName) != 0) {
+            fclose(x->fp);
+            return 1;
+        }
+        for (block = x->header.records / LOG_BLOCK_RECORDS; block * LOG_BLOCK_RECORDS < records; block++) {
+            logColumns(&v, block, &c);
+            for (i = x->header.records % LOG_BLOCK_RECORDS; i < c.count; i++) {
+                indexAdd(x, c.supplier[i], block * LOG_BLOCK_RECORDS + i);
+            }
+        }
+        logClose(&v);
+        indexFlush(x);
+    }
+    return 0;
+}
+
+void indexAdd(supplierIndex* x, unsigned int supplier, unsigned int record) {
+    /*
+    Name: indexAdd
+    Function: Add a log record number to the chain of its supplier
+    Paramaters: supplierIndex* x - Pointer to the index, unsigned int supplier - Supplier id, unsigned int record - Record number in the log
+    Variables: e, tail
+    The last chunk of each supplier touched is kept in memory until indexFlush(), a new chunk is started when it fills.
+    When the last chunk is read back, entries from record onwards (written before a crash but never committed by the header)
+    and its link to a next chunk are dropped, so bringing the index up to date doesn't add them twice. If a chunk can't be read,
+    written or allocated the index is marked failed and isn't committed again (see indexFlush()).
+     */
+    struct indexEntry* e;
+    struct indexChunk* tail;
+
+    if (supplier >= INDEX_SUPPLIERS) {
+        x->header.records++;
+        return;
+    }
+    e = &x->table[supplier];
+    tail = x->tail[supplier];
+    if (tail == NULL) {
+        tail = calloc(1, sizeof(*tail));
+        if (tail == NULL) {
+            x->failed = 1;
+            x->header.records++;
+            return;
+        }
+        x->tail[supplier] = tail;
+        if (e->last != 0) {
+            if (fseek(x->fp, LOG_HEADER_BYTES + INDEX_TABLE_BYTES + (long) (e->last - 1) * INDEX_CHUNK_BYTES, SEEK_SET) != 0
+                    || fread(tail, sizeof(*tail), 1, x->fp) != 1 || tail->count > INDEX_CHUNK_RECORDS) {
+                memset(tail, 0, sizeof(*tail));
+                x->failed = 1;
+            }
+            while (tail->count > 0 && tail->records[tail->count - 1] >= record) {
+                tail->count--;
+            }
+            tail->next = 0;
+        }
+    }
+    if (e->last == 0 || tail->count == INDEX_CHUNK_RECORDS) {
+        x->header.chunks++;
+        if (e->last != 0) {
+            /*Link the full chunk to the new one and write it out*/
+            tail->next = x->header.chunks;
+            if (fseek(x->fp, LOG_HEADER_BYTES + INDEX_TABLE_BYTES + (long) (e->last - 1) * INDEX_CHUNK_BYTES, SEEK_SET) != 0
+                    || fwrite(tail, sizeof(*tail), 1, x->fp) != 1) {
+                x->failed = 1;
+            }
+        } else {
+            e->first = x->header.chunks;
+        }
+        e->last = x->header.chunks;
+        memset(tail, 0, sizeof(*tail));
+    }
+    tail->records[tail->count++] = record;
+    e->count++;
+    x->header.records++;
+}
+
+int indexFlush(supplierIndex* x) {
+    /*
+    Name: indexFlush
+    Function: Write the cached chunks, then the supplier table and header of an index
+    Paramaters: supplierIndex* x - Pointer to the index
+    Variables: i
+    The header goes last, once everything it counts is on disk, as it commits the flush (see indexOpen()). Nothing more is written
+    once a write has failed, so the index on disk stays at its last commit and is brought up to date when the log is next opened.
+    Returns 0 on success, 1 if the index couldn't be written
+     */
+    int i;
+
+    for (i = 0; i < INDEX_SUPPLIERS && !x->failed; i++) {
+        if (x->tail[i] != NULL && x->table[i].last != 0
+                && (fseek(x->fp, LOG_HEADER_BYTES + INDEX_TABLE_BYTES + (long) (x->table[i].last - 1) * INDEX_CHUNK_BYTES, SEEK_SET) != 0
+                || fwrite(x->tail[i], sizeof(*x->tail[i]), 1, x->fp) != 1)) {
+            x->failed = 1;
+        }
+    }
+    if (!x->failed) {
+        x->failed = fseek(x->fp, LOG_HEADER_BYTES, SEEK_SET) != 0 || fwrite(x->table, sizeof(x->table), 1, x->fp) != 1 || fflush(x->fp) != 0;
+    }
+    if (!x->failed) {
+        x->failed = fseek(x->fp, 0, SEEK_SET) != 0 || fwrite(&x->header, sizeof(x->header), 1, x->fp) != 1 || fflush(x->fp) != 0;
+    }
+    if (x->failed) {
+        clearerr(x->fp);
+    }
+    return x->failed;
+}
+
+void indexClose(supplierIndex* x) {
+    /*
+    Name: indexClose
+    Function: Flush and close a supplier index
+    Paramaters: supplierIndex* x - Pointer to the index
+    Variables: i
+     */
+    int i;
+
+    if (x->fp == NULL) {
+        return;
+    }
+    indexFlush(x);
+    fclose(x->fp);
+    x->fp = NULL;
+    for (i = 0; i < INDEX_SUPPLIERS; i++) {
+        free(x->tail[i]);
+        x->tail[i] = NULL;
+    }
+}
+
+long indexLookup(const char* fileName, const logView* v, int supplier, void (*visit)(const columns*, long, void*), void* context) {
+    /*
+    Name: indexLookup
+    Function: Visit the records of one supplier in a binary log using its supplier index
+    Paramaters: const char* fileName - Log name, const logView* v - Pointer to the open log, int supplier - Supplier id
+                            void (*visit)(const columns*, long, void*) - Called for each record in log order, void* context - Passed to visit
+    Variables: name, fp, header, entry, chunk, c, i, visited
+    Only the supplier's table entry, its chunks and its records are read, so the cost grows with the number of matches, not the log size.
+    Returns the number of records visited, or -1 if there is no index covering every record of the log (the caller should scan instead)
+     */
+    char name[FILENAME_MAX];
+    FILE* fp;
+    struct indexFileHeader header;
+    struct indexEntry entry;
+    struct indexChunk chunk;
+    columns c;
+    unsigned int i, next;
+    long visited = 0, chunks = 0;
+    PROFILE_TIMER(timer);
+
+    if (supplier < 0 || supplier >= INDEX_SUPPLIERS || sidecarName(name, fileName, INDEX_EXTENSION) != 0) {
+        return -1;
+    }
+    fp = fopen(name, "rb");
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) != 0
+            || header.version != INDEX_VERSION || header.suppliers != INDEX_SUPPLIERS || header.records != v->records
+            || fseek(fp, LOG_HEADER_BYTES + supplier * 12L, SEEK_SET) != 0 || fread(&entry, sizeof(entry), 1, fp) != 1) {
+        fclose(fp);
+        return -1;
+    }
+    PROFILE_BEGIN(timer);
+    for (next = entry.first; next != 0; next = chunk.next) {
+        fseek(fp, LOG_HEADER_BYTES + INDEX_TABLE_BYTES + (long) (next - 1) * INDEX_CHUNK_BYTES, SEEK_SET);
+        if (fread(&chunk, sizeof(chunk), 1, fp) != 1) {
+            break;
+        }
+        chunks++;
+        for (i = 0; i < chunk.count && i < INDEX_CHUNK_RECORDS; i++) {
+            if (chunk.records[i] < v->records) {
+                logColumns(v, chunk.records[i] / LOG_BLOCK_RECORDS, &c);
+                visit(&c, chunk.records[i] % LOG_BLOCK_RECORDS, context);
+                visited++;
+            }
+        }
+    }
+    fclose(fp);
+    PROFILE_END(PROFILE_SCAN, timer, visited, chunks * INDEX_CHUNK_BYTES + visited * WAL_RECORD_BYTES);
+    return visited;
+}
+
+long logDateRange(const logView* v, long from, long to, int supplier, void (*visit)(const columns*, long, void*), void* context) {
+    /*
+    Name: logDateRange
+    Function: Visit the records of a binary log dated between two days (inclusive), optionally for one supplier only
+    Paramaters: const logView* v - Pointer to the open log, long from, long to - Day numbers of the range, int supplier - Supplier id or -1 for all
+                            void (*visit)(const columns*, long, void*) - Called for each record in log order, void* context - Passed to visit
+    Variables: c, blocks, low, high, mid, block, i, visited
+    Blocks whose earliest and latest dates are outside the range are skipped without reading their columns.
+    If the log was appended in date order the first block is found by binary search and the scan stops at the first block after the range
+    Returns the number of records visited
+     */
+    columns c;
+    long blocks = (v->records + LOG_BLOCK_RECORDS - 1) / LOG_BLOCK_RECORDS, low = 0, high, mid, block, i, visited = 0, scanned = 0;
+    PROFILE_TIMER(timer);
+
+    PROFILE_BEGIN(timer);
+    if (v->flags & LOG_SORTED) {
+        high = blocks;
+        while (low < high) {
+            mid = (low + high) / 2;
+            logColumns(v, mid, &c);
+            if (c.maxDay < from) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+    }
+    for (block = low; block < blocks; block++) {
+        logColumns(v, block, &c);
+        if (c.minDay > to && (v->flags & LOG_SORTED)) {
+            break;
+        }
+        if (c.maxDay < from || c.minDay > to) {
+            continue;
+        }
+        scanned += c.count;
+        for (i = 0; i < (long) c.count; i++) {
+            if (c.date[i] >= from && c.date[i] <= to && (supplier < 0 || c.supplier[i] == supplier)) {
+                visit(&c, i, context);
+                visited++;
+            }
+        }
+    }
+    PROFILE_END(PROFILE_SCAN, timer, scanned, scanned * WAL_RECORD_BYTES);
+    return visited;
+}
+
+int aggOpen(aggregate* a, const char* fileName, unsigned int records) {
+    /*
+    Name: aggOpen
+    Function: Open (creating or rebuilding if needed) the aggregate snapshot of a binary log for updating
+    Paramaters: aggregate* a - Pointer to the snapshot, const char* fileName - Log name, unsigned int records - Records in the log
+    Variables: name, v, c, block, i, valid
+    The snapshot is a 64 byte header followed by one entry per supplier id holding the batch count, the sum of the failure rates and a
+    statistics accumulator of every reading's deviation from its nominal value (as a fraction of the nominal value), merged batch by batch.
+    The header records how many log records are included. A snapshot behind the log is brought up to date from the records it is missing,
+    one that is missing, damaged or ahead of the log is rebuilt from the whole log. Returns 0 on success, 1 on failure
+     */
+    char name[FILENAME_MAX];
+    logView v;
+    columns c;
+    unsigned int block, i;
+    int valid = 0;
+
+    memset(a, 0, sizeof(*a));
+    if (sidecarName(name, fileName, AGG_EXTENSION) != 0) {
+        return 1;
+    }
+    a->fp = fopen(name, "r+b");
+    if (a->fp != NULL) {
+        valid = fread(&a->header, sizeof(a->header), 1, a->fp) == 1 && memcmp(a->header.magic, AGG_MAGIC, sizeof(a->header.magic)) == 0
+                && a->header.version == AGG_VERSION && a->header.suppliers == INDEX_SUPPLIERS && a->header.records <= records
+                && fread(a->table, sizeof(a->table), 1, a->fp) == 1;
+        if (!valid) {
+            fclose(a->fp);
+        }
+    }
+    if (!valid) {
+        a->fp = fopen(name, "w+b");
+        if (a->fp == NULL) {
+            return 1;
+        }
+        memset(&a->header, 0, sizeof(a->header));
+        memset(a->table, 0, sizeof(a->table));
+        memcpy(a->header.magic, AGG_MAGIC, sizeof(a->header.magic));
+        a->header.version = AGG_VERSION;
+        a->header.suppliers = INDEX_SUPPLIERS;
+    }
+    if (a->header.records < records || !valid) {
+        if (logOpen(&v, fileName) != 0) {
+            fclose(a->fp);
+            return 1;
+        }
+        for (block = a->header.records / LOG_BLOCK_RECORDS; block * LOG_BLOCK_RECORDS < records; block++) {
+            logColumns(&v, block, &c);
+            for (i = a->header.records % LOG_BLOCK_RECORDS; i < c.count; i++) {
+                aggAdd(a, c.supplier[i], c.failureRate[i], c.sampleSize[i], c.nominalValue[i], c.meanResistance[i], c.varianceResistance[i]);
+            }
+        }
+        logClose(&v);
+        aggFlush(a);
+    }
+    return 0;
+}
+
+void aggAdd(aggregate* a, unsigned int supplier, double failureRate, unsigned int sampleSize, double nominal, double mean, double variance) {
+    /*
+    Name: aggAdd
+    Function: Add one batch record to the totals of its supplier
+    Paramaters: aggregate* a - Pointer to the snapshot, unsigned int supplier - Supplier id, double failureRate - Failure rate of the batch
+                            unsigned int sampleSize, double nominal, double mean, double variance - Sample size, nominal value, mean and variance of the batch
+    Variables: e, total, batch
+    The batch mean and variance are scaled to deviations from the nominal value so batches of different values can be merged with statsMerge()
+     */
+    struct aggEntry* e;
+    stats total, batch;
+
+    a->header.records++;
+    if (supplier >= INDEX_SUPPLIERS) {
+        return;
+    }
+    e = &a->table[supplier];
+    e->batches++;
+    e->failureSum += failureRate;
+    if (sampleSize == 0 || nominal <= 0) {
+        return;
+    }
+    batch.count = sampleSize;
+    batch.mean = (mean - nominal) / nominal;
+    batch.m2 = variance * sampleSize / (nominal * nominal);
+    batch.min = batch.mean;
+    batch.max = batch.mean;
+    aggStats(e, &total);
+    statsMerge(&total, &batch);
+    e->readings = total.count;
+    e->mean = total.mean;
+    e->m2 = total.m2;
+    e->min = total.min;
+    e->max = total.max;
+}
+
+void aggStats(const struct aggEntry* e, stats* s) {
+    /*
+    Name: aggStats
+    Function: Load the statistics accumulator of a snapshot entry
+    Paramaters: const struct aggEntry* e - Pointer to the entry, stats* s - Pointer to the accumulator to set
+    Variables: -
+    min and max are the lowest and highest batch mean deviation, the snapshot doesn't see individual readings
+     */
+    statsInit(s);
+    if (e->readings > 0) {
+        s->count = (long) e->readings;
+        s->mean = e->mean;
+        s->m2 = e->m2;
+        s->min = e->min;
+        s->max = e->max;
+    }
+}
+
+int aggFlush(aggregate* a) {
+    /*
+    Name: aggFlush
+    Function: Write the header and supplier table of an aggregate snapshot
+    Paramaters: aggregate* a - Pointer to the snapshot
+    Variables: header, failed
+    The header on disk first counts every record there could be, which marks the snapshot as ahead of any log, then the table and
+    the real header are written. A snapshot whose table was only partly written is so rebuilt by aggOpen() rather than trusted.
+    Returns 0 on success, 1 if the snapshot couldn't be written
+     */
+    struct aggFileHeader header = a->header;
+    int failed;
+
+    header.records = UINT_MAX;
+    failed = fseek(a->fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, a->fp) != 1 || fflush(a->fp) != 0
+            || fwrite(a->table, sizeof(a->table), 1, a->fp) != 1 || fflush(a->fp) != 0;
+    if (!failed) {
+        failed = fseek(a->fp, 0, SEEK_SET) != 0 || fwrite(&a->header, sizeof(a->header), 1, a->fp) != 1 || fflush(a->fp) != 0;
+    }
+    if (failed) {
+        clearerr(a->fp);
+    }
+    return failed;
+}
+
+void aggClose(aggregate* a) {
+    /*
+    Name: aggClose
+    Function: Flush and close an aggregate snapshot
+    Paramaters: aggregate* a - Pointer to the snapshot
+    Variables: -
+     */
+    if (a->fp == NULL) {
+        return;
+    }
+    aggFlush(a);
+    fclose(a->fp);
+    a->fp = NULL;
+}
+
+void storeInit(store* st) {
+    /*
+    Name: storeInit
+    Function: Start an empty in-memory column store
+    Paramaters: store* st - Pointer to the store
+    Variables: -
+    The store holds batch records loaded from logs as one array per field rather than an array of data structures: mean (8 bytes),
+    failure rate, standard deviation and variance (4 each), day number (4), sample size (4), supplier id (2) and part id (2), 32 bytes
+    a record against 80 for a data structure. Scans over one field read only that field's memory.
+    Supplier names are kept once in a dictionary and records hold the dictionary id. Nominal value and tolerance are kept the same way,
+    as a dictionary of the distinct parts (a log holds a few hundred at most). Release with storeFree()
+     */
+    memset(st, 0, sizeof(*st));
+}
+
+void storeFree(store* st) {
+    /*
+    Name: storeFree
+    Function: Release the memory of a column store, leaving it empty
+    Paramaters: store* st - Pointer to the store
+    Variables: -
+     */
+    free(st->meanResistance);
+    free(st->failureRate);
+    free(st->standDevResistance);
+    free(st->varianceResistance);
+    free(st->day);
+    free(st->sampleSize);
+    free(st->supplier);
+    free(st->part);
+    free(st->names);
+    free(st->partNominal);
+    free(st->partTolerance);
+    free(st->partSlots);
+    storeInit(st);
+}
+
+int storeReserve(store* st, long count) {
+    /*
+    Name: storeReserve
+    Function: Make room for a number of records in every column of a store
+    Paramaters: store* st - Pointer to the store, long count - Records the store must be able to hold
+    Variables: capacity, p
+    Capacity doubles so adding records one at a time costs a constant time each. Returns 0 on success, 1 if memory runs out
+     */
+    long capacity = st->capacity > 0 ? st->capacity : STORE_INITIAL;
+    void* p;
+
+    if (count <= st->capacity) {
+        return 0;
+    }
+    while (capacity < count) {
+        capacity *= 2;
+    }
+#define STORE_GROW(column) p = realloc(st->column, capacity * sizeof(*st->column)); if (p == NULL) { return 1; } st->column = p;
+    STORE_GROW(meanResistance)
+    STORE_GROW(failureRate)
+    STORE_GROW(standDevResistance)
+    STORE_GROW(varianceResistance)
+    STORE_GROW(day)
+    STORE_GROW(sampleSize)
+    STORE_GROW(supplier)
+    STORE_GROW(part)
+#undef STORE_GROW
+    st->capacity = capacity;
+    return 0;
+}
+
+int storeSupplier(store* st, const char* name) {
+    /*
+    Name: storeSupplier
+    Function: Find the dictionary id of a supplier name, adding the name if it is new
+    Paramaters: store* st - Pointer to the store, const char* name - Supplier name (cut to STORE_NAME_MAX - 1 characters)
+    Variables: i, p
+    Records usually arrive in runs from one supplier, so the last id found is tried first.
+    Returns the id, or -1 if the dictionary is full or memory runs out
+     */
+    unsigned int i;
+    void* p;
+
+    if (st->supplierCount > 0 && strncmp(st->names[st->lastSupplier], name, STORE_NAME_MAX - 1) == 0) {
+        return (int) st->lastSupplier;
+    }
+    for (i = 0; i < st->supplierCount; i++) {
+        if (strncmp(st->names[i], name, STORE_NAME_MAX - 1) == 0) {
+            st->lastSupplier = i;
+            return (int) i;
+        }
+    }
+    if (st->supplierCount == STORE_SUPPLIERS) {
+        return -1;
+    }
+    if (st->supplierCount == st->supplierMax) {
+        p = realloc(st->names, (st->supplierMax > 0 ? st->supplierMax * 2 : 16) * sizeof(*st->names));
+        if (p == NULL) {
+            return -1;
+        }
+        st->names = p;
+        st->supplierMax = st->supplierMax > 0 ? st->supplierMax * 2 : 16;
+    }
+    strncpy(st->names[i], name, STORE_NAME_MAX - 1);
+    st->names[i][STORE_NAME_MAX - 1] = '\0';
+    st->lastSupplier = i;
+    st->supplierCount++;
+    return (int) i;
+}
+
+int storePart(store* st, double nominal, double tolerance) {
+    /*
+    Name: storePart
+    Function: Find the dictionary id of a nominal value and tolerance, adding the pair if it is new
+    Paramaters: store* st - Pointer to the store, double nominal - Nominal value, double tolerance - Tolerance
+    Variables: bits, hash, slot, id, p
+    Parts are found through an open addressing hash table of STORE_PART_SLOTS slots (never more than half full) holding id + 1,
+    keyed on the bits of both values. The last part found is tried first. Returns the id, or -1 if the dictionary is full or memory runs out
+     */
+    unsigned int bits[4], hash, slot, id;
+    void* p;
+
+    if (st->partCount > 0 && st->partNominal[st->lastPart] == nominal && st->partTolerance[st->lastPart] == tolerance) {
+        return (int) st->lastPart;
+    }
+    if (st->partSlots == NULL) {
+        st->partSlots = calloc(STORE_PART_SLOTS, sizeof(*st->partSlots));
+        if (st->partSlots == NULL) {
+            return -1;
+        }
+    }
+    memcpy(bits, &nominal, 8);
+    memcpy(bits + 2, &tolerance, 8);
+    hash = (bits[0] * 2654435761u) ^ (bits[1] * 2246822519u) ^ (bits[2] * 3266489917u) ^ (bits[3] * 668265263u);
+    for (slot = (hash ^ (hash >> 15)) & (STORE_PART_SLOTS - 1); st->partSlots[slot] != 0; slot = (slot + 1) & (STORE_PART_SLOTS - 1)) {
+        id = st->partSlots[slot] - 1u;
+        if (st->partNominal[id] == nominal && st->partTolerance[id] == tolerance) {
+            st->lastPart = id;
+            return (int) id;
+        }
+    }
+    if (st->partCount == STORE_PARTS) {
+        return -1;
+    }
+    if (st->partCount == st->partMax) {
+        id = st->partMax > 0 ? st->partMax * 2 : 64;
+        p = realloc(st->partNominal, id * sizeof(*st->partNominal));
+        if (p == NULL) {
+            return -1;
+        }
+        st->partNominal = p;
+        p = realloc(st->partTolerance, id * sizeof(*st->partTolerance));
+        if (p == NULL) {
+            return -1;
+        }
+        st->partTolerance = p;
+        st->partMax = id;
+    }
+    id = st->partCount++;
+    st->partNominal[id] = nominal;
+    st->partTolerance[id] = tolerance;
+    st->partSlots[slot] = (unsigned short) (id + 1);
+    st->lastPart = id;
+    return (int) id;
+}
+
+int storeAdd(store* st, const data* d) {
+    /*
+    Name: storeAdd
+    Function: Add a batch record to a column store
+    Paramaters: store* st - Pointer to the store, const data* d - Pointer to the record
+    Variables: supplier, part
+    Returns 0 on success, 1 if memory runs out or a dictionary is full
+     */
+    int supplier, part;
+
+    if (storeReserve(st, st->count + 1) != 0) {
+        return 1;
+    }
+    supplier = storeSupplier(st, d->company);
+    part = storePart(st, d->nominalValue, d->tolerance);
+    if (supplier < 0 || part < 0) {
+        return 1;
+    }
+    st->meanResistance[st->count] = d->meanResistance;
+    st->failureRate[st->count] = d->failureRate;
+    st->standDevResistance[st->count] = d->standDevResistance;
+    st->varianceResistance[st->count] = d->varianceResistance;
+    st->day[st->count] = (int) d->day;
+    st->sampleSize[st->count] = (unsigned int) d->sampleSize;
+    st->supplier[st->count] = (unsigned short) supplier;
+    st->part[st->count] = (unsigned short) part;
+    st->count++;
+    return 0;
+}
+
+void storeRecord(const store* st, long i, data* d) {
+    /*
+    Name: storeRecord
+    Function: Copy one record of a column store into a data structure
+    Paramaters: const store* st - Pointer to the store, long i - Record number, data* d - Pointer to structure
+    Variables: -
+     */
+    strcpy(d->company, st->names[st->supplier[i]]);
+    d->day = st->day[i];
+    d->nominalValue = st->partNominal[st->part[i]];
+    d->tolerance = st->partTolerance[st->part[i]];
+    d->meanResistance = st->meanResistance[i];
+    d->failureRate = st->failureRate[i];
+    d->standDevResistance = st->standDevResistance[i];
+    d->varianceResistance = st->varianceResistance[i];
+    d->sampleSize = st->sampleSize[i];
+}
+
+int storeLoadLog(store* st, const char* fileName, const registry* suppliers) {
+    /*
+    Name: storeLoadLog
+    Function: Add every record of a binary log to a column store
+    Paramaters: store* st - Pointer to the store, const char* fileName - Log name,
+        const registry* suppliers - Pointer to the registry naming the log's supplier ids (NULL for the built in suppliers)
+    Variables: v, c, block, i, n, ids, id, part
+    The log is already in columns, so each block's columns are copied into the store's with one memcpy() per field. Only the supplier
+    ids (the log's fixed ids become dictionary ids) and parts are looked up per record. Returns 0 on success, 1 if the log can't be read
+    or memory runs out
+     */
+    logView v;
+    columns c;
+    long block, i, n;
+    int ids[INDEX_SUPPLIERS], id, part;
+    PROFILE_TIMER(timer);
+
+    if (logOpen(&v, fileName) != 0) {
+        return 1;
+    }
+    PROFILE_BEGIN(timer);
+    for (i = 0; i < INDEX_SUPPLIERS; i++) {
+        ids[i] = -1;
+    }
+    if (storeReserve(st, st->count + (long) v.records) != 0) {
+        logClose(&v);
+        return 1;
+    }
+    for (block = 0; block * (long) LOG_BLOCK_RECORDS < (long) v.records; block++) {
+        logColumns(&v, block, &c);
+        n = st->count;
+        memcpy(st->meanResistance + n, c.meanResistance, c.count * sizeof(*st->meanResistance));
+        memcpy(st->failureRate + n, c.failureRate, c.count * sizeof(*st->failureRate));
+        memcpy(st->standDevResistance + n, c.standDevResistance, c.count * sizeof(*st->standDevResistance));
+        memcpy(st->varianceResistance + n, c.varianceResistance, c.count * sizeof(*st->varianceResistance));
+        memcpy(st->day + n, c.date, c.count * sizeof(*st->day));
+        memcpy(st->sampleSize + n, c.sampleSize, c.count * sizeof(*st->sampleSize));
+        for (i = 0; i < (long) c.count; i++) {
+            id = c.supplier[i] < INDEX_SUPPLIERS ? ids[c.supplier[i]] : storeSupplier(st, "Unknown");
+            if (id < 0 && c.supplier[i] < INDEX_SUPPLIERS) {
+                id = ids[c.supplier[i]] = storeSupplier(st, supplierName(suppliers, c.supplier[i]));
+            }
+            part = storePart(st, c.nominalValue[i], c.tolerance[i]);
+            if (id < 0 || part < 0) {
+                logClose(&v);
+                return 1;
+            }
+            st->supplier[n + i] = (unsigned short) id;
+            st->part[n + i] = (unsigned short) part;
+        }
+        st->count += c.count;
+    }
+    PROFILE_END(PROFILE_SCAN, timer, v.records, (long) v.records * WAL_RECORD_BYTES);
+    logClose(&v);
+    return 0;
+}
+
+void storeTotals(const store* st, struct aggEntry* table) {
+    /*
+    Name: storeTotals
+    Function: Batch count, failure rate sum and merged deviation from nominal of each supplier in a column store
+    Paramaters: const store* st - Pointer to the store, struct aggEntry* table - One entry per supplier dictionary id, set to the totals
+    Variables: i, r, e, n, deviation, nominal, delta
+    The totals are the same as aggAdd() keeps for a binary log, but built in two passes over the columns rather than merging batch by batch:
+    the first sums each supplier's batches, failure rates, readings and readings times mean deviation, giving each supplier's mean, the second
+    adds each batch's squared deviations about that mean (its own m2 plus readings times the squared distance of its mean), which is the
+    exact merged m2. Batches without a sample size (text logs don't record it) add to the batch count and failure rate only.
+     */
+    unsigned int i;
+    long r;
+    struct aggEntry* e;
+    double n, deviation, nominal, delta;
+
+    memset(table, 0, st->supplierCount * sizeof(*table));
+    for (r = 0; r < st->count; r++) {
+        e = &table[st->supplier[r]];
+        e->batches++;
+        e->failureSum += st->failureRate[r];
+        nominal = st->partNominal[st->part[r]];
+        if (st->sampleSize[r] == 0 || nominal <= 0) {
+            continue;
+        }
+        n = st->sampleSize[r];
+        deviation = (st->meanResistance[r] - nominal) / nominal;
+        if (e->readings == 0 || deviation < e->min) {
+            e->min = deviation;
+        }
+        if (e->readings == 0 || deviation > e->max) {
+            e->max = deviation;
+        }
+        e->readings += n;
+        e->mean += n * deviation;
+    }
+    for (i = 0; i < st->supplierCount; i++) {
+        if (table[i].readings > 0) {
+            table[i].mean /= table[i].readings;
+        }
+    }
+    for (r = 0; r < st->count; r++) {
+        nominal = st->partNominal[st->part[r]];
+        if (st->sampleSize[r] == 0 || nominal <= 0) {
+            continue;
+        }
+        e = &table[st->supplier[r]];
+        n = st->sampleSize[r];
+        delta = (st->meanResistance[r] - nominal) / nominal - e->mean;
+        e->m2 += st->varianceResistance[r] * n / (nominal * nominal) + n * delta * delta;
+    }
+}
+
+void queryInit(query* q, int keys) {
+    /*
+    Name: queryInit
+    Function: Start an empty grouped aggregation
+    Paramaters: query* q - Pointer to the query, int keys - Fields to group by (QUERY_SUPPLIER, QUERY_MONTH, QUERY_TOLERANCE and QUERY_NOMINAL
+                            combined with |, 0 puts every record in one group)
+    Variables: -
+    Release with queryFree()
+     */
+    memset(q, 0, sizeof(*q));
+    q->keys = keys;
+}
+
+void queryFree(query* q) {
+    /*
+    Name: queryFree
+    Function: Release the groups and hash table of a query
+    Paramaters: query* q - Pointer to the query
+    Variables: -
+     */
+    free(q->groups);
+    free(q->slots);
+    queryInit(q, q->keys);
+}
+
+unsigned int queryHash(const struct queryGroup* key) {
+    /*
+    Name: queryHash
+    Function: Hash the key fields of a group
+    Paramaters: const struct queryGroup* key - Group holding the key (fields not grouped by are 0)
+    Variables: bits, hash
+    Returns the hash
+     */
+    unsigned int bits[4], hash;
+
+    memcpy(bits, &key->tolerance, 8);
+    memcpy(bits + 2, &key->nominal, 8);
+    hash = ((unsigned int) key->supplier * 2654435761u) ^ ((unsigned int) key->month * 2246822519u) ^ (bits[0] * 3266489917u)
+            ^ (bits[1] * 668265263u) ^ (bits[2] * 374761393u) ^ (bits[3] * 2654435769u);
+    return hash ^ (hash >> 15);
+}
+
+long queryFind(query* q, const struct queryGroup* key) {
+    /*
+    Name: queryFind
+    Function: Find the group with a key, adding it if it is new
+    Paramaters: query* q - Pointer to the query, const struct queryGroup* key - Group holding the key
+    Variables: slot, g, i, slots, p
+    Groups are found through an open addressing hash table holding group number + 1, doubled (and refilled from the groups) when it is
+    half full. Returns the group number, or -1 if memory runs out
+     */
+    unsigned int slot, g, i, *slots;
+    void* p;
+
+    if (q->slots == NULL || (q->count + 1) * 2 > q->slotMask + 1) {
+        i = q->slots == NULL ? QUERY_INITIAL_SLOTS : (q->slotMask + 1) * 2;
+        slots = calloc(i, sizeof(*slots));
+        p = realloc(q->groups, (i / 2) * sizeof(*q->groups));
+        if (slots == NULL || p == NULL) {
+            free(slots);
+            if (p != NULL) {
+                q->groups = p;
+            }
+            return -1;
+        }
+        q->groups = p;
+        free(q->slots);
+        q->slots = slots;
+        q->slotMask = i - 1;
+        for (g = 0; g < q->count; g++) {
+            for (slot = queryHash(&q->groups[g]) & q->slotMask; q->slots[slot] != 0; slot = (slot + 1) & q->slotMask);
+            q->slots[slot] = g + 1;
+        }
+    }
+    for (slot = queryHash(key) & q->slotMask; q->slots[slot] != 0; slot = (slot + 1) & q->slotMask) {
+        g = q->slots[slot] - 1;
+        if (q->groups[g].supplier == key->supplier && q->groups[g].month == key->month && q->groups[g].tolerance == key->tolerance
+                && q->groups[g].nominal == key->nominal) {
+            return g;
+        }
+    }
+    g = q->count++;
+    memset(&q->groups[g], 0, sizeof(q->groups[g]));
+    q->groups[g].supplier = key->supplier;
+    q->groups[g].month = key->month;
+    q->groups[g].tolerance = key->tolerance;
+    q->groups[g].nominal = key->nominal;
+    q->groups[g].worst = -1;
+    q->slots[slot] = g + 1;
+    return g;
+}
+
+int queryRun(query* q, const store* st) {
+    /*
+    Name: queryRun
+    Function: Group the records of a column store and total each group: batch count, failure rate sum and worst batch, and the mean and
+              variance over batches of the batch mean's deviation from nominal (as a fraction of the nominal value)
+    Paramaters: query* q - Pointer to the query (from queryInit()), const store* st - Pointer to the store
+    Variables: groupOf, deviation, scale, delta, key, e, r, g, first, last, d, m, y, month
+    The work is split into passes over whole columns so each inner loop is short and branch light. The first pass finds each record's group,
+    trying the previous record's group first as logs hold runs of the same supplier, date and part, and keeping the day range of the last
+    month seen so months need no date conversion within it. The deviation of every record is computed in one pass from a per part
+    1 / nominal table, then the counts, sums and worst batches are accumulated and the squared distances from each group's mean are added
+    in a last pass, which gives the exact variance without the rounding of a single pass sum of squares.
+    Groups are left in the order first seen, sort them with queryCompare(). Returns 0 on success, 1 if memory runs out
+     */
+    unsigned int* groupOf;
+    double *deviation, *scale, delta;
+    struct queryGroup key, *e;
+    long r, g = -1, first = 1, last = 0;
+    int d, m, y, month = 0;
+
+    groupOf = malloc((st->count > 0 ? st->count : 1) * sizeof(*groupOf));
+    deviation = malloc((st->count > 0 ? st->count : 1) * sizeof(*deviation));
+    scale = malloc((st->partCount > 0 ? st->partCount : 1) * sizeof(*scale));
+    if (groupOf == NULL || deviation == NULL || scale == NULL) {
+        free(groupOf);
+        free(deviation);
+        free(scale);
+        return 1;
+    }
+    memset(&key, 0, sizeof(key));
+    for (r = 0; r < st->count; r++) {
+        if ((q->keys & QUERY_MONTH) && (st->day[r] < first || st->day[r] > last)) {
+            dayToDate(st->day[r], &d, &m, &y);
+            month = y * 12 + m - 1;
+            first = dayNumber(1, m, y);
+            last = (m == 12 ? dayNumber(1, 1, y + 1) : dayNumber(1, m + 1, y)) - 1;
+        }
+        if (g >= 0 && (r == 0 || st->supplier[r] != st->supplier[r - 1] || st->part[r] != st->part[r - 1]
+                || ((q->keys & QUERY_MONTH) && month != key.month))) {
+            g = -1;
+        }
+        if (g < 0) {
+            key.supplier = (q->keys & QUERY_SUPPLIER) ? st->supplier[r] : 0;
+            key.month = (q->keys & QUERY_MONTH) ? month : 0;
+            key.tolerance = (q->keys & QUERY_TOLERANCE) ? st->partTolerance[st->part[r]] : 0;
+            key.nominal = (q->keys & QUERY_NOMINAL) ? st->partNominal[st->part[r]] : 0;
+            g = queryFind(q, &key);
+            if (g < 0) {
+                free(groupOf);
+                free(deviation);
+                free(scale);
+                return 1;
+            }
+        }
+        groupOf[r] = (unsigned int) g;
+    }
+    for (r = 0; r < (long) st->partCount; r++) {
+        scale[r] = st->partNominal[r] > 0 ? 1 / st->partNominal[r] : 0;
+    }
+    for (r = 0; r < st->count; r++) {
+        deviation[r] = st->meanResistance[r] * scale[st->part[r]] - 1;
+    }
+    for (r = 0; r < st->count; r++) {
+        e = &q->groups[groupOf[r]];
+        e->batches++;
+        e->failureSum += st->failureRate[r];
+        if (e->worst < 0 || st->failureRate[r] > e->worstRate) {
+            e->worst = r;
+            e->worstRate = st->failureRate[r];
+        }
+        if (scale[st->part[r]] > 0) {
+            e->deviations++;
+            e->deviationMean += deviation[r];
+        }
+    }
+    for (g = 0; g < (long) q->count; g++) {
+        if (q->groups[g].deviations > 0) {
+            q->groups[g].deviationMean /= q->groups[g].deviations;
+        }
+    }
+    for (r = 0; r < st->count; r++) {
+        if (scale[st->part[r]] > 0) {
+            e = &q->groups[groupOf[r]];
+            delta = deviation[r] - e->deviationMean;
+            e->deviationM2 += delta * delta;
+        }
+    }
+    free(groupOf);
+    free(deviation);
+    free(scale);
+    return 0;
+}
+
+int queryCompare(const void* a, const void* b) {
+    /*
+    Name: queryCompare
+    Function: Order groups by supplier id, month, tolerance and then nominal value, for qsort()
+    Paramaters: const void* a, const void* b - Pointers to the groups
+    Variables: x, y
+    Returns a negative, zero or positive value as a sorts before, with or after b
+     */
+    const struct queryGroup *x = a, *y = b;
+
+    if (x->supplier != y->supplier) {
+        return x->supplier < y->supplier ? -1 : 1;
+    }
+    if (x->month != y->month) {
+        return x->month < y->month ? -1 : 1;
+    }
+    if (x->tolerance != y->tolerance) {
+        return x->tolerance < y->tolerance ? -1 : 1;
+    }
+    if (x->nominal != y->nominal) {
+        return x->nominal < y->nominal ? -1 : 1;
+    }
+    return 0;
+}
+
+void spcInit(spcTable* t) {
+    /*
+    Name: spcInit
+    Function: Start an empty set of control charts
+    Paramaters: spcTable* t - Pointer to the set
+    Variables: -
+    Release with spcFree()
+     */
+    memset(t, 0, sizeof(*t));
+}
+
+void spcFree(spcTable* t) {
+    /*
+    Name: spcFree
+    Function: Release the charts and hash table of a set of control charts
+    Paramaters: spcTable* t - Pointer to the set
+    Variables: -
+     */
+    free(t->charts);
+    free(t->slots);
+    spcInit(t);
+}
+
+unsigned int spcHash(int supplier, double nominal) {
+    /*
+    Name: spcHash
+    Function: Hash the key of a control chart
+    Paramaters: int supplier - Supplier id, double nominal - Nominal value
+    Variables: bits, hash
+    Returns the hash
+     */
+    unsigned int bits[2], hash;
+
+    memcpy(bits, &nominal, 8);
+    hash = ((unsigned int) supplier * 2654435761u) ^ (bits[0] * 3266489917u) ^ (bits[1] * 668265263u);
+    return hash ^ (hash >> 15);
+}
+
+long spcFind(spcTable* t, int supplier, double nominal, double tolerance) {
+    /*
+    Name: spcFind
+    Function: Find the control chart of a supplier and nominal value, adding it if it is new
+    Paramaters: spcTable* t - Pointer to the set, int supplier - Supplier id, double nominal - Nominal value
+                            double tolerance - Tolerance of the batch (kept with the chart for display)
+    Variables: slot, k, i, slots, p
+    Charts are found as queryFind() finds groups, through an open addressing hash table of chart number + 1.
+    Returns the chart number, or -1 if memory runs out
+     */
+    unsigned int slot, k, i, *slots;
+    void* p;
+
+    if (t->slots == NULL || (t->count + 1) * 2 > t->slotMask + 1) {
+        i = t->slots == NULL ? SPC_INITIAL_SLOTS : (t->slotMask + 1) * 2;
+        slots = calloc(i, sizeof(*slots));
+        p = realloc(t->charts, (i / 2) * sizeof(*t->charts));
+        if (slots == NULL || p == NULL) {
+            free(slots);
+            if (p != NULL) {
+                t->charts = p;
+            }
+            return -1;
+        }
+        t->charts = p;
+        free(t->slots);
+        t->slots = slots;
+        t->slotMask = i - 1;
+        for (k = 0; k < t->count; k++) {
+            for (slot = spcHash(t->charts[k].supplier, t->charts[k].nominal) & t->slotMask; t->slots[slot] != 0; slot = (slot + 1) & t->slotMask);
+            t->slots[slot] = k + 1;
+        }
+    }
+    for (slot = spcHash(supplier, nominal) & t->slotMask; t->slots[slot] != 0; slot = (slot + 1) & t->slotMask) {
+        k = t->slots[slot] - 1;
+        if (t->charts[k].supplier == supplier && t->charts[k].nominal == nominal) {
+            t->charts[k].tolerance = tolerance;
+            return k;
+        }
+    }
+    k = t->count++;
+    memset(&t->charts[k], 0, sizeof(t->charts[k]));
+    t->charts[k].supplier = (unsigned short) supplier;
+    t->charts[k].nominal = nominal;
+    t->charts[k].tolerance = tolerance;
+    t->slots[slot] = k + 1;
+    return k;
+}
+
+int spcAdd(spcChart* c, const double* x, long n, double lower, double upper, long* first) {
+    /*
+    Name: spcAdd
+    Function: Add readings to a control chart and report any alerts they raise
+    Paramaters: spcChart* c - Pointer to the chart, const double* x - Readings, long n - Number of readings
+                            double lower, double upper - Tolerance limits of the readings, long* first - Set to the reading of the first alert
+    Variables: i, z, delta, limit, outside, alerts
+    The first SPC_WARMUP readings inside the tolerance limits set the in-control mean and standard deviation (Welford), which are then
+    fixed. Each later reading is standardised against them, clamped to +-SPC_CLAMP so a single defect or gross error can't trip a chart,
+    and updates an EWMA (weight SPC_LAMBDA, limits +-SPC_EWMA_LIMIT of its own standard deviation) and a two sided tabular CUSUM
+    (allowance SPC_CUSUM_K, decision interval SPC_CUSUM_H, capped at twice that). An alert is raised when the EWMA leaves a limit or a
+    CUSUM passes the decision interval, and is not raised again until the process is back in control: the EWMA within half the limit,
+    the CUSUM back to 0. Each reading is O(1) and the state is one fixed size record.
+    Returns the spcAlert flags raised (0 if the process stayed in control or was already out)
+     */
+    long i;
+    double z, delta, limit = SPC_EWMA_LIMIT * sqrt(SPC_LAMBDA / (2 - SPC_LAMBDA));
+    int outside, alerts = 0;
+
+    for (i = 0; i < n; i++) {
+        if (c->scale == 0) {
+            if (x[i] >= lower && x[i] <= upper) {
+                c->warm++;
+                delta = x[i] - c->mean;
+                c->mean += delta / c->warm;
+                c->m2 += delta * (x[i] - c->mean);
+            }
+            if (c->warm >= SPC_WARMUP) {
+                /*A process with no spread at all is charted against a third of half the tolerance window*/
+                c->scale = c->m2 > 0 ? 1 / sqrt(c->m2 / (c->warm - 1)) : 6 / (upper - lower);
+            }
+            continue;
+        }
+        z = (x[i] - c->mean) * c->scale;
+        z = z > SPC_CLAMP ? SPC_CLAMP : z < -SPC_CLAMP ? -SPC_CLAMP : z;
+        c->ewma += SPC_LAMBDA * (z - c->ewma);
+        c->cusumHigh = c->cusumHigh + z - SPC_CUSUM_K > 0 ? c->cusumHigh + z - SPC_CUSUM_K : 0;
+        c->cusumLow = c->cusumLow - z - SPC_CUSUM_K > 0 ? c->cusumLow - z - SPC_CUSUM_K : 0;
+        c->cusumHigh = c->cusumHigh > 2 * SPC_CUSUM_H ? 2 * SPC_CUSUM_H : c->cusumHigh;
+        c->cusumLow = c->cusumLow > 2 * SPC_CUSUM_H ? 2 * SPC_CUSUM_H : c->cusumLow;
+        outside = (c->ewma > limit || ((c->state & SPC_EWMA_HIGH) && c->ewma > limit / 2) ? SPC_EWMA_HIGH : 0)
+                | (c->ewma < -limit || ((c->state & SPC_EWMA_LOW) && c->ewma < -limit / 2) ? SPC_EWMA_LOW : 0)
+                | (c->cusumHigh > SPC_CUSUM_H || ((c->state & SPC_CUSUM_HIGH) && c->cusumHigh > 0) ? SPC_CUSUM_HIGH : 0)
+                | (c->cusumLow > SPC_CUSUM_H || ((c->state & SPC_CUSUM_LOW) && c->cusumLow > 0) ? SPC_CUSUM_LOW : 0);
+        if ((outside & ~c->state) != 0) {
+            if (alerts == 0) {
+                *first = i;
+            }
+            alerts |= outside & ~c->state;
+            c->alerts++;
+        }
+        c->state = (unsigned char) outside;
+    }
+    c->readings += n;
+    return alerts;
+}
+
+int spcLoad(spcTable* t, const char* fileName) {
+    /*
+    Name: spcLoad
+    Function: Read the control charts saved by spcSave() into an empty set
+    Paramaters: spcTable* t - Pointer to the set (from spcInit()), const char* fileName - State file
+    Variables: fp, header, chart, i, k
+    The charts carry on from where the last run left them, so no history has to be replayed.
+    Returns 0 on success, -1 if the file doesn't exist (the set is left empty), 1 if it isn't a control chart file or memory runs out
+     */
+    FILE* fp = fopen(fileName, "rb");
+    struct spcFileHeader header;
+    spcChart chart;
+    unsigned int i;
+    long k;
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, SPC_MAGIC, sizeof(header.magic)) != 0
+            || header.version != SPC_VERSION || header.chartBytes != sizeof(spcChart)) {
+        fclose(fp);
+        return 1;
+    }
+    for (i = 0; i < header.count; i++) {
+        if (fread(&chart, sizeof(chart), 1, fp) != 1 || (k = spcFind(t, chart.supplier, chart.nominal, chart.tolerance)) < 0) {
+            fclose(fp);
+            return 1;
+        }
+        t->charts[k] = chart;
+    }
+    fclose(fp);
+    return 0;
+}
+
+int spcSave(const spcTable* t, const char* fileName) {
+    /*
+    Name: spcSave
+    Function: Write a set of control charts to its state file
+    Paramaters: const spcTable* t - Pointer to the set, const char* fileName - State file
+    Variables: name, fp, header, ok
+    The charts are written to <file>.tmp which then replaces the file, so a crash while saving leaves the previous state.
+    Returns 0 on success, 1 if the file can't be written
+     */
+    char name[FILENAME_MAX];
+    FILE* fp;
+    struct spcFileHeader header;
+    int ok;
+
+    if (strlen(fileName) + 5 > sizeof(name)) {
+        return 1;
+    }
+    sprintf(name, "%s.tmp", fileName);
+    fp = fopen(name, "wb");
+    if (fp == NULL) {
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SPC_MAGIC, sizeof(header.magic));
+    header.version = SPC_VERSION;
+    header.chartBytes = sizeof(spcChart);
+    header.count = t->count;
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1 && (t->count == 0 || fwrite(t->charts, sizeof(spcChart), t->count, fp) == t->count);
+    ok = fflush(fp) == 0 && ok;
+#ifdef LOG_MMAP
+    ok = fsync(fileno(fp)) == 0 && ok;
+#endif
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) {
+        remove(name);
+        return 1;
+    }
+#ifndef LOG_MMAP
+    remove(fileName);
+#endif
+    return rename(name, fileName) != 0;
+}
+
+void sketchInit(sketch* s) {
+    /*
+    Name: sketchInit
+    Function: Start an empty quantile sketch and histogram
+    Paramaters: sketch* s - Pointer to the sketch
+    Variables: -
+    Only the counters, level bounds and bins are cleared, the items array is written before it is read
+     */
+    s->count = 0;
+    s->min = HUGE_VAL;
+    s->max = -HUGE_VAL;
+    s->levelCount = 1;
+    s->capacity = sketchCapacity(1, 0);
+    s->seed = 1;
+    s->reserved = 0;
+    s->levels[0] = SKETCH_ITEMS;
+    s->levels[1] = SKETCH_ITEMS;
+    memset(s->bins, 0, sizeof(s->bins));
+}
+
+unsigned int sketchCapacity(unsigned int levelCount, unsigned int level) {
+    /*
+    Name: sketchCapacity
+    Function: Return the most items a level of a quantile sketch holds before it is compacted, or the total of all levels
+    Paramaters: unsigned int levelCount - Levels in the sketch, unsigned int level - Level (levelCount for the total of every level)
+    Variables: width, total, h
+    As in the KLL sketch (Karnin, Lang and Liberty) the top level holds SKETCH_K items and each level below two thirds of the one
+    above, but never fewer than SKETCH_MIN_WIDTH, so a sketch of any size holds at most about 3 * SKETCH_K + 9 * SKETCH_LEVELS items
+     */
+    double width = SKETCH_K;
+    unsigned int total = 0, h;
+
+    if (level >= levelCount) {
+        for (h = 0; h < levelCount; h++) {
+            total += sketchCapacity(levelCount, h);
+        }
+        return total;
+    }
+    for (h = level + 1; h < levelCount; h++) {
+        width = width * 2 / 3;
+    }
+    return width > SKETCH_MIN_WIDTH ? (unsigned int) ceil(width) : SKETCH_MIN_WIDTH;
+}
+
+static int sketchCompareItems(const void* a, const void* b) {
+    /*
+    Name: sketchCompareItems
+    Function: Order sketch items by value, for qsort()
+    Paramaters: const void* a, const void* b - Pointers to the items
+    Variables: x, y
+     */
+    float x = *(const float*) a, y = *(const float*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static double sketchWeightBelow(const struct sketchItem* items, const double* weight, unsigned int count, double value) {
+    /*
+    Name: sketchWeightBelow
+    Function: Return the total weight of the sorted items of sketchQuantiles() below a value
+    Paramaters: const struct sketchItem* items - Items in ascending order, const double* weight - Cumulative weight of each item
+                            unsigned int count - Number of items, double value - Value
+    Variables: low, high, mid
+     */
+    unsigned int low = 0, high = count, mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+        if (items[mid].value < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low > 0 ? weight[low - 1] : 0;
+}
+
+static int sketchCompareWeighted(const void* a, const void* b) {
+    /*
+    Name: sketchCompareWeighted
+    Function: Order the weighted items of sketchQuantiles() by value, for qsort()
+    Paramaters: const void* a, const void* b - Pointers to the items
+    Variables: x, y
+     */
+    float x = ((const struct sketchItem*) a)->value, y = ((const struct sketchItem*) b)->value;
+
+    return x < y ? -1 : x > y;
+}
+
+void sketchCompress(sketch* s) {
+    /*
+    Name: sketchCompress
+    Function: Compact the lowest full level of a quantile sketch, halving it into the level above
+    Paramaters: sketch* s - Pointer to the sketch
+    Variables: h, start, end, odd, half, gap, i, offset
+    Level h holds items[levels[h]] to items[levels[h + 1] - 1], each standing for 2^h readings, with level 0 at the front so new
+    readings are added by moving levels[0] down. The level is sorted and every other item (starting at the first or second, from
+    the sketch's own deterministic sequence) is kept with twice the weight; with an odd count the smallest item stays behind so
+    the total weight is unchanged. The survivors already sit at the front of the level above, so only the levels below are moved.
+    A full top level adds a new level. The sketch is full when it holds capacity items, and this runs until it isn't.
+     */
+    unsigned int h, start, end, odd, half, gap, i, offset;
+
+    while ((unsigned int) (SKETCH_ITEMS - s->levels[0]) >= s->capacity) {
+        for (h = 0; h + 1 < s->levelCount && (unsigned int) (s->levels[h + 1] - s->levels[h]) < sketchCapacity(s->levelCount, h); h++);
+        if (h + 1 == s->levelCount && s->levelCount < SKETCH_LEVELS) {
+            s->levels[++s->levelCount] = SKETCH_ITEMS;
+            s->capacity = sketchCapacity(s->levelCount, s->levelCount);
+        }
+        if (h + 1 == s->levelCount) {
+            /*Only reached after about 2^SKETCH_LEVELS * SKETCH_K readings*/
+            return;
+        }
+        start = s->levels[h];
+        end = s->levels[h + 1];
+        qsort(s->items + start, end - start, sizeof(*s->items), sketchCompareItems);
+        odd = (end - start) & 1;
+        half = (end - start) / 2;
+        s->seed = s->seed * 1103515245u + 12345u;
+        offset = (s->seed >> 16) & 1;
+        for (i = half; i-- > 0;) {
+            s->items[end - half + i] = s->items[start + odd + 2 * i + offset];
+        }
+        gap = end - start - odd - half;
+        memmove(s->items + s->levels[0] + gap, s->items + s->levels[0], (start + odd - s->levels[0]) * sizeof(*s->items));
+        for (i = 0; i <= h; i++) {
+            s->levels[i] += gap;
+        }
+        s->levels[h + 1] = end - half;
+    }
+}
+
+int sketchBin(double deviation) {
+    /*
+    Name: sketchBin
+    Function: Return the histogram bin of a relative deviation from nominal
+    Paramaters: double deviation - (reading - nominal) / nominal
+    Variables: size, low, high, mid
+    Bins are SKETCH_BINS_PER_DECADE to a decade of the size of the deviation, from SKETCH_BIN_FLOOR to 1 (100%), on each side of a
+    centre bin for anything smaller, with the last bin of each side taking everything bigger. The bin is found by a binary search
+    of the edges. Returns the bin, from 0 (furthest below nominal) to SKETCH_BINS - 1
+     */
+    double size = fabs(deviation);
+    int low = 0, high = SKETCH_SIDE_BINS - 1, mid;
+
+    if (!(size >= sketchEdges[0])) {
+        return SKETCH_SIDE_BINS;
+    }
+    while (low < high) {
+        mid = (low + high + 1) / 2;
+        if (sketchEdges[mid] <= size) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return deviation < 0 ? SKETCH_SIDE_BINS - 1 - low : SKETCH_SIDE_BINS + 1 + low;
+}
+
+void sketchBinRange(int bin, double* low, double* high) {
+    /*
+    Name: sketchBinRange
+    Function: Return the range of relative deviations a histogram bin holds
+    Paramaters: int bin - Bin from sketchBin(), double* low, double* high - Set to the range (HUGE_VAL for an open end)
+    Variables: j
+     */
+    int j = bin < SKETCH_SIDE_BINS ? SKETCH_SIDE_BINS - 1 - bin : bin - SKETCH_SIDE_BINS - 1;
+
+    if (bin == SKETCH_SIDE_BINS) {
+        *low = -sketchEdges[0];
+        *high = sketchEdges[0];
+        return;
+    }
+    *low = sketchEdges[j];
+    *high = j + 1 < SKETCH_SIDE_BINS ? sketchEdges[j + 1] : HUGE_VAL;
+    if (bin < SKETCH_SIDE_BINS) {
+        *low = -*high;
+        *high = -sketchEdges[j];
+    }
+}
+
+void sketchAddBlock(sketch* s, const double* x, long n, double nominal) {
+    /*
+    Name: sketchAddBlock
+    Function: Add an array of readings' deviations from nominal to a quantile sketch and histogram
+    Paramaters: sketch* s - Pointer to the sketch, const double* x - Readings, long n - Number of readings, double nominal - Nominal value
+    Variables: i, scale, deviation
+    Each reading is one item added below level 0 and one bin count, readings themselves are never kept.
+     */
+    long i;
+    double scale = nominal > 0 ? 1 / nominal : 0, deviation;
+
+    for (i = 0; i < n; i++) {
+        if ((unsigned int) (SKETCH_ITEMS - s->levels[0]) >= s->capacity) {
+            sketchCompress(s);
+        }
+        deviation = x[i] * scale - 1;
+        if (s->levels[0] > 0) {
+            s->items[--s->levels[0]] = (float) deviation;
+        }
+        s->bins[sketchBin(deviation)]++;
+        s->min = deviation < s->min ? deviation : s->min;
+        s->max = deviation > s->max ? deviation : s->max;
+    }
+    s->count += n;
+}
+
+void sketchInsert(sketch* s, unsigned int level, const float* items, unsigned int n) {
+    /*
+    Name: sketchInsert
+    Function: Add items of a given weight to a level of a quantile sketch, adding levels as needed
+    Paramaters: sketch* s - Pointer to the sketch, unsigned int level - Level (weight 2^level), const float* items - Items, unsigned int n - Number of items
+    Variables: i, end
+    The sketch is compressed first, so it has room for any level of another sketch (SKETCH_ITEMS is over twice the most a sketch holds)
+     */
+    unsigned int i, end;
+
+    if (n == 0) {
+        return;
+    }
+    while (s->levelCount <= level) {
+        s->levels[++s->levelCount] = SKETCH_ITEMS;
+        s->capacity = sketchCapacity(s->levelCount, s->levelCount);
+    }
+    sketchCompress(s);
+    end = s->levels[level + 1];
+    memmove(s->items + s->levels[0] - n, s->items + s->levels[0], (end - s->levels[0]) * sizeof(*s->items));
+    for (i = 0; i <= level; i++) {
+        s->levels[i] -= n;
+    }
+    memcpy(s->items + end - n, items, n * sizeof(*items));
+}
+
+void sketchMerge(sketch* a, const sketch* b) {
+    /*
+    Name: sketchMerge
+    Function: Combine a second quantile sketch and histogram into the first
+    Paramaters: sketch* a - Pointer to the sketch to update, const sketch* b - Pointer to the sketch to merge in
+    Variables: h, i
+    Each level of b joins the same level of a and a is then compressed, so a sketch of batches merged one by one, or of threads'
+    or runs' sketches merged, has the same error bound as one built from every reading. Histograms merge exactly. The items a
+    compaction keeps depend on what is in the sketch at the time, so the quantiles depend on how the readings were split and the
+    order the sketches are merged in (always the same for the same splits and order), not only on the readings.
+     */
+    unsigned int h;
+    int i;
+
+    for (h = b->levelCount; h-- > 0;) {
+        sketchInsert(a, h, b->items + b->levels[h], b->levels[h + 1] - b->levels[h]);
+    }
+    sketchCompress(a);
+    for (i = 0; i < SKETCH_BINS; i++) {
+        a->bins[i] += b->bins[i];
+    }
+    a->count += b->count;
+    a->min = b->min < a->min ? b->min : a->min;
+    a->max = b->max > a->max ? b->max : a->max;
+}
+
+void sketchQuantiles(const sketch* s, const double* q, int n, double* out) {
+    /*
+    Name: sketchQuantiles
+    Function: Estimate quantiles of the deviations added to a sketch
+    Paramaters: const sketch* s - Pointer to the sketch, const double* q - Quantiles (0 to 1), int n - Number of quantiles
+                            double* out - Set to the estimate of each quantile (0 for an empty sketch)
+    Variables: items, weight, count, h, i, k, b, rank, before, low, high, from, to, target
+    The histogram counts are exact, so the bin holding each quantile's rank is found from them. The sketch's retained items are
+    sorted with their cumulative weights and the quantile's place within that bin is read from the items in the bin, clamped to
+    the bin. The KLL rank error (under 1% for SKETCH_K 200) then only moves a quantile within its bin, which keeps tail quantiles
+    (p1, p99) close even where the sketch alone would be a bin or two out. A query is one sort of at most a few hundred items.
+    0 and 1 give the exact minimum and maximum.
+     */
+    struct sketchItem items[SKETCH_ITEMS];
+    double weight[SKETCH_ITEMS], rank, before, low, high, from, to, target;
+    unsigned int count = 0, h, i;
+    int k, b;
+
+    for (h = 0; h < s->levelCount; h++) {
+        for (i = s->levels[h]; i < s->levels[h + 1]; i++, count++) {
+            items[count].value = s->items[i];
+            items[count].level = h;
+        }
+    }
+    qsort(items, count, sizeof(*items), sketchCompareWeighted);
+    for (i = 0, rank = 0; i < count; i++) {
+        rank += ldexp(1, items[i].level);
+        weight[i] = rank;
+    }
+    for (k = 0; k < n; k++) {
+        if (s->count == 0 || q[k] <= 0 || q[k] >= 1) {
+            out[k] = s->count == 0 ? 0 : q[k] <= 0 ? s->min : s->max;
+            continue;
+        }
+        rank = q[k] * s->count;
+        for (b = 0, before = 0; b < SKETCH_BINS - 1 && before + s->bins[b] < rank; b++) {
+            before += s->bins[b];
+        }
+        sketchBinRange(b, &low, &high);
+        from = sketchWeightBelow(items, weight, count, low);
+        to = sketchWeightBelow(items, weight, count, high);
+        low = low > s->min ? low : s->min;
+        high = high < s->max ? high : s->max;
+        target = from + (rank - before) / (s->bins[b] > 0 ? s->bins[b] : 1) * (to - from);
+        for (i = 0; i < count && weight[i] < target; i++);
+        out[k] = to > from && i < count ? items[i].value : low + (rank - before) / (s->bins[b] > 0 ? s->bins[b] : 1) * (high - low);
+        out[k] = out[k] < low ? low : out[k] > high ? high : out[k];
+    }
+}
+
+void sketchTableInit(sketchTable* t) {
+    /*
+    Name: sketchTableInit
+    Function: Start an empty set of per supplier sketches
+    Paramaters: sketchTable* t - Pointer to the set
+    Variables: -
+    Release with sketchTableFree()
+     */
+    memset(t, 0, sizeof(*t));
+}
+
+void sketchTableFree(sketchTable* t) {
+    /*
+    Name: sketchTableFree
+    Function: Release the sketches of a set
+    Paramaters: sketchTable* t - Pointer to the set
+    Variables: i
+     */
+    unsigned int i;
+
+    for (i = 0; i < t->count; i++) {
+        free(t->sketches[t->order[i]]);
+    }
+    sketchTableInit(t);
+}
+
+sketch* sketchFind(sketchTable* t, int supplier) {
+    /*
+    Name: sketchFind
+    Function: Find the sketch of a supplier, adding it if it is new
+    Paramaters: sketchTable* t - Pointer to the set, int supplier - Supplier id
+    Variables: s
+    Sketches are indexed directly by supplier id, and the ids are kept in the order they were added for saving.
+    Returns a pointer to the sketch, or NULL if the id is out of range or memory runs out
+     */
+    sketch* s;
+
+    if (supplier < 0 || supplier >= INDEX_SUPPLIERS) {
+        return NULL;
+    }
+    if (t->sketches[supplier] == NULL) {
+        s = malloc(sizeof(*s));
+        if (s == NULL) {
+            return NULL;
+        }
+        sketchInit(s);
+        t->sketches[supplier] = s;
+        t->order[t->count++] = (unsigned short) supplier;
+    }
+    return t->sketches[supplier];
+}
+
+int sketchTableMerge(sketchTable* a, const sketchTable* b) {
+    /*
+    Name: sketchTableMerge
+    Function: Merge every supplier's sketch of a second set into the first
+    Paramaters: sketchTable* a - Pointer to the set to update, const sketchTable* b - Pointer to the set to merge in
+    Variables: i, s
+    Returns 0 on success, 1 if memory runs out
+     */
+    unsigned int i;
+    sketch* s;
+
+    for (i = 0; i < b->count; i++) {
+        s = sketchFind(a, b->order[i]);
+        if (s == NULL) {
+            return 1;
+        }
+        sketchMerge(s, b->sketches[b->order[i]]);
+    }
+    return 0;
+}
+
+int sketchLoad(sketchTable* t, const char* fileName) {
+    /*
+    Name: sketchLoad
+    Function: Merge the sketches saved by sketchSave() into a set
+    Paramaters: sketchTable* t - Pointer to the set (from sketchTableInit()), const char* fileName - Sketch file
+    Variables: fp, header, record, file, s, i, h, end, ok
+    Loading several files into one set merges them, e.g. the sketches kept for each segment of a log.
+    Returns 0 on success, -1 if the file doesn't exist, 1 if it isn't a sketch file or memory runs out
+     */
+    FILE* fp = fopen(fileName, "rb");
+    struct sketchFileHeader header;
+    struct sketchRecord record;
+    sketch file, *s;
+    unsigned int i, h, end;
+    int ok;
+
+    if (fp == NULL) {
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, SKETCH_MAGIC, sizeof(header.magic)) != 0
+            || header.version != SKETCH_VERSION || header.items != SKETCH_ITEMS || header.levels != SKETCH_LEVELS || header.bins != SKETCH_BINS) {
+        fclose(fp);
+        return 1;
+    }
+    for (i = 0; i < header.count; i++) {
+        ok = fread(&record, sizeof(record), 1, fp) == 1 && record.levelCount >= 1 && record.levelCount <= SKETCH_LEVELS
+                && record.retained < SKETCH_ITEMS / 2;
+        sketchInit(&file);
+        for (h = record.levelCount, end = SKETCH_ITEMS; ok && h-- > 0;) {
+            ok = record.sizes[h] <= end;
+            end -= record.sizes[h];
+            file.levels[h] = (unsigned short) end;
+        }
+        ok = ok && SKETCH_ITEMS - end == record.retained && fread(file.items + end, sizeof(*file.items), record.retained, fp) == record.retained
+                && fread(file.bins, sizeof(file.bins), 1, fp) == 1 && (s = sketchFind(t, (int) record.supplier)) != NULL;
+        if (!ok) {
+            fclose(fp);
+            return 1;
+        }
+        file.levels[record.levelCount] = SKETCH_ITEMS;
+        file.levelCount = record.levelCount;
+        file.capacity = sketchCapacity(file.levelCount, file.levelCount);
+        file.seed = record.seed;
+        file.count = record.count;
+        file.min = record.min;
+        file.max = record.max;
+        if (s->count == 0) {
+            *s = file;
+        } else {
+            sketchMerge(s, &file);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+int sketchSave(const sketchTable* t, const char* fileName) {
+    /*
+    Name: sketchSave
+    Function: Write a set of sketches to a file
+    Paramaters: const sketchTable* t - Pointer to the set, const char* fileName - Sketch file
+    Variables: name, fp, header, record, s, i, h, ok
+    Only the items each sketch holds are written (a few KB a supplier). The file is written to <file>.tmp which then replaces it,
+    as spcSave() does. Returns 0 on success, 1 if the file can't be written
+     */
+    char name[FILENAME_MAX];
+    FILE* fp;
+    struct sketchFileHeader header;
+    struct sketchRecord record;
+    const sketch* s;
+    unsigned int i, h;
+    int ok;
+
+    if (strlen(fileName) + 5 > sizeof(name)) {
+        return 1;
+    }
+    sprintf(name, "%s.tmp", fileName);
+    fp = fopen(name, "wb");
+    if (fp == NULL) {
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SKETCH_MAGIC, sizeof(header.magic));
+    header.version = SKETCH_VERSION;
+    header.items = SKETCH_ITEMS;
+    header.levels = SKETCH_LEVELS;
+    header.bins = SKETCH_BINS;
+    header.count = t->count;
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (i = 0; i < t->count && ok; i++) {
+        s = t->sketches[t->order[i]];
+        memset(&record, 0, sizeof(record));
+        record.supplier = t->order[i];
+        record.levelCount = s->levelCount;
+        record.retained = SKETCH_ITEMS - s->levels[0];
+        record.seed = s->seed;
+        record.count = s->count;
+        record.min = s->min;
+        record.max = s->max;
+        for (h = 0; h < s->levelCount; h++) {
+            record.sizes[h] = (unsigned short) (s->levels[h + 1] - s->levels[h]);
+        }
+        ok = fwrite(&record, sizeof(record), 1, fp) == 1 && fwrite(s->items + s->levels[0], sizeof(*s->items), record.retained, fp) == record.retained
+                && fwrite(s->bins, sizeof(s->bins), 1, fp) == 1;
+    }
+    ok = fflush(fp) == 0 && ok;
+#ifdef LOG_MMAP
+    ok = fsync(fileno(fp)) == 0 && ok;
+#endif
+    ok = fclose(fp) == 0 && ok;
+    if (!ok) {
+        remove(name);
+        return 1;
+    }
+#ifndef LOG_MMAP
+    remove(fileName);
+#endif
+    return rename(name, fileName) != 0;
+}
+
+void archiveInit(archiveBuffer* b) {
+    /*
+    Name: archiveInit
+    Function: Start an empty archive buffer
+    Paramaters: archiveBuffer* b - Pointer to the buffer
+    Variables: -
+    The buffer holds the encoded frames of one or more batches until they are written with fwrite(). Release with archiveFree()
+     */
+    memset(b, 0, sizeof(*b));
+}
+
+void archiveFree(archiveBuffer* b) {
+    /*
+    Name: archiveFree
+    Function: Release an archive buffer
+    Paramaters: archiveBuffer* b - Pointer to the buffer
+    Variables: -
+     */
+    free(b->bytes);
+    archiveInit(b);
+}
+
+int archiveReserve(archiveBuffer* b, long bytes) {
+    /*
+    Name: archiveReserve
+    Function: Make room for more bytes at the end of an archive buffer
+    Paramaters: archiveBuffer* b - Pointer to the buffer, long bytes - Bytes needed after b->used
+    Variables: capacity, grown
+    Returns 0 on success, 1 if memory runs out (and b->failed is set)
+     */
+    long capacity = b->capacity > 0 ? b->capacity : ARCHIVE_INITIAL;
+    unsigned char* grown;
+
+    if (b->used + bytes <= b->capacity) {
+        return 0;
+    }
+    while (capacity < b->used + bytes) {
+        capacity *= 2;
+    }
+    grown = realloc(b->bytes, capacity);
+    if (grown == NULL) {
+        b->failed = 1;
+        return 1;
+    }
+    b->bytes = grown;
+    b->capacity = capacity;
+    return 0;
+}
+
+void archiveBegin(archiveBuffer* b, double nominal) {
+    /*
+    Name: archiveBegin
+    Function: Start the frame of a new batch at the end of an archive buffer
+    Paramaters: archiveBuffer* b - Pointer to the buffer, double nominal - Nominal value of the batch
+    Variables: -
+    A frame begun but never finished with archiveEnd() (e.g. a batch skipped for a bad reading count) is discarded here
+     */
+    if (b->open) {
+        b->used = b->start;
+    }
+    b->start = b->used;
+    b->readings = 0;
+    b->pending = 0;
+    b->nominal = nominal;
+    b->scale = nominal > 0 ? 1 / (nominal * ARCHIVE_RESOLUTION) : 0;
+    b->open = archiveReserve(b, sizeof(struct archiveFrame)) == 0;
+    if (b->open) {
+        b->used += sizeof(struct archiveFrame);
+    }
+}
+
+void archiveAddBlock(archiveBuffer* b, const double* x, long n) {
+    /*
+    Name: archiveAddBlock
+    Function: Add an array of readings to the batch being archived
+    Paramaters: archiveBuffer* b - Pointer to the buffer, const double* x - Readings, long n - Number of readings
+    Variables: i, q
+    Each reading is quantised to a whole number of ARCHIVE_RESOLUTION steps of the nominal value, (reading - nominal) / (nominal *
+    resolution) rounded to the nearest step, so decoding gives it back within half a step (0.5 ppm). Deviations beyond
+    ARCHIVE_LIMIT steps (over 1000 times nominal) are saturated. Every ARCHIVE_BLOCK_READINGS readings are encoded as a block.
+     */
+    long i;
+    double q;
+
+    if (!b->open) {
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        q = floor((x[i] - b->nominal) * b->scale + 0.5);
+        b->block[b->pending++] = q >= ARCHIVE_LIMIT ? ARCHIVE_LIMIT : q > -ARCHIVE_LIMIT ? (int) q : -ARCHIVE_LIMIT;
+        if (b->pending == ARCHIVE_BLOCK_READINGS) {
+            if (archiveReserve(b, ARCHIVE_BLOCK_BYTES) != 0) {
+                b->used = b->start;
+                b->open = 0;
+                return;
+            }
+            b->used += archiveEncodeBlock(b->block, b->pending, b->bytes + b->used);
+            b->pending = 0;
+        }
+    }
+    b->readings += n;
+}
+
+long archiveEnd(archiveBuffer* b, const data* batch, const registry* suppliers) {
+    /*
+    Name: archiveEnd
+    Function: Finish the frame of the batch being archived
+    Paramaters: archiveBuffer* b - Pointer to the buffer, const data* batch - The batch's record (supplier, date, nominal value and tolerance),
+        const registry* suppliers - Pointer to the registry giving the supplier ids (NULL for the built in suppliers)
+    Variables: frame, supplier
+    The frame header holds the payload size, reading count and CRC-32 of the payload, then the batch's day, nominal value,
+    tolerance and supplier id. As in binary logs the supplier is stored by id, so batches of suppliers without one aren't archived.
+    Returns the offset of the frame in the buffer (it runs to b->used), or -1 if the batch isn't archived
+     */
+    struct archiveFrame frame;
+    int supplier = supplierId(suppliers, batch->company);
+
+    if (!b->open || supplier < 0 || (b->pending > 0 && archiveReserve(b, ARCHIVE_BLOCK_BYTES) != 0)) {
+        b->used = b->open ? b->start : b->used;
+        b->open = 0;
+        return -1;
+    }
+    if (b->pending > 0) {
+        b->used += archiveEncodeBlock(b->block, b->pending, b->bytes + b->used);
+        b->pending = 0;
+    }
+    memset(&frame, 0, sizeof(frame));
+    frame.bytes = (unsigned int) (b->used - b->start - sizeof(frame));
+    frame.readings = (unsigned int) b->readings;
+    frame.checksum = walChecksum(b->bytes + b->start + sizeof(frame), frame.bytes);
+    frame.day = (int) batch->day;
+    frame.nominal = b->nominal;
+    frame.tolerance = (float) batch->tolerance;
+    frame.supplier = (unsigned short) supplier;
+    memcpy(b->bytes + b->start, &frame, sizeof(frame));
+    b->open = 0;
+    return b->start;
+}
+
+static unsigned char* archivePut(unsigned char* p, unsigned int value) {
+    /*
+    Name: archivePut
+    Function: Write a varint (7 bits a byte, lowest first, the top bit set on every byte but the last)
+    Paramaters: unsigned char* p - Where to write it (up to 5 bytes), unsigned int value - Value
+    Variables: -
+    Returns the byte after the varint
+     */
+    while (value >= 128) {
+        *p++ = (unsigned char) (value | 128);
+        value >>= 7;
+    }
+    *p++ = (unsigned char) value;
+    return p;
+}
+
+static const unsigned char* archiveGet(const unsigned char* p, const unsigned char* end, unsigned int* value) {
+    /*
+    Name: archiveGet
+    Function: Read a varint written by archivePut(), checking it ends before end
+    Paramaters: const unsigned char* p - Start of the varint, const unsigned char* end - End of the bytes it may use
+                            unsigned int* value - Set to the value
+    Variables: shift
+    Returns the byte after the varint, or NULL if it runs past end or is over 5 bytes
+     */
+    int shift;
+
+    for (*value = 0, shift = 0; p < end && shift < 35; shift += 7) {
+        *value |= (unsigned int) (*p & 127) << shift;
+        if (*p++ < 128) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+long archiveEncodeBlock(const int* q, int n, unsigned char* out) {
+    /*
+    Name: archiveEncodeBlock
+    Function: Encode a block of quantised readings
+    Paramaters: const int* q - Readings in steps from nominal, int n - Number of readings (1 to ARCHIVE_BLOCK_READINGS)
+                            unsigned char* out - Where to write the block (up to ARCHIVE_BLOCK_BYTES)
+    Variables: p, low, high, width, bits, i, packed
+    A block is varints of its minimum (zigzag) and maximum - minimum, then each reading - minimum packed into the fewest bits
+    that hold maximum - minimum, lowest bits first. Readings of different resistors don't follow on from each other, so offsets
+    from the minimum need fewer bits than differences between readings. The minimum and maximum let a reader check a block against
+    limits without decoding it. Returns the size of the block
+     */
+    unsigned char* p = out;
+    int low = q[0], high = q[0], width = 0, bits = 0, i;
+    unsigned long long packed = 0;
+
+    for (i = 1; i < n; i++) {
+        low = q[i] < low ? q[i] : low;
+        high = q[i] > high ? q[i] : high;
+    }
+    while (width < 31 && (unsigned int) (high - low) >> width != 0) {
+        width++;
+    }
+    p = archivePut(p, low < 0 ? ~((unsigned int) low << 1) : (unsigned int) low << 1);
+    p = archivePut(p, (unsigned int) (high - low));
+    for (i = 0; i < n; i++) {
+        packed |= (unsigned long long) (unsigned int) (q[i] - low) << bits;
+        for (bits += width; bits >= 8; bits -= 8) {
+            *p++ = (unsigned char) packed;
+            packed >>= 8;
+        }
+    }
+    if (bits > 0) {
+        *p++ = (unsigned char) packed;
+    }
+    return (long) (p - out);
+}
+
+long archiveDecodeBlock(const unsigned char* p, const unsigned char* end, int n, double nominal, double step, double* out) {
+    /*
+    Name: archiveDecodeBlock
+    Function: Decode a block written by archiveEncodeBlock() back to readings
+    Paramaters: const unsigned char* p - Start of the block, const unsigned char* end - End of the bytes it may use
+                            int n - Number of readings in the block, double nominal - Nominal value, double step - Size of a step in Ohms
+                            double* out - Set to the n readings
+    Variables: start, q, zigzag, range, mask, u, width, i, j, low, size, offset, packed
+    Each value is read from the 5 bytes holding its bit offset, so readings don't depend on each other. The last few, whose
+    5 bytes would run past the block, are read a byte at a time. Every reading is checked against the block's maximum, which
+    catches some damage without a checksum. Returns the size of the block, or -1 if it is damaged
+     */
+    const unsigned char *start = p, *q;
+    unsigned int zigzag, range, mask, u;
+    int width = 0, i, j, low;
+    long size, offset;
+    unsigned long long packed;
+
+    if ((p = archiveGet(p, end, &zigzag)) == NULL || (p = archiveGet(p, end, &range)) == NULL || n < 1) {
+        return -1;
+    }
+    while (width < 31 && range >> width != 0) {
+        width++;
+    }
+    size = ((long) n * width + 7) / 8;
+    if (range >> width != 0 || size > end - p) {
+        return -1;
+    }
+    low = (int) (zigzag >> 1) ^ -(int) (zigzag & 1);
+    mask = (1u << width) - 1;
+    for (i = 0, offset = 0; i < n; i++, offset += width) {
+        q = p + (offset >> 3);
+        if ((offset >> 3) + 5 <= size) {
+            packed = (unsigned long long) q[0] | (unsigned long long) q[1] << 8 | (unsigned long long) q[2] << 16
+                    | (unsigned long long) q[3] << 24 | (unsigned long long) q[4] << 32;
+        } else {
+            for (j = 0, packed = 0; (offset >> 3) + j < size; j++) {
+                packed |= (unsigned long long) q[j] << (8 * j);
+            }
+        }
+        u = (unsigned int) (packed >> (offset & 7)) & mask;
+        if (u > range) {
+            return -1;
+        }
+        out[i] = nominal + step * (double) (low + (int) u);
+    }
+    return (long) (p - start) + size;
+}
+
+int archiveOpen(FILE** fp, const char* fileName) {
+    /*
+    Name: archiveOpen
+    Function: Open a raw reading archive for appending, creating it if it doesn't exist
+    Paramaters: FILE** fp - Set to the archive opened for appending (NULL on failure), const char* fileName - Archive name
+    Variables: existing, base, size, offset, next, last, frame, good, resolution, header
+    An archive is a header then one frame per batch (archiveEnd()), only ever appended to. The frames are walked by their sizes
+    and the last one's checksum is checked, so a frame torn by a crash is cut off before anything is added after it (on POSIX
+    systems, elsewhere such an archive can't be appended to). Only a missing or empty file is created, an archive that can't be
+    read into memory is left as it is.
+    Returns 0 on success, 1 if it isn't an archive of this resolution, can't be read, can't be repaired or can't be opened
+     */
+    FILE* existing;
+    const char* base;
+    long size = 0, offset, next, last;
+    struct archiveFrame frame, good;
+    struct archiveFileHeader header;
+    double resolution;
+
+    *fp = NULL;
+    existing = fopen(fileName, "rb");
+    if (existing != NULL) {
+        if (fseek(existing, 0, SEEK_END) != 0 || (size = ftell(existing)) < 0) {
+            fclose(existing);
+            return 1;
+        }
+        fclose(existing);
+    }
+    if (existing == NULL || size == 0) {
+        *fp = fopen(fileName, "wb");
+        if (*fp == NULL) {
+            return 1;
+        }
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+        header.version = ARCHIVE_VERSION;
+        header.blockReadings = ARCHIVE_BLOCK_READINGS;
+        header.resolution = ARCHIVE_RESOLUTION;
+        if (fwrite(&header, sizeof(header), 1, *fp) != 1) {
+            fclose(*fp);
+            *fp = NULL;
+            return 1;
+        }
+        return 0;
+    }
+    if (mapFile(fileName, &base, &size) != 0) {
+        return 1;
+    }
+    offset = archiveFirst(base, size, &resolution);
+    if (offset < 0 || resolution != ARCHIVE_RESOLUTION) {
+        unmapFile(base, size);
+        return 1;
+    }
+    for (last = -1; (next = archiveFrameAt(base, size, offset, &frame)) > 0; offset = next) {
+        last = offset;
+        good = frame;
+    }
+    if (last >= 0 && walChecksum((const unsigned char*) base + last + sizeof(good), good.bytes) != good.checksum) {
+        offset = last;
+    }
+    unmapFile(base, size);
+    if (offset < size) {
+#ifdef LOG_MMAP
+        if (truncate(fileName, offset) != 0) {
+            return 1;
+        }
+#else
+        return 1;
+#endif
+    }
+    *fp = fopen(fileName, "ab");
+    return *fp == NULL;
+}
+
+long archiveFirst(const char* base, long size, double* resolution) {
+    /*
+    Name: archiveFirst
+    Function: Check the header of an archive read into memory (mapFile())
+    Paramaters: const char* base - Archive contents, long size - Archive size, double* resolution - Set to the archive's step (fraction of nominal)
+    Variables: header
+    Returns the offset of the first frame, or -1 if it isn't an archive this version can read
+     */
+    struct archiveFileHeader header;
+
+    if (size < (long) sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.version != ARCHIVE_VERSION
+            || header.blockReadings != ARCHIVE_BLOCK_READINGS || !(header.resolution > 0)) {
+        return -1;
+    }
+    *resolution = header.resolution;
+    return sizeof(header);
+}
+
+long archiveFrameAt(const char* base, long size, long offset, struct archiveFrame* frame) {
+    /*
+    Name: archiveFrameAt
+    Function: Read the header of an archive frame
+    Paramaters: const char* base - Archive contents, long size - Archive size, long offset - Offset of the frame (archiveFirst() for the first)
+                            struct archiveFrame* frame - Set to the frame header, its payload follows it
+    Variables: -
+    Returns the offset of the next frame, or -1 at the end of the archive or if the frame runs past it
+     */
+    if (offset < 0 || size - offset < (long) sizeof(*frame)) {
+        return -1;
+    }
+    memcpy(frame, base + offset, sizeof(*frame));
+    if (frame->readings == 0 || frame->bytes > (unsigned long) (size - offset - sizeof(*frame))) {
+        return -1;
+    }
+    return offset + sizeof(*frame) + frame->bytes;
+}
+
+long archiveDecode(const struct archiveFrame* frame, const unsigned char* payload, double resolution, double* out) {
+    /*
+    Name: archiveDecode
+    Function: Decode the readings of an archived batch
+    Paramaters: const struct archiveFrame* frame - Frame header (archiveFrameAt()), const unsigned char* payload - Its payload
+                            double resolution - The archive's step (archiveFirst()), double* out - Set to the frame->readings readings
+    Variables: p, end, step, i, n, used
+    Returns the number of readings, or -1 if the frame is damaged
+     */
+    const unsigned char *p = payload, *end = payload + frame->bytes;
+    double step = frame->nominal * resolution;
+    long i, n, used;
+
+    for (i = 0; i < (long) frame->readings; i += n) {
+        n = (long) frame->readings - i < ARCHIVE_BLOCK_READINGS ? (long) frame->readings - i : ARCHIVE_BLOCK_READINGS;
+        used = archiveDecodeBlock(p, end, (int) n, frame->nominal, step, out + i);
+        if (used < 0) {
+            return -1;
+        }
+        p += used;
+    }
+    return p == end ? i : -1;
+}
+
+unsigned long long profileClock() {
+    /*
+    Name: profileClock
+    Function: Read the clock used by the instrumentation timers
+    Paramaters: -
+    Variables: -
+    The processor's time stamp counter on x86 (a few cycles to read), elsewhere a monotonic clock in nanoseconds.
+    Returns the time in ticks from an arbitrary start, profileNanos() converts them to nanoseconds
+     */
+#ifdef CLASSIFY_X86
+    return __rdtsc();
+#else
+    return (unsigned long long) (walClock() * 1000000.0);
+#endif
+}
+
+void profileStart() {
+    /*
+    Name: profileStart
+    Function: Record the clock readings that profileNanos() measures the tick rate from
+    Paramaters: -
+    Variables: -
+    Called once at start up, before any thread ends a timer
+     */
+    profileBaseTicks = profileClock();
+    profileBaseMillis = walClock();
+}
+
+void profileBegin(profileTimer* t) {
+    /*
+    Name: profileBegin
+    Function: Start timing a stage
+    Paramaters: profileTimer* t - Pointer to the timer
+    Variables: -
+    The calling thread's time spent in nested stages so far is kept with the start, so profileEnd() can take it out
+     */
+    t->inner = profileInner;
+    t->start = profileClock();
+}
+
+void profileEnd(int stage, profileTimer* t, long records, long bytes) {
+    /*
+    Name: profileEnd
+    Function: Stop timing a stage and add it to the calling thread's counters
+    Paramaters: int stage - profileStage of the timed work, profileTimer* t - Pointer to the timer from profileBegin()
+                            long records, long bytes - Records and bytes the stage handled
+    Variables: elapsed, slot, c
+    Time is exclusive: stages timed inside this one (e.g. decode inside parse) are counted only once, in their own stage.
+    A thread claims a row of counters on its first call and updates it without locks. Threads beyond PROFILE_THREADS share the last row,
+    so their counts may be approximate
+     */
+    unsigned long long elapsed = profileClock() - t->start;
+    int slot;
+    struct profileCounter* c;
+
+    if (profileMine == NULL) {
+#if defined(__GNUC__)
+        slot = __sync_fetch_and_add(&profileUsed, 1);
+#else
+        slot = profileUsed++;
+#endif
+        profileMine = profileSlots[slot < PROFILE_THREADS ? slot : PROFILE_THREADS - 1];
+    }
+    c = &profileMine[stage];
+    c->calls++;
+    c->records += records;
+    c->bytes += bytes;
+    c->ticks += elapsed - (profileInner - t->inner);
+    profileInner = t->inner + elapsed;
+}
+
+int profileTotals(struct profileCounter* totals) {
+    /*
+    Name: profileTotals
+    Function: Add up every thread's counters
+    Paramaters: struct profileCounter* totals - Set to the totals of each stage (PROFILE_STAGES entries)
+    Variables: threads, i, k
+    May be called while other threads are still timing, their latest updates may then be missed.
+    Returns the number of threads that have recorded a stage
+     */
+    int threads = profileUsed < PROFILE_THREADS ? profileUsed : PROFILE_THREADS, i, k;
+
+    memset(totals, 0, PROFILE_STAGES * sizeof(*totals));
+    for (i = 0; i < threads; i++) {
+        for (k = 0; k < PROFILE_STAGES; k++) {
+            totals[k].calls += profileSlots[i][k].calls;
+            totals[k].records += profileSlots[i][k].records;
+            totals[k].bytes += profileSlots[i][k].bytes;
+            totals[k].ticks += profileSlots[i][k].ticks;
+        }
+    }
+    return profileUsed;
+}
+
+double profileNanos(unsigned long long ticks) {
+    /*
+    Name: profileNanos
+    Function: Convert clock ticks from profileClock() to nanoseconds
+    Paramaters: unsigned long long ticks - Number of ticks
+    Variables: millis, elapsed
+    The tick rate is measured against walClock() since profileStart(), so it needs no calibration loop
+    Returns the time in nanoseconds
+     */
+#ifdef CLASSIFY_X86
+    double millis = walClock() - profileBaseMillis;
+    unsigned long long elapsed = profileClock() - profileBaseTicks;
+
+    return elapsed > 0 && millis > 0 ? ticks * (millis * 1000000.0 / elapsed) : 0;
+#else
+    return (double) ticks;
+#endif
+}
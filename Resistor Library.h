@@ -0,0 +1,558 @@
+/* 
+Resistor Library
+    Colour code decoding, batch calculations and binary log storage used by Resistor Acceptance, built as a separate file so other
+    programs (e.g. a test rig controller) can link it in and evaluate batches in-process. Nothing in the library reads the console,
+    prints or exits, and the only global data is constant tables and the per thread counters of the instrumentation (profileEnd(),
+    only updated in builds with -DRESISTOR_PROFILE), so functions may be called from several threads as long as each thread uses its own logWriter, logView, supplierIndex and aggregate.
+Batch entry points:
+    decodeBands() - Band codes to nominal value, tolerance and temperature coefficient
+    evaluateBatch() - Failure rate and statistics of a batch's readings
+    planParse(), planAdd() & evaluatePlan() - Sequential (SPRT) and Z1.4 style single or double sampling plans that accept or reject
+        a batch as soon as enough readings have been taken
+    logWriterOpen(), logWriterAppend() & logWriterClose() - Append batches to a binary (.rlog) log, its supplier index and aggregate
+        logWriterSync() - Group commit interval of the write-ahead journal that makes appends crash safe
+    logOpen(), logDateRange(), indexLookup() & aggOpen() - Query a binary log by date range or supplier, or read its per supplier totals
+    storeAdd(), storeLoadLog() & storeTotals() - Hold loaded logs in memory as columns for scans and per supplier totals
+    queryRun() - Grouped aggregations (by supplier, month, tolerance and/or nominal value) over a column store
+    registryLoad(), supplierId() & supplierName() - Supplier names and their stable ids (stored in binary logs), read from a config file,
+        passed to the functions that map between them (NULL for the built in suppliers)
+    spcFind() & spcAdd() - EWMA and CUSUM control charts per supplier and nominal value, updated per reading, saved with spcSave()
+    sketchAddBlock(), sketchMerge() & sketchQuantiles() - Fixed size quantile sketch and histogram of deviation from nominal,
+        mergeable between batches, threads and runs, kept per supplier with sketchFind() and saved with sketchSave()
+    archiveBegin(), archiveAddBlock() & archiveEnd() - Encode a batch's raw readings for the append only archive (archiveOpen()),
+        read back with archiveFrameAt() and archiveDecode()
+    profileTotals() - Time, records and bytes of each hot path stage, in builds with -DRESISTOR_PROFILE
+ */
+
+#ifndef RESISTOR_LIBRARY_H
+#define RESISTOR_LIBRARY_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define SUPPLIER_COUNT 4
+
+/*Supplier registry, see registryLoad()*/
+#define REGISTRY_FILE "suppliers.cfg"
+#define REGISTRY_ENV "RESISTOR_SUPPLIERS"
+#define REGISTRY_NAME_MAX 18
+#define REGISTRY_SLOTS 2048
+#define REGISTRY_LINE_MAX 256
+enum registryStatus {REGISTRY_OK, REGISTRY_BAD_ID, REGISTRY_BAD_NAME, REGISTRY_DUPLICATE_ID, REGISTRY_DUPLICATE_NAME};
+
+/*Binary log (.rlog) layout, see logWriterOpen()*/
+#define LOG_EXTENSION ".rlog"
+#define LOG_MAGIC "RESLOG\r\n"
+#define LOG_VERSION 2
+#define LOG_SORTED 1
+#define LOG_BLOCK_RECORDS 1024
+#define LOG_HEADER_BYTES 64
+#define LOG_BLOCK_BYTES (LOG_HEADER_BYTES + 46 * LOG_BLOCK_RECORDS)
+#define LOG_COL_NOMINAL (LOG_HEADER_BYTES)
+#define LOG_COL_TOLERANCE (LOG_COL_NOMINAL + 8 * LOG_BLOCK_RECORDS)
+#define LOG_COL_MEAN (LOG_COL_TOLERANCE + 8 * LOG_BLOCK_RECORDS)
+#define LOG_COL_FAILURE (LOG_COL_MEAN + 8 * LOG_BLOCK_RECORDS)
+#define LOG_COL_STANDDEV (LOG_COL_FAILURE + 4 * LOG_BLOCK_RECORDS)
+#define LOG_COL_VARIANCE (LOG_COL_STANDDEV + 4 * LOG_BLOCK_RECORDS)
+#define LOG_COL_DATE (LOG_COL_VARIANCE + 4 * LOG_BLOCK_RECORDS)
+#define LOG_COL_SAMPLESIZE (LOG_COL_DATE + 4 * LOG_BLOCK_RECORDS)
+#define LOG_COL_SUPPLIER (LOG_COL_SAMPLESIZE + 4 * LOG_BLOCK_RECORDS)
+
+/*Supplier index (.rlog.sidx) layout, see indexOpen()*/
+#define INDEX_EXTENSION ".sidx"
+#define INDEX_MAGIC "RESIDX\r\n"
+#define INDEX_VERSION 1
+#define INDEX_SUPPLIERS 1024
+#define INDEX_CHUNK_RECORDS 254
+#define INDEX_TABLE_BYTES (12 * INDEX_SUPPLIERS)
+#define INDEX_CHUNK_BYTES (8 + 4 * INDEX_CHUNK_RECORDS)
+
+/*Per supplier aggregate snapshot (.rlog.agg) layout, see aggOpen()*/
+#define AGG_EXTENSION ".agg"
+#define AGG_MAGIC "RESAGG\r\n"
+#define AGG_VERSION 1
+
+/*Write-ahead journal (.rlog.wal) layout, see walOpen()*/
+#define WAL_EXTENSION ".wal"
+#define WAL_MAGIC "RESWAL\r\n"
+#define WAL_VERSION 1
+#define WAL_RECORD_BYTES 46
+#define WAL_FRAME_BYTES (12 + WAL_RECORD_BYTES)
+#define WAL_SYNC_RECORDS 64
+#define WAL_SYNC_MS 10
+
+/*In-memory column store, see storeInit()*/
+#define STORE_NAME_MAX 18
+#define STORE_SUPPLIERS 65535
+#define STORE_PARTS 65535
+#define STORE_PART_SLOTS 131072
+#define STORE_INITIAL 4096
+
+/*Group by query keys, combined with |, see queryRun()*/
+#define QUERY_SUPPLIER 1
+#define QUERY_MONTH 2
+#define QUERY_TOLERANCE 4
+#define QUERY_NOMINAL 8
+#define QUERY_INITIAL_SLOTS 64
+
+/*Control charts (see spcAdd()) and their state file (see spcLoad())*/
+#define SPC_MAGIC "RESSPC\r\n"
+#define SPC_VERSION 1
+#define SPC_WARMUP 500
+#define SPC_LAMBDA 0.05
+#define SPC_EWMA_LIMIT 4.0
+#define SPC_CUSUM_K 0.5
+#define SPC_CUSUM_H 10.0
+#define SPC_CLAMP 3.0
+#define SPC_INITIAL_SLOTS 64
+enum spcAlert {SPC_EWMA_HIGH = 1, SPC_EWMA_LOW = 2, SPC_CUSUM_HIGH = 4, SPC_CUSUM_LOW = 8};
+
+/*Quantile sketches (see sketchCompress()), histogram bins (see sketchBin()) and their file (see sketchLoad())*/
+#define SKETCH_MAGIC "RESSKT\r\n"
+#define SKETCH_VERSION 1
+#define SKETCH_K 200
+#define SKETCH_MIN_WIDTH 8
+#define SKETCH_LEVELS 40
+#define SKETCH_ITEMS 2048
+#define SKETCH_BIN_FLOOR 1e-6
+#define SKETCH_BINS_PER_DECADE 20
+#define SKETCH_DECADES 6
+#define SKETCH_SIDE_BINS (SKETCH_BINS_PER_DECADE * SKETCH_DECADES + 1)
+#define SKETCH_BINS (2 * SKETCH_SIDE_BINS + 1)
+
+/*Raw reading archive layout, see archiveOpen() and archiveEncodeBlock()*/
+#define ARCHIVE_MAGIC "RESRAW\r\n"
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_RESOLUTION 1e-6
+#define ARCHIVE_LIMIT 1073741823
+#define ARCHIVE_BLOCK_READINGS 128
+#define ARCHIVE_BLOCK_BYTES (10 + 4 * ARCHIVE_BLOCK_READINGS)
+#define ARCHIVE_INITIAL 65536
+
+/*Sampling plans, see planAdd()*/
+#define PLAN_SPRT_ALPHA 0.05
+#define PLAN_SPRT_BETA 0.10
+#define PLAN_SPRT_TRUNCATE 3
+#define PLAN_CHUNK 256
+enum planType {PLAN_SPRT, PLAN_SINGLE, PLAN_DOUBLE};
+enum planDecision {PLAN_MORE, PLAN_ACCEPT, PLAN_REJECT};
+
+/*Hot path instrumentation, see profileEnd(). The PROFILE_ macros are empty unless built with -DRESISTOR_PROFILE,
+  PROFILE_END()'s records and bytes are then only evaluated for their value (so must have no side effects)*/
+#define PROFILE_THREADS 128
+enum profileStage {PROFILE_PARSE, PROFILE_DECODE, PROFILE_CLASSIFY, PROFILE_STATS, PROFILE_APPEND, PROFILE_SCAN, PROFILE_STAGES};
+#ifdef RESISTOR_PROFILE
+#define PROFILE_TIMER(t) profileTimer t
+#define PROFILE_BEGIN(t) profileBegin(&(t))
+#define PROFILE_END(stage, t, records, bytes) profileEnd((stage), &(t), (long) (records), (long) (bytes))
+#else
+#define PROFILE_TIMER(t)
+#define PROFILE_BEGIN(t) ((void) 0)
+#define PROFILE_END(stage, t, records, bytes) ((void) (records), (void) (bytes))
+#endif
+
+enum decodeStatus {DECODE_OK, DECODE_BAD_BANDS, DECODE_BAD_DIGIT, DECODE_BAD_MULTIPLIER, DECODE_BAD_TOLERANCE, DECODE_BAD_TEMPERATURE};
+
+extern const char* const suppliers[SUPPLIER_COUNT];
+extern const char* const decodeErrors[6];
+extern const char* const registryErrors[5];
+extern const char* const profileStages[PROFILE_STAGES];
+extern const char* const spcAlerts[4];
+extern const char* const planDecisions[3];
+
+struct shipmentInfo {
+    char company[18];
+    long day;
+    double nominalValue, tolerance, meanResistance;
+    float failureRate, standDevResistance, varianceResistance;
+    long sampleSize;
+};
+typedef struct shipmentInfo data;
+
+struct sampleStats {
+    long count;
+    double mean, m2, min, max;
+};
+typedef struct sampleStats stats;
+
+struct samplingPlan {
+    int type;
+    long sample[2], accept[2], reject[2], limit;
+    double p0, p1, alpha, beta, aql, slope, acceptOffset, rejectOffset;
+};
+typedef struct samplingPlan samplingPlan;
+
+struct planProgress {
+    long readings, defects;
+    int decision;
+};
+typedef struct planProgress planProgress;
+
+struct bandCode {
+    unsigned char bands, colour[6];
+};
+typedef struct bandCode bandCode;
+
+struct standardSeries {
+    const char* name;
+    int length, significant, tolerance;
+    const unsigned short* digits;
+    const double* table;
+};
+
+struct standardMatch {
+    double nominal;
+    bandCode code;
+    int inTolerance;
+};
+typedef struct standardMatch standardMatch;
+
+struct logFileHeader {
+    char magic[8];
+    unsigned int version, blockRecords, records, flags;
+    int lastDay;
+    unsigned int reserved[9];
+};
+
+struct logBlockHeader {
+    unsigned int count;
+    int minDay, maxDay;
+    unsigned int reserved[13];
+};
+
+struct indexFileHeader {
+    char magic[8];
+    unsigned int version, chunkRecords, suppliers, records, chunks, reserved[9];
+};
+
+struct indexEntry {
+    unsigned int first, last, count;
+};
+
+struct indexChunk {
+    unsigned int next, count, records[INDEX_CHUNK_RECORDS];
+};
+
+struct supplierIndex {
+    FILE* fp;
+    struct indexFileHeader header;
+    struct indexEntry table[INDEX_SUPPLIERS];
+    struct indexChunk* tail[INDEX_SUPPLIERS];
+    int failed;
+};
+typedef struct supplierIndex supplierIndex;
+
+struct aggFileHeader {
+    char magic[8];
+    unsigned int version, suppliers, records, reserved[11];
+};
+
+struct aggEntry {
+    unsigned int batches, reserved;
+    double failureSum, readings, mean, m2, min, max;
+};
+
+struct aggregate {
+    FILE* fp;
+    struct aggFileHeader header;
+    struct aggEntry table[INDEX_SUPPLIERS];
+};
+typedef struct aggregate aggregate;
+
+struct walFileHeader {
+    char magic[8];
+    unsigned int version, recordBytes, reserved[12];
+};
+
+struct journal {
+    FILE* fp;
+    unsigned char* buffer;
+    unsigned int pending, written, syncRecords;
+    long syncMillis;
+    double oldest;
+};
+typedef struct journal journal;
+
+struct supplierRegistry {
+    unsigned int count, limit;
+    char names[INDEX_SUPPLIERS][REGISTRY_NAME_MAX];
+    unsigned short slots[REGISTRY_SLOTS];
+};
+typedef struct supplierRegistry registry;
+
+struct logWriter {
+    FILE* fp;
+    const registry* suppliers;
+    struct logFileHeader header;
+    char* block;
+    supplierIndex index;
+    aggregate agg;
+    journal wal;
+    long recovered;
+    int failed;
+};
+typedef struct logWriter logWriter;
+
+struct logView {
+    const char* base;
+    long size;
+    unsigned int records, flags;
+};
+typedef struct logView logView;
+
+struct shipmentStore {
+    long count, capacity;
+    double* meanResistance;
+    float *failureRate, *standDevResistance, *varianceResistance;
+    int* day;
+    unsigned int* sampleSize;
+    unsigned short *supplier, *part;
+    char (*names)[STORE_NAME_MAX];
+    unsigned int supplierCount, supplierMax, lastSupplier;
+    double *partNominal, *partTolerance;
+    unsigned int partCount, partMax, lastPart;
+    unsigned short* partSlots;
+};
+typedef struct shipmentStore store;
+
+struct queryGroup {
+    int supplier, month;
+    double tolerance, nominal;
+    long batches, deviations, worst;
+    double failureSum, worstRate, deviationMean, deviationM2;
+};
+
+struct queryResult {
+    int keys;
+    struct queryGroup* groups;
+    unsigned int count, slotMask;
+    unsigned int* slots;
+};
+typedef struct queryResult query;
+
+struct spcFileHeader {
+    char magic[8];
+    unsigned int version, chartBytes, count, reserved[5];
+};
+
+struct controlChart {
+    double nominal, tolerance;
+    double mean, m2, scale;
+    double ewma, cusumHigh, cusumLow;
+    double readings;
+    unsigned int warm, alerts;
+    unsigned short supplier;
+    unsigned char state, reserved;
+};
+typedef struct controlChart spcChart;
+
+struct controlChartTable {
+    spcChart* charts;
+    unsigned int count, slotMask;
+    unsigned int* slots;
+};
+typedef struct controlChartTable spcTable;
+
+struct quantileSketch {
+    double count, min, max;
+    unsigned int levelCount, capacity, seed, reserved;
+    unsigned short levels[SKETCH_LEVELS + 1];
+    float items[SKETCH_ITEMS];
+    double bins[SKETCH_BINS];
+};
+typedef struct quantileSketch sketch;
+
+struct sketchTable {
+    unsigned int count;
+    unsigned short order[INDEX_SUPPLIERS];
+    sketch* sketches[INDEX_SUPPLIERS];
+};
+typedef struct sketchTable sketchTable;
+
+struct sketchFileHeader {
+    char magic[8];
+    unsigned int version, items, levels, bins, count, reserved[3];
+};
+
+struct sketchRecord {
+    unsigned int supplier, levelCount, retained, seed;
+    double count, min, max;
+    unsigned short sizes[SKETCH_LEVELS];
+};
+
+struct archiveFileHeader {
+    char magic[8];
+    unsigned int version, blockReadings;
+    double resolution;
+    unsigned int reserved[10];
+};
+
+struct archiveFrame {
+    unsigned int bytes, readings, checksum;
+    int day;
+    double nominal;
+    float tolerance;
+    unsigned short supplier, reserved;
+};
+
+struct archiveBuffer {
+    unsigned char* bytes;
+    long used, capacity, start, readings;
+    double nominal, scale;
+    int open, failed, pending;
+    int block[ARCHIVE_BLOCK_READINGS];
+};
+typedef struct archiveBuffer archiveBuffer;
+
+struct profileCounter {
+    unsigned long long calls, records, bytes, ticks;
+};
+
+struct profileTimer {
+    unsigned long long start, inner;
+};
+typedef struct profileTimer profileTimer;
+
+struct logBlockColumns {
+    unsigned int count;
+    int minDay, maxDay;
+    const double *nominalValue, *tolerance, *meanResistance;
+    const float *failureRate, *standDevResistance, *varianceResistance;
+    const int* date;
+    const unsigned int* sampleSize;
+    const unsigned short* supplier;
+};
+typedef struct logBlockColumns columns;
+
+int parseDate(const char*, size_t, long*);
+long dayNumber(int, int, int);
+void dayToDate(long, int*, int*, int*);
+char* formatDate(long, char*);
+double idealVal(int, int, int, int, int);
+double multVal(int);
+double tolVal(int);
+int tempVal(int);
+int parseBandCode(const char*, size_t, bandCode*);
+long decodeBands(const bandCode*, long, double*, double*, int*, unsigned char*);
+const struct standardSeries* findSeries(const char*);
+long matchStandard(const double*, long, const struct standardSeries*, int, standardMatch*);
+void statsInit(stats*);
+void statsAdd(stats*, double);
+void statsAddBlock(stats*, const double*, long);
+void statsMerge(stats*, const stats*);
+double statsVariance(const stats*);
+void setBatchStats(data*, const stats*, long);
+long evaluateBatch(data*, const double*, long);
+int planSprt(samplingPlan*, double, double, double, double, long);
+int planZ14(samplingPlan*, int, long, double);
+int planParse(samplingPlan*, const char*);
+void planStart(planProgress*);
+long planAdd(const samplingPlan*, planProgress*, const unsigned char*, long);
+int planFinish(const samplingPlan*, planProgress*);
+long evaluatePlan(data*, const double*, long, const samplingPlan*, planProgress*);
+double minTolVal(double, float);
+double maxTolVal(double, float);
+long classifyReadings(const double*, long, double, double, unsigned char*);
+long classifyScalar(const double*, long, double, double, unsigned char*);
+int supplierId(const registry*, const char*);
+const char* supplierName(const registry*, int);
+int supplierLimit(const registry*);
+void registryInit(registry*);
+void registryDefaults(registry*);
+unsigned int registryHash(const char*, size_t);
+int registryAdd(registry*, int, const char*, size_t);
+int registryFind(const registry*, const char*, size_t);
+const char* registryName(const registry*, int);
+int registryLoad(registry*, const char*, long*);
+int isBinaryLog(const char*);
+int logWriterOpen(logWriter*, const char*, const registry*);
+int logWriterSidecars(logWriter*, const char*, int);
+int logWriterAppend(logWriter*, const data*);
+int logWriterStore(logWriter*, const unsigned char*);
+int logWriterFlush(logWriter*);
+int logWriterClose(logWriter*);
+void logWriterSync(logWriter*, long, long);
+long logWriterRecover(logWriter*);
+unsigned int walChecksum(const unsigned char*, size_t);
+double walClock();
+int walOpen(journal*, const char*);
+int walAppend(journal*, unsigned int, const unsigned char*);
+int walCommit(journal*);
+void walReset(journal*);
+void walClose(journal*);
+int mapFile(const char*, const char**, long*);
+void unmapFile(const char*, long);
+int logOpen(logView*, const char*);
+void logClose(logView*);
+void logColumns(const logView*, long, columns*);
+void logRecord(const columns*, long, const registry*, data*);
+int sidecarName(char*, const char*, const char*);
+int indexOpen(supplierIndex*, const char*, unsigned int);
+void indexAdd(supplierIndex*, unsigned int, unsigned int);
+int indexFlush(supplierIndex*);
+void indexClose(supplierIndex*);
+long indexLookup(const char*, const logView*, int, void (*)(const columns*, long, void*), void*);
+long logDateRange(const logView*, long, long, int, void (*)(const columns*, long, void*), void*);
+int aggOpen(aggregate*, const char*, unsigned int);
+void aggAdd(aggregate*, unsigned int, double, unsigned int, double, double, double);
+int aggFlush(aggregate*);
+void aggClose(aggregate*);
+void aggStats(const struct aggEntry*, stats*);
+double parseReading(const char*, const char*, int*);
+void storeInit(store*);
+void storeFree(store*);
+int storeReserve(store*, long);
+int storeSupplier(store*, const char*);
+int storePart(store*, double, double);
+int storeAdd(store*, const data*);
+void storeRecord(const store*, long, data*);
+int storeLoadLog(store*, const char*, const registry*);
+void storeTotals(const store*, struct aggEntry*);
+void queryInit(query*, int);
+void queryFree(query*);
+unsigned int queryHash(const struct queryGroup*);
+long queryFind(query*, const struct queryGroup*);
+int queryRun(query*, const store*);
+int queryCompare(const void*, const void*);
+void spcInit(spcTable*);
+void spcFree(spcTable*);
+unsigned int spcHash(int, double);
+long spcFind(spcTable*, int, double, double);
+int spcAdd(spcChart*, const double*, long, double, double, long*);
+int spcLoad(spcTable*, const char*);
+int spcSave(const spcTable*, const char*);
+void sketchInit(sketch*);
+unsigned int sketchCapacity(unsigned int, unsigned int);
+void sketchCompress(sketch*);
+int sketchBin(double);
+void sketchBinRange(int, double*, double*);
+void sketchAddBlock(sketch*, const double*, long, double);
+void sketchInsert(sketch*, unsigned int, const float*, unsigned int);
+void sketchMerge(sketch*, const sketch*);
+void sketchQuantiles(const sketch*, const double*, int, double*);
+void sketchTableInit(sketchTable*);
+void sketchTableFree(sketchTable*);
+sketch* sketchFind(sketchTable*, int);
+int sketchTableMerge(sketchTable*, const sketchTable*);
+int sketchLoad(sketchTable*, const char*);
+int sketchSave(const sketchTable*, const char*);
+void archiveInit(archiveBuffer*);
+void archiveFree(archiveBuffer*);
+int archiveReserve(archiveBuffer*, long);
+void archiveBegin(archiveBuffer*, double);
+void archiveAddBlock(archiveBuffer*, const double*, long);
+long archiveEnd(archiveBuffer*, const data*, const registry*);
+long archiveEncodeBlock(const int*, int, unsigned char*);
+long archiveDecodeBlock(const unsigned char*, const unsigned char*, int, double, double, double*);
+int archiveOpen(FILE**, const char*);
+long archiveFirst(const char*, long, double*);
+long archiveFrameAt(const char*, long, long, struct archiveFrame*);
+long archiveDecode(const struct archiveFrame*, const unsigned char*, double, double*);
+unsigned long long profileClock();
+void profileStart();
+void profileBegin(profileTimer*);
+void profileEnd(int, profileTimer*, long, long);
+int profileTotals(struct profileCounter*);
+double profileNanos(unsigned long long);
+
+#endif